@@ -0,0 +1,132 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FastMath.h: Single precision polynomial sin, cos and wrap to [0, 2 pi). Arguments are split as
+// x = q * pi / 2 + r and sin or cos of r is evaluated on [-pi/4, pi/4]. Cheaper than libm.
+// Arguments beyond kMaxFastReduce are reduced in double, where float runs out of bits.
+
+#ifndef FASTMATH_H
+#define FASTMATH_H 1
+
+#include <cmath>
+
+namespace fastMath {
+constexpr float kTwoPi      = static_cast<float>(3.14159265358979323846) * 2;
+constexpr float kOverTwoPi  = static_cast<float>(1.0 / (3.14159265358979323846 * 2));
+constexpr float kTwoOverPi  = 6.36619772367581382433e-01f;
+
+// pi / 2 split into the first 33 bits and the rest, so k * kPiOverTwoHi is exact in double.
+constexpr double kPiOverTwoHi = 1.57079632673412561417e+00;
+constexpr double kPiOverTwoLo = 6.07710050650619224932e-11;
+
+// pi / 2 and 2 pi split in three floats. The leading parts are 201 / 2^7 and 201 / 2^5, so
+// their products with an integer k are exact in float only while |k| * 201 < 2^24, that is
+// |k| <= 83468. Larger arguments are reduced in double instead.
+constexpr float kPiOverTwo1 = 1.5703125f;
+constexpr float kPiOverTwo2 = 4.837512969970703125e-4f;
+constexpr float kPiOverTwo3 = 7.54978995489188216e-8f;
+constexpr float kTwoPi1     = 6.28125f;
+constexpr float kTwoPi2     = 1.93500518798828125e-3f;
+constexpr float kTwoPi3     = 3.01991598195675286e-7f;
+
+// Largest arguments reduced and wrapped in float, a little below 83468 times pi / 2 and 2 pi.
+constexpr float kMaxFastReduce = 131000.0f;
+constexpr float kMaxFastWrap   = 524000.0f;
+
+// Minimax coefficients of sin and cos on [-pi/4, pi/4].
+constexpr float kSin1 = -1.6666654611e-1f;
+constexpr float kSin2 = 8.3321608736e-3f;
+constexpr float kSin3 = -1.9515295891e-4f;
+constexpr float kCos1 = 4.166664568298827e-2f;
+constexpr float kCos2 = -1.388731625493765e-3f;
+constexpr float kCos3 = 2.443315711809948e-5f;
+
+inline float reduce(float x, int *q)
+{
+    if (std::fabs(x) > kMaxFastReduce)
+    {
+        double k = std::floor(x * static_cast<double>(kTwoOverPi) + 0.5);
+        *q       = static_cast<int>(k);
+        return static_cast<float>((x - k * kPiOverTwoHi) - k * kPiOverTwoLo);
+    }
+    float k = std::floor(x * kTwoOverPi + 0.5f);
+    *q      = static_cast<int>(k);
+    return ((x - k * kPiOverTwo1) - k * kPiOverTwo2) - k * kPiOverTwo3;
+}
+
+// sin(q * pi / 2 + r) for r in [-pi/4, pi/4].
+inline float sinQuadrant(float r, int q)
+{
+    float z = r * r;
+    float result;
+    if (q & 1)
+    {
+        result = ((kCos3 * z + kCos2) * z + kCos1) * z * z - 0.5f * z + 1.0f;
+    }
+    else
+    {
+        result = ((kSin3 * z + kSin2) * z + kSin1) * z * r + r;
+    }
+    return (q & 2) ? -result : result;
+}
+
+inline float sin(float x)
+{
+    int q;
+    float r = reduce(x, &q);
+    return sinQuadrant(r, q);
+}
+
+inline float cos(float x)
+{
+    int q;
+    float r = reduce(x, &q);
+    return sinQuadrant(r, q + 1);
+}
+
+// fmod(x, 2 pi) for x >= 0.
+inline float wrapTwoPi(float x)
+{
+    if (x > kMaxFastWrap)
+    {
+        return static_cast<float>(std::fmod(static_cast<double>(x), kTwoPi));
+    }
+    float k = std::floor(x * kOverTwoPi);
+    float r = ((x - k * kTwoPi1) - k * kTwoPi2) - k * kTwoPi3;
+    if (r < 0.0f)
+    {
+        r += kTwoPi;
+    }
+    if (r >= kTwoPi)
+    {
+        r -= kTwoPi;
+    }
+    return r;
+}
+
+// Largest absolute differences of sin, cos and wrapTwoPi from libm over [0, range].
+inline void getMaxError(float range, float *sinError, float *cosError, float *wrapError)
+{
+    const int kSamples = 1 << 20;
+
+    double maxSin  = 0.0;
+    double maxCos  = 0.0;
+    double maxWrap = 0.0;
+    for (int i = 0; i <= kSamples; ++i)
+    {
+        float x = static_cast<float>(static_cast<double>(range) * i / kSamples);
+        maxSin  = std::fmax(maxSin, std::fabs(fastMath::sin(x) - std::sin(static_cast<double>(x))));
+        maxCos  = std::fmax(maxCos, std::fabs(fastMath::cos(x) - std::cos(static_cast<double>(x))));
+        // Results on either side of the wrap point are close on the circle.
+        double wrap = std::fabs(wrapTwoPi(x) - std::fmod(static_cast<double>(x), kTwoPi));
+        maxWrap     = std::fmax(maxWrap, std::fmin(wrap, kTwoPi - wrap));
+    }
+    *sinError  = static_cast<float>(maxSin);
+    *cosError  = static_cast<float>(maxCos);
+    *wrapError = static_cast<float>(maxWrap);
+}
+}  // namespace fastMath
+
+#endif
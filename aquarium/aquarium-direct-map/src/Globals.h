@@ -98,6 +98,28 @@ struct G_viewSettings {
 	float tankColorFudge = 0.796f;
 }constexpr g_viewSettings;
 
+// Key of the scripted camera path of fixed timestep runs. The eye circles the tank as in the
+// default orbit and looks at a target on the opposite side.
+struct CameraKey
+{
+    float time;
+    float eyeAngle;
+    float eyeRadius;
+    float eyeHeight;
+    float targetRadius;
+    float targetHeight;
+};
+
+// Keys are eased into each other, and the path loops after the last key.
+constexpr CameraKey g_cameraPath[] = {
+    {0.0f, 0.0f, 13.2f, 7.5f, 91.6f, 63.3f},
+    {10.0f, 1.2f, 13.2f, 7.5f, 91.6f, 63.3f},
+    {20.0f, 2.4f, 20.0f, 18.0f, 91.6f, 30.0f},
+    {30.0f, 3.6f, 24.0f, 25.0f, 60.0f, 25.0f},
+    {40.0f, 4.8f, 10.0f, 4.0f, 91.6f, 80.0f},
+    {50.0f, 6.28318531f, 13.2f, 7.5f, 91.6f, 63.3f},
+};
+
 static std::vector<float> projection(16);
 static std::vector<float> view(16);
 static std::vector<float> world(16);
@@ -18,6 +18,7 @@
 #include <unistd.h>
 #endif
 
+#include <chrono>
 #include <cmath>
 #include <fstream>
 #include <iostream>
@@ -26,6 +27,7 @@
 #include <vector>
 
 #include "ASSERT.h"
+#include "FastMath.h"
 #include "Globals.h"
 #include "Matrix.h"
 #include "Model.h"
@@ -52,8 +54,15 @@ std::string path;
 // The number of fish is passed from cmd args directly
 int g_numFish;
 
+// Use the polynomial sin, cos and fmod of FastMath.h for fish instead of libm
+bool g_fastMathTrig = false;
+
+// Seconds of animation per frame. 0 follows the wall clock.
+float g_fixedTimestep = 0.0f;
+int g_frameCount      = 0;
+
 // Variables calculate time
-float then = 0.0f;
+double then = 0.0;
 float mClock = 0.0f;
 float eyeClock = 0.0f;
 
@@ -306,6 +315,9 @@ void initialize(int argc, char** argv)
     LoadScenes();
 
     // "--num-fish" {numfish}: imply rendering fish count.
+    // "--fast-math-trig": use polynomial sin, cos and fmod for fish, report the error against libm.
+    // "--fixed-timestep" {dt}: advance animation by dt seconds per frame along a scripted camera
+    // path, so that every run renders the same frames.
     char* pNext;
     for (int i = 1; i < argc; ++i)
     {
@@ -314,6 +326,14 @@ void initialize(int argc, char** argv)
         {
             g_numFish = strtol(argv[i++ + 1], &pNext, 10);
         }
+        else if (cmd == "--fast-math-trig")
+        {
+            g_fastMathTrig = true;
+        }
+        else if (cmd == "--fixed-timestep")
+        {
+            g_fixedTimestep = strtof(argv[i++ + 1], &pNext);
+        }
     }
 
     // Calculate fish count for each float of fish
@@ -354,6 +374,33 @@ void initialize(int argc, char** argv)
                 fishInfo.num = numfloat;
             }
     }
+
+    // Report the largest error of the fast trig against libm, over the angles that fish reach in
+    // an hour of animation.
+    if (g_fastMathTrig)
+    {
+        const float kSeconds = 3600.0f;
+        auto &f              = g["fish"];
+        float maxClock       = 0.0f;
+        for (auto &fishInfo : g_fishTable)
+        {
+            float maxSpeed  = fishInfo.speed + fishInfo.speedRange;
+            float fishClock =
+                (kSeconds * f["fishSpeed"] + fishInfo.num * f["fishOffset"]) * maxSpeed;
+            float tailClock = (kSeconds + fishInfo.num * g_tailOffsetMult) * fishInfo.tailSpeed *
+                              f["fishTailSpeed"] * maxSpeed;
+            maxClock = fishClock > maxClock ? fishClock : maxClock;
+            maxClock = tailClock > maxClock ? tailClock : maxClock;
+        }
+
+        float sinError;
+        float cosError;
+        float wrapError;
+        fastMath::getMaxError(maxClock, &sinError, &cosError, &wrapError);
+        std::cout << "Fast math trig, max error against libm over [0, " << maxClock
+                  << "]: sin " << sinError << ", cos " << cosError << ", fmod " << wrapError
+                  << std::endl;
+    }
 }
 
 int main(int argc, char **argv) {
@@ -471,21 +518,51 @@ void DrawGroup(std::multimap<std::string, std::vector<float>> &group,
     }
 }
 
+// Place the eye and target on the scripted camera path at the given time of animation.
+void updateScriptedCamera(double time)
+{
+    const int numKeys = sizeof(g_cameraPath) / sizeof(g_cameraPath[0]);
+    float period      = g_cameraPath[numKeys - 1].time;
+    float t           = static_cast<float>(fmod(time, static_cast<double>(period)));
+
+    int key = 0;
+    while (key < numKeys - 2 && t >= g_cameraPath[key + 1].time)
+    {
+        ++key;
+    }
+    const CameraKey &a = g_cameraPath[key];
+    const CameraKey &b = g_cameraPath[key + 1];
+    float s            = (t - a.time) / (b.time - a.time);
+    s                  = s * s * (3.0f - 2.0f * s);
+
+    float eyeAngle     = a.eyeAngle + (b.eyeAngle - a.eyeAngle) * s;
+    float eyeRadius    = a.eyeRadius + (b.eyeRadius - a.eyeRadius) * s;
+    float eyeHeight    = a.eyeHeight + (b.eyeHeight - a.eyeHeight) * s;
+    float targetRadius = a.targetRadius + (b.targetRadius - a.targetRadius) * s;
+    float targetHeight = a.targetHeight + (b.targetHeight - a.targetHeight) * s;
+
+    eyePosition[0] = sin(eyeAngle) * eyeRadius;
+    eyePosition[1] = eyeHeight;
+    eyePosition[2] = cos(eyeAngle) * eyeRadius;
+    target[0]      = static_cast<float>(sin(eyeAngle + M_PI)) * targetRadius;
+    target[1]      = targetHeight;
+    target[2]      = static_cast<float>(cos(eyeAngle + M_PI)) * targetRadius;
+}
+
 void render() {
-    // Update our time
-#ifdef _WIN32
-    float now = GetTickCount64() / 1000.0f;
-#else
-    float now = clock() / 1000000.0f;
-#endif
+    // Measure frame time on a monotonic clock. clock() counts CPU time of the process, which
+    // drifts from wall time with load.
+    double now = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now().time_since_epoch())
+                     .count();
     float elapsedTime = 0.0f;
-    if (then == 0.0f)
+    if (then == 0.0)
     {
         elapsedTime = 0.0f;
     }
     else
     {
-        elapsedTime = now - then;
+        elapsedTime = static_cast<float>(now - then);
     }
     then = now;
 
@@ -494,15 +571,26 @@ void render() {
         "Aquarium FPS: " + std::to_string(static_cast<unsigned int>(g_fpsTimer.getAverageFPS()));
     glfwSetWindowTitle(window, text.c_str());
 
-    mClock += elapsedTime * g_speed;
-    eyeClock += elapsedTime * g_viewSettings.eyeSpeed;
-
-    eyePosition[0] = sin(eyeClock) * g_viewSettings.eyeRadius;
-    eyePosition[1] = g_viewSettings.eyeHeight;
-    eyePosition[2] = cos(eyeClock) * g_viewSettings.eyeRadius;
-    target[0]      = static_cast<float>(sin(eyeClock + M_PI)) * g_viewSettings.targetRadius;
-    target[1]      = g_viewSettings.targetHeight;
-    target[2]      = static_cast<float>(cos(eyeClock + M_PI)) * g_viewSettings.targetRadius;
+    if (g_fixedTimestep > 0.0f)
+    {
+        // Animation depends on the frame index only.
+        double time = static_cast<double>(g_frameCount) * g_fixedTimestep;
+        mClock      = static_cast<float>(time * g_speed);
+        updateScriptedCamera(time);
+        ++g_frameCount;
+    }
+    else
+    {
+        mClock += elapsedTime * g_speed;
+        eyeClock += elapsedTime * g_viewSettings.eyeSpeed;
+
+        eyePosition[0] = sin(eyeClock) * g_viewSettings.eyeRadius;
+        eyePosition[1] = g_viewSettings.eyeHeight;
+        eyePosition[2] = cos(eyeClock) * g_viewSettings.eyeRadius;
+        target[0]      = static_cast<float>(sin(eyeClock + M_PI)) * g_viewSettings.targetRadius;
+        target[1]      = g_viewSettings.targetHeight;
+        target[2]      = static_cast<float>(cos(eyeClock + M_PI)) * g_viewSettings.targetRadius;
+    }
 
     ambient[0] = g_viewSettings.ambientRed;
     ambient[1] = g_viewSettings.ambientGreen;
@@ -624,16 +712,28 @@ void render() {
                 float yClock         = fishSpeedClock * fishYClock;
                 float zClock         = fishSpeedClock * fishZClock;
 
-                fishPosition[0]     = sin(xClock) * xRadius;
-                fishPosition[1]     = sin(yClock) * yRadius + fishHeight;
-                fishPosition[2]     = cos(zClock) * zRadius;
-                fishNextPosition[0] = sin(xClock - 0.04f) * xRadius;
-                fishNextPosition[1] = sin(yClock - 0.01f) * yRadius + fishHeight;
-                fishNextPosition[2] = cos(zClock - 0.04f) * zRadius;
-                fishPer.scale       = scale;
-
-                fishPer.time = fmod((mClock + ii * g_tailOffsetMult) * fishTailSpeed * speed,
-                                    static_cast<float>(M_PI) * 2);
+                float tailClock = (mClock + ii * g_tailOffsetMult) * fishTailSpeed * speed;
+                if (g_fastMathTrig)
+                {
+                    fishPosition[0]     = fastMath::sin(xClock) * xRadius;
+                    fishPosition[1]     = fastMath::sin(yClock) * yRadius + fishHeight;
+                    fishPosition[2]     = fastMath::cos(zClock) * zRadius;
+                    fishNextPosition[0] = fastMath::sin(xClock - 0.04f) * xRadius;
+                    fishNextPosition[1] = fastMath::sin(yClock - 0.01f) * yRadius + fishHeight;
+                    fishNextPosition[2] = fastMath::cos(zClock - 0.04f) * zRadius;
+                    fishPer.time        = fastMath::wrapTwoPi(tailClock);
+                }
+                else
+                {
+                    fishPosition[0]     = sin(xClock) * xRadius;
+                    fishPosition[1]     = sin(yClock) * yRadius + fishHeight;
+                    fishPosition[2]     = cos(zClock) * zRadius;
+                    fishNextPosition[0] = sin(xClock - 0.04f) * xRadius;
+                    fishNextPosition[1] = sin(yClock - 0.01f) * yRadius + fishHeight;
+                    fishNextPosition[2] = cos(zClock - 0.04f) * zRadius;
+                    fishPer.time        = fmod(tailClock, static_cast<float>(M_PI) * 2);
+                }
+                fishPer.scale = scale;
                 fish->draw(fishPer);
             }
         }
@@ -0,0 +1,49 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// AlignedMemory.cpp: Implement cache line aligned allocation on Windows and POSIX.
+
+#include "AlignedMemory.h"
+
+#include <cstdlib>
+#include <iostream>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace alignedMemory {
+void *allocate(size_t size)
+{
+    if (size == 0)
+    {
+        size = 1;
+    }
+#ifdef _WIN32
+    void *memory = _aligned_malloc(size, kCacheLineSize);
+#else
+    void *memory = nullptr;
+    if (posix_memalign(&memory, kCacheLineSize, size) != 0)
+    {
+        memory = nullptr;
+    }
+#endif
+    if (memory == nullptr)
+    {
+        std::cout << "Failed to allocate " << size << " bytes." << std::endl;
+        exit(-1);
+    }
+    return memory;
+}
+
+void release(void *memory)
+{
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif
+}
+}  // namespace alignedMemory
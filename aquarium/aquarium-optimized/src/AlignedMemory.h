@@ -0,0 +1,24 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// AlignedMemory.h: Allocate arrays that start on a cache line, so that records updated by
+// different threads or read in one pass never straddle lines.
+
+#pragma once
+#ifndef ALIGNEDMEMORY_H
+#define ALIGNEDMEMORY_H 1
+
+#include <cstddef>
+
+namespace alignedMemory {
+constexpr size_t kCacheLineSize = 64;
+
+// Allocate at least one byte aligned to a cache line. Running out of memory stops the program,
+// so the result is never null.
+void *allocate(size_t size);
+void release(void *memory);
+}  // namespace alignedMemory
+
+#endif
@@ -23,12 +23,17 @@
 #endif
 
 #include <algorithm>
+#include <cfloat>
+#include <chrono>
 #include <cmath>
+#include <cstdlib>
 
 #include "ASSERT.h"
 #include "Aquarium.h"
+#include "Culling.h"
 #include "FishModel.h"
 #include "Matrix.h"
+#include "MeshOptimizer.h"
 #include "SeaweedModel.h"
 #include "opengl/ContextGL.h"
 #include "rapidjson/document.h"
@@ -48,35 +53,58 @@ Aquarium::Aquarium()
       mShaderVersion(""),
       mPath(""),
       factory(nullptr),
-      enableMSAA(false)
+      enableMSAA(false),
+      mFishParamsCount(0),
+      mFishPers(nullptr),
+      mSortedFishPers(nullptr),
+      mFishPersCapacity(0),
+      mNumThreads(0),
+      mJobPool(nullptr),
+      mTrigMode(TRIGMODE::TRIGACCURATE),
+      mFixedTimestep(0.0f),
+      mFrameCount(0),
+      mVisibleFish(0),
+      mCulledFish(0),
+      mLodPixelError(1.0f),
+      mPixelsPerUnit(0.0f),
+      mCompressVertices(false),
+      mFileVertexBytes(0),
+      mVertexBytes(0),
+      mCacheMissesBefore(0.0),
+      mCacheMissesAfter(0.0),
+      mOptimizedTriangles(0),
+      mGeometryArena(nullptr),
+      mMultiDrawIndirect(false)
 {
-    g.then = 0.0f;
+    g.then = 0.0;
     g.mclock = 0.0f;
     g.eyeClock = 0.0f;
 
-    lightUniforms.lightColor[0] = 1.0f;
-    lightUniforms.lightColor[1] = 1.0f;
-    lightUniforms.lightColor[2] = 1.0f;
-    lightUniforms.lightColor[3] = 1.0f;
-
-    lightUniforms.specular[0] = 1.0f;
-    lightUniforms.specular[1] = 1.0f;
-    lightUniforms.specular[2] = 1.0f;
-    lightUniforms.specular[3] = 1.0f;
-
-    fogUniforms.fogColor[0] = g_fogRed;
-    fogUniforms.fogColor[1] = g_fogGreen;
-    fogUniforms.fogColor[2] = g_fogBlue;
-    fogUniforms.fogColor[3] = 1.0f;
-
-    fogUniforms.fogPower    = g_fogPower;
-    fogUniforms.fogMult     = g_fogMult;
-    fogUniforms.fogOffset   = g_fogOffset;
-
-    lightUniforms.ambient[0] = g_ambientRed;
-    lightUniforms.ambient[1] = g_ambientGreen;
-    lightUniforms.ambient[2] = g_ambientBlue;
-    lightUniforms.ambient[3] = 0.0f;
+    LightUniforms &light = lightUniforms.edit();
+    light.lightColor[0] = 1.0f;
+    light.lightColor[1] = 1.0f;
+    light.lightColor[2] = 1.0f;
+    light.lightColor[3] = 1.0f;
+
+    light.specular[0] = 1.0f;
+    light.specular[1] = 1.0f;
+    light.specular[2] = 1.0f;
+    light.specular[3] = 1.0f;
+
+    FogUniforms &fog = fogUniforms.edit();
+    fog.fogColor[0] = g_fogRed;
+    fog.fogColor[1] = g_fogGreen;
+    fog.fogColor[2] = g_fogBlue;
+    fog.fogColor[3] = 1.0f;
+
+    fog.fogPower    = g_fogPower;
+    fog.fogMult     = g_fogMult;
+    fog.fogOffset   = g_fogOffset;
+
+    light.ambient[0] = g_ambientRed;
+    light.ambient[1] = g_ambientGreen;
+    light.ambient[2] = g_ambientBlue;
+    light.ambient[3] = 0.0f;
 }
 
 Aquarium::~Aquarium()
@@ -103,8 +131,12 @@ Aquarium::~Aquarium()
     {
         delete mAquariumModels[i];
     }
+    delete mGeometryArena;
 
     delete factory;
+    delete mJobPool;
+    fishKinematics::freeFishPers(mFishPers);
+    fishKinematics::freeFishPers(mSortedFishPers);
 }
 
 void Aquarium::init(int argc, char **argv)
@@ -114,7 +146,16 @@ void Aquarium::init(int argc, char **argv)
     // Create context of different backends through the cmd args.
     // "--backend" {backend}: create different backends. currently opengl is supported.
     // "--num-fish" {numfish}: imply rendering fish count.
+    // "--num-threads" {numthreads}: threads updating fish. All hardware threads by default.
+    // "--fast-math-trig": reduce fish angles in single precision, report the error against libm.
+    // "--fixed-timestep" {dt}: advance animation by dt seconds per frame along a scripted camera
+    // path, so that every run renders the same frames.
+    // "--lod-error" {pixels}: largest screen space error of levels of detail, 0 to disable them.
+    // "--compress-vertices": store vertex attributes in half float and normalized integer formats.
+    // "--multi-draw-indirect": draw static props with indirect multi draws if the backend can.
+    // "--gl-validation": report errors of OpenGL, which are not checked otherwise.
     char* pNext;
+    bool glValidation = false;
     for (int i = 1; i < argc; ++i)
     {
         std::string cmd(argv[i]);
@@ -134,6 +175,34 @@ void Aquarium::init(int argc, char **argv)
             }
             context      = factory->createContext(mBackendpath);
         }
+        else if (cmd == "--num-threads")
+        {
+            mNumThreads = strtol(argv[i++ + 1], &pNext, 10);
+        }
+        else if (cmd == "--fast-math-trig")
+        {
+            mTrigMode = TRIGMODE::TRIGFAST;
+        }
+        else if (cmd == "--fixed-timestep")
+        {
+            mFixedTimestep = strtof(argv[i++ + 1], &pNext);
+        }
+        else if (cmd == "--lod-error")
+        {
+            mLodPixelError = strtof(argv[i++ + 1], &pNext);
+        }
+        else if (cmd == "--compress-vertices")
+        {
+            mCompressVertices = true;
+        }
+        else if (cmd == "--multi-draw-indirect")
+        {
+            mMultiDrawIndirect = true;
+        }
+        else if (cmd == "--gl-validation")
+        {
+            glValidation = true;
+        }
         else if (cmd == "--enable-msaa")
         {
             enableMSAA = true;
@@ -158,19 +227,32 @@ void Aquarium::init(int argc, char **argv)
         #endif
     }
 
+    context->setValidation(glValidation);
     if (!context->createContext(mBackendFullpath, enableMSAA))
     {
         return;
     }
 
-    // Init general buffer and binding groups for dawn backend.
-    context->initGeneralResources(this);
+    if (mMultiDrawIndirect && !context->supportsMultiDrawIndirect())
+    {
+        std::cout << "Multi draw indirect is not supported by the backend, props are drawn one by "
+                     "one."
+                  << std::endl;
+        mMultiDrawIndirect = false;
+    }
+
+    mJobPool = new JobPool(mNumThreads);
 
     setupModelEnumMap();
 
     loadReource();
 
     calculateFishCount();
+
+    if (mTrigMode == TRIGMODE::TRIGFAST)
+    {
+        reportTrigError();
+    }
 }
 
 void Aquarium::display()
@@ -232,6 +314,9 @@ void Aquarium::loadReource()
 
     loadModels();
     loadPlacement();
+
+    // Textures of all models are uploaded together.
+    context->flushUploads();
 }
 
 void Aquarium::setupModelEnumMap()
@@ -260,33 +345,172 @@ void Aquarium::loadPlacement()
     const rapidjson::Value &objects = document["objects"];
     ASSERT(objects.IsArray());
 
+    // World matrices of every model, in placement order.
+    std::vector<float> worlds[MODELNAME::MODELMAX];
     for (rapidjson::SizeType i = 0; i < objects.Size(); ++i)
     {
         const rapidjson::Value &name        = objects[i]["name"];
         const rapidjson::Value &worldMatrix = objects[i]["worldMatrix"];
         ASSERT(worldMatrix.IsArray() && worldMatrix.Size() == 16);
 
-        vector<float> matrix;
-        for (rapidjson::SizeType j = 0; j < worldMatrix.Size(); ++j)
-        {
-            matrix.push_back(worldMatrix[j].GetFloat());
-        }
-
         MODELNAME modelname = mModelEnumMap[name.GetString()];
         // MODELFIRST means the model is not found in the Map
         if (modelname != MODELNAME::MODELFIRST)
         {
-            mAquariumModels[modelname]->worldmatrices.push_back(matrix);
+            for (rapidjson::SizeType j = 0; j < worldMatrix.Size(); ++j)
+            {
+                worlds[modelname].push_back(worldMatrix[j].GetFloat());
+            }
+        }
+    }
+
+    // World matrices never change, so what derives from them is computed here once.
+    for (const auto &info : g_sceneInfo)
+    {
+        Model *model           = mAquariumModels[info.name];
+        const BoundingBox &box = model->boundingBox;
+        if (info.type != MODELGROUP::SEAWEED)
+        {
+            model->transforms.init(worlds[info.name], box, false);
+            continue;
+        }
+
+        // Seaweed faces the camera from the translation of its world matrix, with z folded onto
+        // the x axis, moved 4 down and the top swaying along x. Bound it for every rotation
+        // about the y axis.
+        BoundingBox seaweedBox;
+        float sway   = std::max(std::fabs(box.min[1]), std::fabs(box.max[1])) * 0.07f;
+        float radius = std::max(std::fabs(box.min[0]), std::fabs(box.max[0])) +
+                       std::max(std::fabs(box.min[2]), std::fabs(box.max[2])) + sway * sway;
+        seaweedBox.min[0] = seaweedBox.min[2] = -radius;
+        seaweedBox.max[0] = seaweedBox.max[2] = radius;
+        seaweedBox.min[1] = box.min[1] - 4.0f;
+        seaweedBox.max[1] = box.max[1] - 4.0f;
+        model->transforms.init(worlds[info.name], seaweedBox, true);
+    }
+
+    buildPropBvh();
+}
+
+// Put every placed instance in the hierarchy with its box in world space.
+void Aquarium::buildPropBvh()
+{
+    std::vector<BvhItem> items;
+    for (const auto &info : g_sceneInfo)
+    {
+        const InstanceTransforms &transforms = mAquariumModels[info.name]->transforms;
+        for (int i = 0; i < transforms.size(); ++i)
+        {
+            BvhItem item;
+            item.box      = transforms.getBounds(i);
+            item.model    = info.name;
+            item.instance = i;
+            items.push_back(item);
+        }
+    }
+    mPropBvh.build(items);
+}
+
+// Merge copies of vertices, reorder every level of detail for the vertex cache and overdraw,
+// then renumber vertices in the order the levels use them and report the cache statistics of
+// the full mesh.
+void Aquarium::optimizeMesh(const G_sceneInfo &info,
+                            const std::vector<LodLevel> &lods,
+                            std::vector<unsigned int> *indices,
+                            std::unordered_map<std::string, std::vector<float>> *attributes,
+                            const std::unordered_map<std::string, int> &attributeComponents)
+{
+    auto position = attributes->find("position");
+    if (position == attributes->end() || lods.empty())
+    {
+        return;
+    }
+    int positionComponents = attributeComponents.at("position");
+    int numVertices        = static_cast<int>(position->second.size()) / positionComponents;
+    // Every attribute must have one element per vertex to be reordered.
+    std::vector<meshOptimizer::VertexStream> streams;
+    for (const auto &attribute : *attributes)
+    {
+        int numComponents = attributeComponents.at(attribute.first);
+        if (attribute.second.size() != static_cast<size_t>(numVertices * numComponents))
+        {
+            return;
         }
+        streams.push_back({attribute.second.data(), numComponents});
+    }
+
+    unsigned int *allIndices     = indices->data();
+    int numIndices               = static_cast<int>(indices->size());
+    const unsigned int *fullMesh = allIndices + lods[0].firstIndex;
+    int numTriangles             = lods[0].indexCount / 3;
+
+    float acmrBefore   = meshOptimizer::getAcmr(fullMesh, lods[0].indexCount, numVertices);
+    float atvrBefore   = meshOptimizer::getAtvr(fullMesh, lods[0].indexCount, numVertices);
+    int verticesBefore = numVertices;
+
+    std::vector<int> order =
+        meshOptimizer::weldVertices(streams, numVertices, allIndices, numIndices);
+    for (auto &attribute : *attributes)
+    {
+        meshOptimizer::remapAttribute(order, attributeComponents.at(attribute.first),
+                                      &attribute.second);
     }
+    numVertices = static_cast<int>(order.size());
+
+    for (const LodLevel &lod : lods)
+    {
+        unsigned int *lodIndices = allIndices + lod.firstIndex;
+        meshOptimizer::optimizeVertexCache(lodIndices, lod.indexCount, numVertices);
+        meshOptimizer::optimizeOverdraw(lodIndices, lod.indexCount, position->second.data(),
+                                        positionComponents, numVertices,
+                                        meshOptimizer::kOverdrawThreshold);
+    }
+    // The full mesh comes first, so its vertices are fetched in order. Coarser levels use a
+    // subset of them.
+    order = meshOptimizer::optimizeVertexFetch(allIndices, numIndices, numVertices);
+    for (auto &attribute : *attributes)
+    {
+        meshOptimizer::remapAttribute(order, attributeComponents.at(attribute.first),
+                                      &attribute.second);
+    }
+
+    float acmrAfter = meshOptimizer::getAcmr(fullMesh, lods[0].indexCount, numVertices);
+    float atvrAfter = meshOptimizer::getAtvr(fullMesh, lods[0].indexCount, numVertices);
+    std::cout << info.namestr << ": " << verticesBefore << " -> " << numVertices
+              << " vertices, ACMR " << acmrBefore << " -> " << acmrAfter << ", ATVR "
+              << atvrBefore << " -> " << atvrAfter << std::endl;
+
+    mCacheMissesBefore += acmrBefore * numTriangles;
+    mCacheMissesAfter += acmrAfter * numTriangles;
+    mOptimizedTriangles += numTriangles;
 }
 
 void Aquarium::loadModels()
 {
+    mGeometryArena = new GeometryArena();
     for (const auto &info : g_sceneInfo)
     {
         loadModel(info);
     }
+
+    std::cout << "Vertex memory: " << mFileVertexBytes / 1024 << " -> " << mVertexBytes / 1024
+              << " KB, " << mGeometryArena->getIndexCount(INDEXUINT16) << " 16 bit and "
+              << mGeometryArena->getIndexCount(INDEXUINT32) << " 32 bit indices";
+    if (mOptimizedTriangles > 0)
+    {
+        std::cout << ", ACMR " << mCacheMissesBefore / mOptimizedTriangles << " -> "
+                  << mCacheMissesAfter / mOptimizedTriangles;
+    }
+    std::cout << std::endl;
+
+    // Models are initialized once the arena has buffers for them, and the context has the
+    // general buffers and bind groups of dawn, which are sized from the models created.
+    mGeometryArena->upload(context);
+    context->initGeneralResources(this);
+    for (const auto &info : g_sceneInfo)
+    {
+        mAquariumModels[info.name]->init();
+    }
 }
 
 // Load vertex and index buffers, textures and program for each model.
@@ -335,6 +559,10 @@ void Aquarium::loadModel(const G_sceneInfo &info)
         }
 
         // set up vertices
+        // Buffers are created last, after levels of detail are built and the mesh is reordered.
+        std::vector<unsigned int> indices;
+        std::unordered_map<std::string, std::vector<float>> attributes;
+        std::unordered_map<std::string, int> attributeComponents;
         const rapidjson::Value &arrays = value["fields"];
         for (rapidjson::Value::ConstMemberIterator itr = arrays.MemberBegin();
              itr != arrays.MemberEnd(); ++itr)
@@ -342,29 +570,86 @@ void Aquarium::loadModel(const G_sceneInfo &info)
             std::string name  = itr->name.GetString();
             int numComponents = itr->value["numComponents"].GetInt();
             std::string type  = itr->value["type"].GetString();
-            Buffer *buffer;
             if (name == "indices")
             {
-                std::vector<unsigned short> vec;
                 for (auto &data : itr->value["data"].GetArray())
                 {
-                    vec.push_back(data.GetInt());
+                    indices.push_back(data.GetUint());
                 }
-                buffer = context->createBuffer(numComponents, vec, true);
             }
             else
             {
-                std::vector<float> vec;
+                std::vector<float> &vec = attributes[name];
                 for (auto &data : itr->value["data"].GetArray())
                 {
                     vec.push_back(data.GetFloat());
                 }
-                buffer = context->createBuffer(numComponents, vec, false);
+                attributeComponents[name] = numComponents;
+
+                if (name == "position")
+                {
+                    culling::addPositions(vec.data(), static_cast<int>(vec.size()), numComponents,
+                                          &model->boundingBox);
+
+                    float fishLength     = 0.0f;
+                    float fishBendAmount = 0.0f;
+                    if (info.name >= MODELNAME::MODELSMALLFISHA &&
+                        info.name <= MODELNAME::MODELBIGFISHB)
+                    {
+                        const Fish &fishInfo = fishTable[info.name - MODELNAME::MODELSMALLFISHA];
+                        fishLength           = fishInfo.fishLength;
+                        fishBendAmount       = fishInfo.fishBendAmount;
+                    }
+                    float radius = culling::getBoundingRadius(
+                        vec.data(), static_cast<int>(vec.size()), numComponents, fishLength,
+                        fishBendAmount);
+                    model->boundingRadius = std::max(model->boundingRadius, radius);
+                }
             }
+        }
 
-            model->bufferMap[name] = buffer;
+        // The index buffer holds every level of detail one after another.
+        static const std::vector<float> kNoAttribute;
+        auto getAttribute = [&attributes](const std::string &name) -> const std::vector<float> & {
+            auto it = attributes.find(name);
+            return it != attributes.end() ? it->second : kNoAttribute;
+        };
+        const std::vector<float> &positions = getAttribute("position");
+        const std::vector<float> &normals   = getAttribute("normal");
+        const std::vector<float> &texCoords = getAttribute("texCoord");
+        SimplifierMesh mesh;
+        mesh.positionComponents = attributeComponents["position"];
+        mesh.positions          = positions.data();
+        mesh.normalComponents   = attributeComponents["normal"];
+        mesh.normals            = normals.empty() ? nullptr : normals.data();
+        mesh.texCoordComponents = attributeComponents["texCoord"];
+        mesh.texCoords          = texCoords.empty() ? nullptr : texCoords.data();
+        mesh.numVertices =
+            mesh.positionComponents > 0 ? static_cast<int>(positions.size()) / mesh.positionComponents
+                                        : 0;
+        mesh.indices    = indices.data();
+        mesh.numIndices = static_cast<int>(indices.size());
+        for (unsigned int index : indices)
+        {
+            if (index >= static_cast<unsigned int>(mesh.numVertices))
+            {
+                std::cout << info.namestr << ": index " << index << " is out of "
+                          << mesh.numVertices << " vertices" << std::endl;
+                exit(-1);
+            }
         }
 
+        int maxLevels = 0;
+        if ((info.type == MODELGROUP::FISH || info.type == MODELGROUP::GENERIC) &&
+            mLodPixelError > 0.0f && mesh.numVertices > 0)
+        {
+            maxLevels = kMaxLods - 1;
+        }
+        std::vector<unsigned int> lodIndices;
+        meshSimplifier::buildLods(mesh, maxLevels, g_lodMaxError * model->boundingRadius,
+                                  &lodIndices, &model->lods);
+        optimizeMesh(info, model->lods, &lodIndices, &attributes, attributeComponents);
+
         // setup program
         // There are 3 programs
         // DM
@@ -409,8 +694,29 @@ void Aquarium::loadModel(const G_sceneInfo &info)
             mProgramMap[vsId + fsId] = program;
         }
 
+        // Interleave the attributes the program reads into one vertex buffer.
+        bool readsTangentFrame =
+            vsId != "diffuseVertexShader" && vsId != "seaweedVertexShader";
+        model->vertexLayout =
+            vertexLayout::build(attributes, attributeComponents, readsTangentFrame,
+                                mCompressVertices);
+
+        int numVertices = static_cast<int>(attributes["position"].size()) /
+                          attributeComponents["position"];
+        mGeometryArena->addMesh(
+            vertexLayout::interleave(model->vertexLayout, attributes, numVertices),
+            model->vertexLayout.stride, lodIndices, &model->geometry);
+
+        // Every attribute of the file as floats, against what vertex fetch reads now.
+        int fileStride = 0;
+        for (const auto &components : attributeComponents)
+        {
+            fileStride += components.second * static_cast<int>(sizeof(float));
+        }
+        mFileVertexBytes += static_cast<size_t>(fileStride) * numVertices;
+        mVertexBytes += static_cast<size_t>(model->vertexLayout.stride) * numVertices;
+
         model->setProgram(program);
-        model->init();
     }
 }
 
@@ -451,6 +757,74 @@ void Aquarium::calculateFishCount()
             fishInfo.num = numfloat;
         }
         }
+
+    if (mFishParamsCount != mFishCount)
+    {
+        buildFishParams();
+        mFishParamsCount = mFishCount;
+    }
+}
+
+// Roll the random parameters of every fish. Fish draw the same numbers as in the original
+// aquarium, which rolled them in order from a reset seed, but every fish range jumps straight to
+// its first number so that ranges are filled in parallel.
+void Aquarium::buildFishParams()
+{
+    long long firstFish = 0;
+    for (int i = MODELNAME::MODELSMALLFISHA; i <= MODELNAME::MODELBIGFISHB; ++i)
+    {
+        const Fish &fishInfo  = fishTable[i - MODELNAME::MODELSMALLFISHA];
+        FishParams &params    = mFishParams[i - MODELNAME::MODELSMALLFISHA];
+        int numFish           = fishInfo.num;
+        float fishRadius      = fishInfo.radius;
+        float fishRadiusRange = fishInfo.radiusRange;
+        float fishSpeed       = fishInfo.speed;
+        float fishSpeedRange  = fishInfo.speedRange;
+        float fishHeightRange = g_fishHeightRange * fishInfo.heightRange;
+
+        params.resize(numFish);
+        mJobPool->parallelFor(0, numFish, fishKinematics::kGrain, [&](int begin, int end) {
+            // Every fish draws 5 numbers.
+            long long seed = matrix::pseudoRandomSeedAt((firstFish + begin) * 5);
+            for (int ii = begin; ii < end; ++ii)
+            {
+                params.speed[ii] =
+                    fishSpeed + static_cast<float>(matrix::pseudoRandom(&seed)) * fishSpeedRange;
+                params.scale[ii] = 1.0f + static_cast<float>(matrix::pseudoRandom(&seed)) * 1;
+                params.xRadius[ii] =
+                    fishRadius + static_cast<float>(matrix::pseudoRandom(&seed)) * fishRadiusRange;
+                params.yRadius[ii] =
+                    2.0f + static_cast<float>(matrix::pseudoRandom(&seed)) * fishHeightRange;
+                params.zRadius[ii] =
+                    fishRadius + static_cast<float>(matrix::pseudoRandom(&seed)) * fishRadiusRange;
+            }
+        });
+        firstFish += numFish;
+    }
+}
+
+// Print the largest error of the fast sin, cos and fmod against libm, over the angles that fish
+// reach in an hour of animation.
+void Aquarium::reportTrigError()
+{
+    const float kSeconds = 3600.0f;
+
+    float maxClock = 0.0f;
+    for (const auto &fishInfo : fishTable)
+    {
+        float fishClock = kSeconds * g_fishSpeed + fishInfo.num * g_fishOffset;
+        maxClock = max(maxClock, fishClock * (fishInfo.speed + fishInfo.speedRange));
+        maxClock = max(maxClock, (kSeconds + fishInfo.num * g_tailOffsetMult) * g_fishTailSpeed *
+                                     fishInfo.tailSpeed * (fishInfo.speed + fishInfo.speedRange));
+    }
+
+    float sinError;
+    float cosError;
+    float wrapError;
+    fastMath::getMaxError(maxClock, &sinError, &cosError, &wrapError);
+    std::cout << "Fast math trig, max error against libm over [0, " << maxClock
+              << "]: sin " << sinError << ", cos " << cosError << ", fmod " << wrapError
+              << std::endl;
 }
 
 float Aquarium::degToRad(float degrees)
@@ -460,38 +834,58 @@ float Aquarium::degToRad(float degrees)
 
 void Aquarium::updateGlobalUniforms()
 {
-    // Update our time
-#ifdef _WIN32
-    float now = GetTickCount64() / 1000.0f;
-#else
-    float now = clock() / 1000000.0f;
-#endif
+    // Measure frame time on a monotonic clock. clock() counts CPU time of the process, which
+    // drifts from wall time with load and thread count.
+    double now = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now().time_since_epoch())
+                     .count();
     float elapsedTime = 0.0f;
-    if (g.then == 0.0f)
+    if (g.then == 0.0)
     {
         elapsedTime = 0.0f;
     }
     else
     {
-        elapsedTime = now - g.then;
+        elapsedTime = static_cast<float>(now - g.then);
     }
     g.then = now;
 
     fpsTimer.update(elapsedTime);
 
     std::string text =
-        "Aquarium FPS: " + to_string(static_cast<unsigned int>(fpsTimer.getAverageFPS()));
+        "Aquarium FPS: " + to_string(static_cast<unsigned int>(fpsTimer.getAverageFPS())) +
+        ", fish visible: " + to_string(mVisibleFish) + ", culled: " + to_string(mCulledFish);
+    const RenderQueueStats &stats = mRenderQueue.getStats();
+    text += ", switches saved: program " + to_string(stats.savedProgramSwitches) + ", texture " +
+            to_string(stats.savedTextureSwitches) + ", pipeline " +
+            to_string(stats.savedPipelineSwitches);
+    // Uniform bytes of the last frame.
+    const UniformUploadStats &uniformStats = context->getUniformStats();
+    text += ", uniform bytes uploaded: " + to_string(uniformStats.bytesUploaded) +
+            ", skipped: " + to_string(uniformStats.bytesSkipped);
+    context->resetUniformStats();
     context->setWindowTitle(text);
 
-    g.mclock += elapsedTime * g_speed;
-    g.eyeClock += elapsedTime * g_eyeSpeed;
-
-    g.eyePosition[0] = sin(g.eyeClock) * g_eyeRadius;
-    g.eyePosition[1] = g_eyeHeight;
-    g.eyePosition[2] = cos(g.eyeClock) * g_eyeRadius;
-    g.target[0]      = static_cast<float>(sin(g.eyeClock + M_PI)) * g_targetRadius;
-    g.target[1]      = g_targetHeight;
-    g.target[2]      = static_cast<float>(cos(g.eyeClock + M_PI)) * g_targetRadius;
+    if (mFixedTimestep > 0.0f)
+    {
+        // Animation depends on the frame index only.
+        double time = static_cast<double>(mFrameCount) * mFixedTimestep;
+        g.mclock    = static_cast<float>(time * g_speed);
+        updateScriptedCamera(time);
+        ++mFrameCount;
+    }
+    else
+    {
+        g.mclock += elapsedTime * g_speed;
+        g.eyeClock += elapsedTime * g_eyeSpeed;
+
+        g.eyePosition[0] = sin(g.eyeClock) * g_eyeRadius;
+        g.eyePosition[1] = g_eyeHeight;
+        g.eyePosition[2] = cos(g.eyeClock) * g_eyeRadius;
+        g.target[0]      = static_cast<float>(sin(g.eyeClock + M_PI)) * g_targetRadius;
+        g.target[1]      = g_targetHeight;
+        g.target[2]      = static_cast<float>(cos(g.eyeClock + M_PI)) * g_targetRadius;
+    }
 
     float nearPlane = 1;
     float farPlane  = 25000.0f;
@@ -513,6 +907,7 @@ void Aquarium::updateGlobalUniforms()
     matrix::inverse4(g.view, viewUniforms.viewInverse);
     matrix::mulMatrixMatrix4(viewUniforms.viewProjection, g.view, g.projection);
     matrix::inverse4(g.viewProjectionInverse, viewUniforms.viewProjection);
+    mPixelsPerUnit = 0.5f * context->getclientHeight() * g.projection[5];
 
     memcpy(g.skyView, g.view, 16 * sizeof(float));
     g.skyView[12] = 0.0;
@@ -527,34 +922,94 @@ void Aquarium::updateGlobalUniforms()
     matrix::mulScalarVector(30.0f, g.v3t1, 3);
     matrix::addVector(lightWorldPositionUniform.lightWorldPos, g.eyePosition, g.v3t0, 3);
     matrix::addVector(lightWorldPositionUniform.lightWorldPos, lightWorldPositionUniform.lightWorldPos, g.v3t1, 3);
+
+    culling::getFrustumPlanes(viewUniforms.viewProjection, mFrustumPlanes);
+}
+
+// Place the eye and target on the scripted camera path at the given time of animation.
+void Aquarium::updateScriptedCamera(double time)
+{
+    const int numKeys = sizeof(g_cameraPath) / sizeof(g_cameraPath[0]);
+    float period      = g_cameraPath[numKeys - 1].time;
+    float t           = static_cast<float>(fmod(time, static_cast<double>(period)));
+
+    int key = 0;
+    while (key < numKeys - 2 && t >= g_cameraPath[key + 1].time)
+    {
+        ++key;
+    }
+    const CameraKey &a = g_cameraPath[key];
+    const CameraKey &b = g_cameraPath[key + 1];
+    float s            = (t - a.time) / (b.time - a.time);
+    s                  = s * s * (3.0f - 2.0f * s);
+
+    float eyeAngle     = a.eyeAngle + (b.eyeAngle - a.eyeAngle) * s;
+    float eyeRadius    = a.eyeRadius + (b.eyeRadius - a.eyeRadius) * s;
+    float eyeHeight    = a.eyeHeight + (b.eyeHeight - a.eyeHeight) * s;
+    float targetRadius = a.targetRadius + (b.targetRadius - a.targetRadius) * s;
+    float targetHeight = a.targetHeight + (b.targetHeight - a.targetHeight) * s;
+
+    g.eyePosition[0] = sin(eyeAngle) * eyeRadius;
+    g.eyePosition[1] = eyeHeight;
+    g.eyePosition[2] = cos(eyeAngle) * eyeRadius;
+    g.target[0]      = static_cast<float>(sin(eyeAngle + M_PI)) * targetRadius;
+    g.target[1]      = targetHeight;
+    g.target[2]      = static_cast<float>(cos(eyeAngle + M_PI)) * targetRadius;
 }
 
 void Aquarium::render()
 {
     updateGlobalUniforms();
-
-    matrix::resetPseudoRandom();
+    mPropBvh.cull(mFrustumPlanes, mVisibleInstances, MODELNAME::MODELMAX);
+    // Props never move, so of their transforms only the world view projection follows the eye,
+    // and only for the visible instances.
+    for (const auto &info : g_sceneInfo)
+    {
+        mAquariumModels[info.name]->transforms.updateWorldViewProjections(
+            viewUniforms.viewProjection, mVisibleInstances[info.name]);
+    }
 
     context->preFrame();
+    context->updateFrameUniforms(this);
 
+    mRenderQueue.clear();
     drawBackground();
-
     drawFishes();
-
     drawInner();
-
     drawSeaweed();
-
     drawOutside();
+
+    mRenderQueue.sort();
+    context->submitRenderQueue(this, mRenderQueue);
 }
 
 void Aquarium::drawBackground()
 {
+    if (mMultiDrawIndirect)
+    {
+        mStaticDraws.clear();
+        for (int i = MODELNAME::MODELRUINCOlOMN; i <= MODELNAME::MODELTREASURECHEST; ++i)
+        {
+            Model *model = mAquariumModels[i];
+            for (int instance : mVisibleInstances[i])
+            {
+                StaticDraw draw;
+                draw.model    = model;
+                draw.instance = instance;
+                draw.lod      = selectLod(model, instance);
+                mStaticDraws.push_back(draw);
+            }
+        }
+        // The background pass is submitted first, so the multi draws go ahead of the queue.
+        context->drawStaticModels(this, mStaticDraws);
+        return;
+    }
+
     Model *model = mAquariumModels[MODELNAME::MODELRUINCOlOMN];
     for (int i = MODELNAME::MODELRUINCOlOMN; i <= MODELNAME::MODELTREASURECHEST; ++i)
     {
         model = mAquariumModels[i];
-        updateWorldMatrixAndDraw(model);
+        queueInstances(RENDERPASS::RENDERPASSBACKGROUND, model, mVisibleInstances[i]);
     }
 }
 
@@ -565,12 +1020,15 @@ void Aquarium::drawSeaweed()
     {
         //model->updateSeaweedModelTime(g.mclock);
         model = static_cast<SeaweedModel *>(mAquariumModels[i]);
-        updateWorldMatrixAndDraw(model);
+        queueInstances(RENDERPASS::RENDERPASSFOREGROUND, model, mVisibleInstances[i]);
     }
 }
 
 void Aquarium::drawFishes()
 {
+    mVisibleFish = 0;
+    mCulledFish  = 0;
+
     for (int i = MODELNAME::MODELSMALLFISHA; i <= MODELNAME::MODELBIGFISHB; ++i)
     {
         FishModel *model = static_cast<FishModel *>(mAquariumModels[i]);
@@ -579,111 +1037,183 @@ void Aquarium::drawFishes()
         int numFish          = fishInfo.num;
         model->updateFishCommonUniforms(fishInfo.fishLength, fishInfo.fishBendAmount,
                                         fishInfo.fishWaveLength);
-        model->preDraw();
 
-        float fishBaseClock   = g.mclock * g_fishSpeed;
-        float fishRadius      = fishInfo.radius;
-        float fishRadiusRange = fishInfo.radiusRange;
-        float fishSpeed       = fishInfo.speed;
-        float fishSpeedRange  = fishInfo.speedRange;
-        float fishTailSpeed   = fishInfo.tailSpeed * g_fishTailSpeed;
-        float fishOffset      = g_fishOffset;
-        float fishClockSpeed  = g_fishSpeed;
-        float fishHeight      = g_fishHeight + fishInfo.heightOffset;
-        float fishHeightRange = g_fishHeightRange * fishInfo.heightRange;
-        float fishXClock      = g_fishXClock;
-        float fishYClock      = g_fishYClock;
-        float fishZClock      = g_fishZClock;
-
-        for (int ii = 0; ii < numFish; ++ii)
-        {
-            float fishClock = fishBaseClock + ii * fishOffset;
-            float speed = fishSpeed + static_cast<float>(matrix::pseudoRandom()) * fishSpeedRange;
-            float scale = 1.0f + static_cast<float>(matrix::pseudoRandom()) * 1;
-            float xRadius =
-                fishRadius + static_cast<float>(matrix::pseudoRandom()) * fishRadiusRange;
-            float yRadius = 2.0f + static_cast<float>(matrix::pseudoRandom()) * fishHeightRange;
-            float zRadius =
-                fishRadius + static_cast<float>(matrix::pseudoRandom()) * fishRadiusRange;
-            float fishSpeedClock = fishClock * speed;
-            float xClock         = fishSpeedClock * fishXClock;
-            float yClock         = fishSpeedClock * fishYClock;
-            float zClock         = fishSpeedClock * fishZClock;
-
-            model->updateFishPerUniforms(
-                sin(xClock) * xRadius, sin(yClock) * yRadius + fishHeight, cos(zClock) * zRadius,
-                sin(xClock - 0.04f) * xRadius, sin(yClock - 0.01f) * yRadius + fishHeight,
-                cos(zClock - 0.04f) * zRadius, scale,
-                fmod((g.mclock + ii * g_tailOffsetMult) * fishTailSpeed * speed,
-                     static_cast<float>(M_PI) * 2));
-            model->updatePerInstanceUniforms(&viewUniforms);
-            if (mBackendpath=="opengl" || mBackendpath == "angle")
+        FishSpeciesState state;
+        state.clock          = g.mclock;
+        state.fishBaseClock  = g.mclock * g_fishSpeed;
+        state.fishOffset     = g_fishOffset;
+        state.fishTailSpeed  = fishInfo.tailSpeed * g_fishTailSpeed;
+        state.fishHeight     = g_fishHeight + fishInfo.heightOffset;
+        state.fishXClock     = g_fishXClock;
+        state.fishYClock     = g_fishYClock;
+        state.fishZClock     = g_fishZClock;
+        state.tailOffsetMult = g_tailOffsetMult;
+        state.trigMode       = mTrigMode;
+
+        if (mFishPersCapacity < numFish)
+        {
+            fishKinematics::freeFishPers(mFishPers);
+            fishKinematics::freeFishPers(mSortedFishPers);
+            mFishPers         = fishKinematics::allocateFishPers(numFish);
+            mSortedFishPers   = fishKinematics::allocateFishPers(numFish);
+            mFishPersCapacity = numFish;
+            mFishLods.resize(numFish);
+        }
+
+        // Fish use level l of detail beyond lodDistances[l] times their scale from the eye.
+        int numLods = static_cast<int>(model->lods.size());
+        float lodDistances[kMaxLods];
+        for (int lod = 0; lod < numLods; ++lod)
+        {
+            lodDistances[lod] = mLodPixelError > 0.0f
+                                    ? model->lods[lod].error * mPixelsPerUnit / mLodPixelError
+                                    : FLT_MAX;
+        }
+
+        // Every block moves its visible fish to the block start while the records are still in
+        // cache, and counts them per level of detail.
+        const FishParams &params = mFishParams[i - MODELNAME::MODELSMALLFISHA];
+        float boundingRadius     = model->boundingRadius;
+        int numBlocks = (numFish + fishKinematics::kGrain - 1) / fishKinematics::kGrain;
+        mFishBlockVisible.assign(numBlocks, 0);
+        mFishBlockLods.assign(numBlocks * kMaxLods, 0);
+        mJobPool->parallelFor(0, numFish, fishKinematics::kGrain, [&](int begin, int end) {
+            fishKinematics::update(state, params, begin, end, mFishPers);
+            for (int block = begin; block < end; block += fishKinematics::kGrain)
+            {
+                int blockEnd   = std::min(block + fishKinematics::kGrain, end);
+                int visible    = fishKinematics::cull(mFrustumPlanes, boundingRadius, block,
+                                                   blockEnd, mFishPers);
+                int *lodCounts = &mFishBlockLods[block / fishKinematics::kGrain * kMaxLods];
+                for (int fish = block; fish < block + visible; ++fish)
+                {
+                    int lod = fishKinematics::selectLod(mFishPers[fish], g.eyePosition,
+                                                        lodDistances, numLods);
+                    mFishLods[fish] = static_cast<unsigned char>(lod);
+                    ++lodCounts[lod];
+                }
+                mFishBlockVisible[block / fishKinematics::kGrain] = visible;
+            }
+        });
+
+        // Turn the counts into the place of the first fish of every block and level, so that
+        // fish end up sorted by level, and in fish order within a level.
+        int lodFirst[kMaxLods];
+        int lodCount[kMaxLods] = {};
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            for (int lod = 0; lod < numLods; ++lod)
             {
-                model->draw();
+                lodCount[lod] += mFishBlockLods[block * kMaxLods + lod];
             }
         }
-        // TODO(yizhou): If backend is dawn, draw only once for every type of fish by drawInstance.
-        // If backend is opengl or angle, draw for exery fish. Update the logic the same as Dawn if
-        // uniform blocks are implemented for OpenGL.
-        if (mBackendpath == "dawn")
+        int numVisible = 0;
+        for (int lod = 0; lod < numLods; ++lod)
         {
-            model->draw();
+            lodFirst[lod] = numVisible;
+            numVisible += lodCount[lod];
         }
+        int next[kMaxLods];
+        std::copy(lodFirst, lodFirst + numLods, next);
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            for (int lod = 0; lod < numLods; ++lod)
+            {
+                int count                              = mFishBlockLods[block * kMaxLods + lod];
+                mFishBlockLods[block * kMaxLods + lod] = next[lod];
+                next[lod] += count;
+            }
+        }
+
+        if (numVisible > 0)
+        {
+            mJobPool->parallelFor(0, numFish, fishKinematics::kGrain, [&](int begin, int end) {
+                for (int block = begin; block < end; block += fishKinematics::kGrain)
+                {
+                    int *places = &mFishBlockLods[block / fishKinematics::kGrain * kMaxLods];
+                    int visible = mFishBlockVisible[block / fishKinematics::kGrain];
+                    for (int fish = block; fish < block + visible; ++fish)
+                    {
+                        mSortedFishPers[places[mFishLods[fish]]++] = mFishPers[fish];
+                    }
+                }
+            });
+        }
+
+        // All the visible fish of the species go to the model at once.
+        FishInstances instances;
+        instances.fishPers = mSortedFishPers;
+        std::copy(lodCount, lodCount + numLods, instances.lodCounts);
+        instances.numLods = numLods;
+        model->submitInstances(instances, numVisible);
+        mVisibleFish += numVisible;
+        mCulledFish += numFish - numVisible;
+
+        // Every species is drawn instanced, with one draw per level of detail.
+        mRenderQueue.push(RENDERPASS::RENDERPASSFISH, model, kInstancedDraw, 0, 0.0f);
     }
 }
 
 void Aquarium::drawInner()
 {
     Model *model = mAquariumModels[MODELNAME::MODELGLOBEINNER];
-    updateWorldMatrixAndDraw(model);
+    queueInstances(RENDERPASS::RENDERPASSFOREGROUND, model,
+                   mVisibleInstances[MODELNAME::MODELGLOBEINNER]);
 }
 
 void Aquarium::drawOutside()
 {
     Model *model = mAquariumModels[MODELNAME::MODELENVIRONMENTBOX];
-    updateWorldMatrixAndDraw(model);
+    queueInstances(RENDERPASS::RENDERPASSFOREGROUND, model,
+                   mVisibleInstances[MODELNAME::MODELENVIRONMENTBOX]);
 }
 
-void Aquarium::updateWorldProjections(const float *w)
+// The transforms of placed instances are computed ahead, so they are only copied.
+void Aquarium::updateWorldProjections(const Model *model, int instance)
 {
-    memcpy(viewUniforms.world, w, 16 * sizeof(float));
-    matrix::mulMatrixMatrix4(viewUniforms.worldViewProjection, viewUniforms.world, viewUniforms.viewProjection);
-    matrix::inverse4(g.worldInverse, viewUniforms.world);
-    matrix::transpose4(viewUniforms.worldInverseTranspose, g.worldInverse);
+    const InstanceTransforms &transforms = model->transforms;
+    memcpy(viewUniforms.world, transforms.getWorld(instance), sizeof(viewUniforms.world));
+    memcpy(viewUniforms.worldInverseTranspose, transforms.getWorldInverseTranspose(instance),
+           sizeof(viewUniforms.worldInverseTranspose));
+    memcpy(viewUniforms.worldViewProjection, transforms.getWorldViewProjection(instance),
+           sizeof(viewUniforms.worldViewProjection));
+}
 
-    // update world uniforms for dawn backend
-    context->updateWorldlUniforms(this);
+// Queue a packet per visible instance of model, keyed by its LOD and distance from the eye.
+void Aquarium::queueInstances(RENDERPASS pass, Model *model, const std::vector<int> &instances)
+{
+    for (int instance : instances)
+    {
+        const float *world = model->transforms.getWorld(instance);
+        float dx           = world[12] - g.eyePosition[0];
+        float dy           = world[13] - g.eyePosition[1];
+        float dz           = world[14] - g.eyePosition[2];
+        float depth        = sqrt(dx * dx + dy * dy + dz * dz);
+        mRenderQueue.push(pass, model, instance, selectLod(model, instance), depth);
+    }
 }
 
-void Aquarium::updateWorldMatrixAndDraw(Model *model)
+// Coarsest level of detail of an instance whose error covers at most mLodPixelError pixels.
+int Aquarium::selectLod(const Model *model, int instance) const
 {
-    if (model->worldmatrices.size())
+    int numLods = static_cast<int>(model->lods.size());
+    if (numLods <= 1 || mLodPixelError <= 0.0f)
     {
-        for (auto &world : model->worldmatrices)
-        {
-            updateWorldProjections(world.data());
-            // Models of dawn keep viewUniforms for every model while opengl models use global
-            // viewUniforms.
-            // Update all viewUniforms on dawn backend.
-            if (mBackendpath == "opengl")
-            {
-                model->preDraw();
-                model->updatePerInstanceUniforms(&viewUniforms);
-                model->draw();
-            }
-            else
-            {
-                model->updatePerInstanceUniforms(&viewUniforms);
-            }
-        }
+        return 0;
     }
 
-    // TODO(yizhou): If backend is dawn, draw only once for every model. If
-    // backend is opengl or angle, draw for exery instance.
-    // Update the logic the same as Dawn if uniform blocks are implemented for OpenGL.
-    if (mBackendpath == "dawn" || mBackendpath == "angle")
+    const float *world = model->transforms.getWorld(instance);
+    float scale        = model->transforms.getScale(instance);
+    float dx       = world[12] - g.eyePosition[0];
+    float dy       = world[13] - g.eyePosition[1];
+    float dz       = world[14] - g.eyePosition[2];
+    float distance = sqrt(dx * dx + dy * dy + dz * dz);
+
+    int lod = 0;
+    while (lod + 1 < numLods &&
+           model->lods[lod + 1].error * scale * mPixelsPerUnit <= mLodPixelError * distance)
     {
-        model->preDraw();
-        model->draw();
+        ++lod;
     }
+    return lod;
 }
@@ -12,12 +12,19 @@
 #include <string>
 #include <unordered_map>
 
+#include "Bvh.h"
 #include "Context.h"
 #include "ContextFactory.h"
 #include "FPSTimer.h"
+#include "FishKinematics.h"
+#include "GeometryArena.h"
+#include "JobPool.h"
+#include "MeshSimplifier.h"
 #include "Model.h"
 #include "Program.h"
+#include "RenderQueue.h"
 #include "Texture.h"
+#include "UniformBlock.h"
 
 class ContextFactory;
 class Context;
@@ -313,11 +320,35 @@ constexpr float g_net_offsetMult  = 1.21f;
 constexpr float g_eyeRadius       = 13.2f;
 constexpr float g_fieldOfView     = 82.699f;
 
+// Key of the scripted camera path of fixed timestep runs. The eye circles the tank as in the
+// default orbit and looks at a target on the opposite side.
+struct CameraKey
+{
+    float time;
+    float eyeAngle;
+    float eyeRadius;
+    float eyeHeight;
+    float targetRadius;
+    float targetHeight;
+};
+
+// Keys are eased into each other, and the path loops after the last key.
+constexpr CameraKey g_cameraPath[] = {
+    {0.0f, 0.0f, 13.2f, 7.5f, 91.6f, 63.3f},
+    {10.0f, 1.2f, 13.2f, 7.5f, 91.6f, 63.3f},
+    {20.0f, 2.4f, 20.0f, 18.0f, 91.6f, 30.0f},
+    {30.0f, 3.6f, 24.0f, 25.0f, 60.0f, 25.0f},
+    {40.0f, 4.8f, 10.0f, 4.0f, 91.6f, 80.0f},
+    {50.0f, 6.28318531f, 13.2f, 7.5f, 91.6f, 63.3f},
+};
+
+// Levels of detail of fish and props may move the surface by this share of the model radius.
+constexpr float g_lodMaxError = 0.1f;
+
 struct Global
 {
     float projection[16];
     float view[16];
-    float worldInverse[16];
     float viewProjectionInverse[16];
     float skyView[16];
     float skyViewProjection[16];
@@ -332,7 +363,7 @@ struct Global
     float m4t2[16];
     float m4t3[16];
     float colorMult[4] = {1, 1, 1, 1};
-    float then;
+    double then;
     float mclock;
     float eyeClock;
 };
@@ -368,6 +399,14 @@ struct FogUniforms
     float fogColor[4];
 };
 
+// Placed instance of a static model to draw, at a level of detail.
+struct StaticDraw
+{
+    Model *model;
+    int instance;
+    int lod;
+};
+
 class Aquarium
 {
   public:
@@ -375,11 +414,17 @@ class Aquarium
     ~Aquarium();
     void init(int argc, char **argv);
     void display();
+    // Fish that passed and failed frustum culling in the last frame.
+    int getVisibleFishCount() const { return mVisibleFish; }
+    int getCulledFishCount() const { return mCulledFish; }
+    // Set the world matrices of the view uniforms to those of a placed instance of model.
+    void updateWorldProjections(const Model *model, int instance);
 
     LightWorldPositionUniform lightWorldPositionUniform;
     ViewUniforms viewUniforms;
-    LightUniforms lightUniforms;
-    FogUniforms fogUniforms;
+    // Light and fog rarely change, so backends upload them only when their version changes.
+    UniformBlock<LightUniforms> lightUniforms;
+    UniformBlock<FogUniforms> fogUniforms;
     Global g;
 
   private:
@@ -397,24 +442,79 @@ class Aquarium
     std::string mPath;
     ContextFactory *factory;
     bool enableMSAA;
+    // Random parameters of every fish, one table per species. Built for mFishParamsCount fish.
+    FishParams mFishParams[MODELNAME::MODELBIGFISHB - MODELNAME::MODELSMALLFISHA + 1];
+    int mFishParamsCount;
+    // Fish records written by the kernel. The visible ones are copied to mSortedFishPers, sorted
+    // by level of detail, and submitted to the model. Both are reused by every species.
+    FishPer *mFishPers;
+    FishPer *mSortedFishPers;
+    int mFishPersCapacity;
+    int mNumThreads;
+    JobPool *mJobPool;
+    TRIGMODE mTrigMode;
+    // Seconds of animation per frame. 0 follows the wall clock.
+    float mFixedTimestep;
+    int mFrameCount;
+    int mVisibleFish;
+    int mCulledFish;
+    // Frustum of the current frame, and the placed instances of every model inside it.
+    float mFrustumPlanes[6][4];
+    Bvh mPropBvh;
+    std::vector<int> mVisibleInstances[MODELNAME::MODELMAX];
+    // Visible fish of every kGrain-aligned block of a species, compacted to the block start, and
+    // their count per level of detail.
+    std::vector<int> mFishBlockVisible;
+    std::vector<int> mFishBlockLods;
+    std::vector<unsigned char> mFishLods;
+    // Largest screen space error of levels of detail in pixels, 0 draws full detail. Pixels
+    // covered by a unit at distance 1 in the current frame.
+    float mLodPixelError;
+    float mPixelsPerUnit;
+    // Draws of the frame, sorted and submitted once all models are queued.
+    RenderQueue mRenderQueue;
+    // Vertex buffers in compressed formats, and their bytes against the attributes of the files
+    // stored as floats.
+    bool mCompressVertices;
+    size_t mFileVertexBytes;
+    size_t mVertexBytes;
+    // Post-transform cache misses of every full mesh before and after it is optimized, and the
+    // triangles they are averaged over.
+    double mCacheMissesBefore;
+    double mCacheMissesAfter;
+    int mOptimizedTriangles;
+    // Vertex and index buffers shared by every model.
+    GeometryArena *mGeometryArena;
+    // Draw static props with indirect multi draws, and the visible prop instances of the frame.
+    bool mMultiDrawIndirect;
+    std::vector<StaticDraw> mStaticDraws;
 
     void updateUrls();
     void loadReource();
     void loadPlacement();
     void loadModels();
     void loadModel(const G_sceneInfo &info);
+    void optimizeMesh(const G_sceneInfo &info,
+                      const std::vector<LodLevel> &lods,
+                      std::vector<unsigned int> *indices,
+                      std::unordered_map<std::string, std::vector<float>> *attributes,
+                      const std::unordered_map<std::string, int> &attributeComponents);
     void setupModelEnumMap();
     void setUpSkyBox(std::vector<std::string> *skyUrls);
     void calculateFishCount();
+    void buildFishParams();
+    void reportTrigError();
     float degToRad(float degrees);
-    void updateWorldMatrixAndDraw(Model *model);
+    void queueInstances(RENDERPASS pass, Model *model, const std::vector<int> &instances);
+    void buildPropBvh();
+    int selectLod(const Model *model, int instance) const;
     void updateGlobalUniforms();
+    void updateScriptedCamera(double time);
     void drawBackground();
     void drawFishes();
     void drawSeaweed();
     void drawInner();
     void drawOutside();
-    void updateWorldProjections(const float *world);
 };
 
 #endif
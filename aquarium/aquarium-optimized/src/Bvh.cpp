@@ -0,0 +1,126 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Bvh.cpp: Build the hierarchy by median splits along the widest axis of the item centers,
+// and walk it with a mask of the frustum planes still to test.
+
+#include "Bvh.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+// Nodes with no more items than this are not split.
+constexpr int kMaxLeafItems = 4;
+}  // namespace
+
+Bvh::Bvh() {}
+
+void Bvh::build(const std::vector<BvhItem> &items)
+{
+    mItems = items;
+    mNodes.clear();
+    if (mItems.empty())
+    {
+        return;
+    }
+    mNodes.reserve(2 * mItems.size());
+    mNodes.push_back(Node());
+    buildNode(0, 0, static_cast<int>(mItems.size()));
+}
+
+void Bvh::buildNode(int node, int first, int count)
+{
+    BoundingBox box;
+    BoundingBox centers;
+    for (int i = first; i < first + count; ++i)
+    {
+        const BoundingBox &itemBox = mItems[i].box;
+        culling::addBox(itemBox, &box);
+        float center[3];
+        for (int j = 0; j < 3; ++j)
+        {
+            center[j] = (itemBox.min[j] + itemBox.max[j]) * 0.5f;
+        }
+        culling::addPositions(center, 3, 3, &centers);
+    }
+    mNodes[node].box   = box;
+    mNodes[node].first = first;
+    mNodes[node].count = count;
+    mNodes[node].left  = -1;
+    if (count <= kMaxLeafItems)
+    {
+        return;
+    }
+
+    int axis = 0;
+    for (int j = 1; j < 3; ++j)
+    {
+        if (centers.max[j] - centers.min[j] > centers.max[axis] - centers.min[axis])
+        {
+            axis = j;
+        }
+    }
+    int half = count / 2;
+    std::nth_element(mItems.begin() + first, mItems.begin() + first + half,
+                     mItems.begin() + first + count,
+                     [axis](const BvhItem &a, const BvhItem &b) {
+                         return a.box.min[axis] + a.box.max[axis] <
+                                b.box.min[axis] + b.box.max[axis];
+                     });
+
+    int left          = static_cast<int>(mNodes.size());
+    mNodes[node].left = left;
+    mNodes.push_back(Node());
+    mNodes.push_back(Node());
+    buildNode(left, first, half);
+    buildNode(left + 1, first + half, count - half);
+}
+
+void Bvh::cull(const float planes[6][4], std::vector<int> *visible, int numModels) const
+{
+    for (int i = 0; i < numModels; ++i)
+    {
+        visible[i].clear();
+    }
+    if (mNodes.empty())
+    {
+        return;
+    }
+
+    std::vector<std::pair<int, int>> stack;
+    stack.push_back(std::make_pair(0, culling::kAllPlanes));
+    while (!stack.empty())
+    {
+        const Node &node = mNodes[stack.back().first];
+        int mask         = stack.back().second;
+        stack.pop_back();
+
+        if (!culling::testBox(planes, node.box, &mask))
+        {
+            continue;
+        }
+        // Subtrees entirely inside the frustum take all of their items without further tests.
+        if (node.left < 0 || mask == 0)
+        {
+            for (int i = node.first; i < node.first + node.count; ++i)
+            {
+                int itemMask = mask;
+                if (culling::testBox(planes, mItems[i].box, &itemMask))
+                {
+                    visible[mItems[i].model].push_back(mItems[i].instance);
+                }
+            }
+            continue;
+        }
+        stack.push_back(std::make_pair(node.left + 1, mask));
+        stack.push_back(std::make_pair(node.left, mask));
+    }
+
+    for (int i = 0; i < numModels; ++i)
+    {
+        std::sort(visible[i].begin(), visible[i].end());
+    }
+}
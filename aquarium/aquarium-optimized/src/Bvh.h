@@ -0,0 +1,56 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Bvh.h: Define a bounding volume hierarchy over the placed instances of static models.
+// The tree is built once after placement is loaded and walked every frame to find the
+// instances inside the view frustum.
+
+#pragma once
+#ifndef BVH_H
+#define BVH_H 1
+
+#include <vector>
+
+#include "Culling.h"
+
+// An instance of a model, with its box in world space.
+struct BvhItem
+{
+    BoundingBox box;
+    int model;
+    int instance;
+};
+
+class Bvh
+{
+  public:
+    Bvh();
+
+    void build(const std::vector<BvhItem> &items);
+
+    // Fill visible[model] with the visible instances of every model, in ascending order so that
+    // instances keep their draw order. visible has room for numModels models.
+    void cull(const float planes[6][4], std::vector<int> *visible, int numModels) const;
+
+    int getNumItems() const { return static_cast<int>(mItems.size()); }
+
+  private:
+    // Leaves hold items [first, first + count). Inner nodes hold the same range, split between
+    // the children at left and left + 1.
+    struct Node
+    {
+        BoundingBox box;
+        int first;
+        int count;
+        int left;
+    };
+
+    void buildNode(int node, int first, int count);
+
+    std::vector<BvhItem> mItems;
+    std::vector<Node> mNodes;
+};
+
+#endif
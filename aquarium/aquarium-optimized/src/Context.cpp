@@ -1,10 +1,51 @@
 #include "Context.h"
 
+#include "RenderQueue.h"
+
+void Context::setValidation(bool validation)
+{
+}
+
 void Context::initGeneralResources(Aquarium * aquarium)
 {
 }
 
-void Context::updateWorldlUniforms(Aquarium * aquarium)
+void Context::flushUploads()
 {
 }
 
+void Context::updateFrameUniforms(Aquarium * aquarium)
+{
+}
+
+// Instances are drawn one by one, each after its view uniforms are updated.
+void Context::submitRenderQueue(Aquarium *aquarium, const RenderQueue &queue)
+{
+    const Model *previous = nullptr;
+    for (const DrawPacket &packet : queue.getPackets())
+    {
+        Model *model = packet.model;
+        if (model != previous)
+        {
+            model->preDraw();
+            previous = model;
+        }
+        if (packet.instance != kInstancedDraw)
+        {
+            aquarium->updateWorldProjections(model, packet.instance);
+            model->setInstanceIndex(packet.instance);
+            model->setLod(packet.lod);
+        }
+        model->updatePerInstanceUniforms(&aquarium->viewUniforms);
+        model->draw();
+    }
+}
+
+bool Context::supportsMultiDrawIndirect() const
+{
+    return false;
+}
+
+void Context::drawStaticModels(Aquarium *aquarium, const std::vector<StaticDraw> &draws)
+{
+}
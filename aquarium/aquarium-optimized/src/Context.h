@@ -16,6 +16,7 @@
 #include "Model.h"
 #include "Program.h"
 #include "Texture.h"
+#include "UniformBlock.h"
 
 #include <string>
 #include <vector>
@@ -25,6 +26,8 @@ class Program;
 class Buffer;
 class Texture;
 class Model;
+struct StaticDraw;
+class RenderQueue;
 
 enum MODELGROUP : short;
 enum MODELNAME : short;
@@ -33,8 +36,10 @@ struct Global;
 class Context
 {
   public:
-    Context(){};
+    Context() : mUniformStats(){};
     virtual bool createContext(std::string backend, bool enableMSAA) = 0;
+    // Report errors of the graphics API as they happen. Set before createContext.
+    virtual void setValidation(bool validation);
     virtual ~Context() {};
     virtual Texture *createTexture(std::string name, std::string url)                      = 0;
     virtual Texture *createTexture(std::string name, const std::vector<std::string> &urls) = 0;
@@ -44,6 +49,13 @@ class Context
     virtual Buffer *createBuffer(int numComponents,
                                  const std::vector<unsigned short> &buffer,
                                  bool isIndex)                                             = 0;
+    virtual Buffer *createBuffer(int numComponents,
+                                 const std::vector<unsigned int> &buffer,
+                                 bool isIndex)                                             = 0;
+    // Packed vertices, numComponents bytes each.
+    virtual Buffer *createBuffer(int numComponents,
+                                 const std::vector<unsigned char> &buffer,
+                                 bool isIndex)                                             = 0;
     virtual Program *createProgram(std::string vId, std::string fId)                       = 0;
     virtual void setWindowTitle(const std::string &text)                                   = 0;
     virtual bool ShouldQuit()                                                              = 0;
@@ -59,11 +71,27 @@ class Context
     virtual Model *createModel(Aquarium *aquarium, MODELGROUP type, MODELNAME name, bool blend) = 0;
 
     virtual void initGeneralResources(Aquarium* aquarium);
-    virtual void updateWorldlUniforms(Aquarium* aquarium);
+    // Submit the uploads of resources queued while loading them.
+    virtual void flushUploads();
+    // Upload uniforms that stay the same for every draw of the frame.
+    virtual void updateFrameUniforms(Aquarium* aquarium);
+    // Draw the sorted packets of the queue. Models are bound once for every run of their packets.
+    virtual void submitRenderQueue(Aquarium *aquarium, const RenderQueue &queue);
+
+    // Static models can be drawn with drawStaticModels.
+    virtual bool supportsMultiDrawIndirect() const;
+    // Draw placed instances of static models with one indirect multi draw for every group of
+    // models that share program and material.
+    virtual void drawStaticModels(Aquarium *aquarium, const std::vector<StaticDraw> &draws);
+
+    // Uniform blocks uploaded and skipped by the backend since the stats were reset.
+    const UniformUploadStats &getUniformStats() const { return mUniformStats; }
+    void resetUniformStats() { mUniformStats = UniformUploadStats(); }
 
   protected:
     int mClientWidth;
     int mClientHeight;
+    mutable UniformUploadStats mUniformStats;
 };
 
 #endif
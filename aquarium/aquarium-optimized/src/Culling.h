@@ -0,0 +1,178 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Culling.h: Extract frustum planes from a view projection matrix and test bounding volumes
+// against them. Matrices are laid out as in Matrix.h, where clip = viewProjection * position
+// with column major storage.
+
+#pragma once
+#ifndef CULLING_H
+#define CULLING_H 1
+
+#include <cfloat>
+#include <cmath>
+
+// Axis aligned bounding box. An empty box has min above max.
+struct BoundingBox
+{
+    float min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+};
+
+namespace culling {
+// Bit i of a plane mask is set while a volume may still cross plane i.
+constexpr int kAllPlanes = 0x3f;
+
+// Planes are stored as (a, b, c, d) with unit normals pointing into the frustum, so that
+// a * x + b * y + c * z + d is the signed distance of a point to the plane.
+inline void getFrustumPlanes(const float *viewProjection, float planes[6][4])
+{
+    const float *m = viewProjection;
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 4; ++j)
+        {
+            planes[i * 2][j]     = m[j * 4 + 3] + m[j * 4 + i];
+            planes[i * 2 + 1][j] = m[j * 4 + 3] - m[j * 4 + i];
+        }
+    }
+
+    for (int i = 0; i < 6; ++i)
+    {
+        float length = std::sqrt(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] +
+                                 planes[i][2] * planes[i][2]);
+        for (int j = 0; j < 4; ++j)
+        {
+            planes[i][j] /= length;
+        }
+    }
+}
+
+inline bool isSphereVisible(const float planes[6][4], const float *center, float radius)
+{
+    for (int i = 0; i < 6; ++i)
+    {
+        float distance = planes[i][0] * center[0] + planes[i][1] * center[1] +
+                         planes[i][2] * center[2] + planes[i][3];
+        if (distance < -radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Grow box to hold the positions, which have numComponents floats per vertex.
+inline void addPositions(const float *positions, int count, int numComponents, BoundingBox *box)
+{
+    for (int i = 0; i + 2 < count; i += numComponents)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            box->min[j] = std::fmin(box->min[j], positions[i + j]);
+            box->max[j] = std::fmax(box->max[j], positions[i + j]);
+        }
+    }
+}
+
+inline void addBox(const BoundingBox &other, BoundingBox *box)
+{
+    for (int j = 0; j < 3; ++j)
+    {
+        box->min[j] = std::fmin(box->min[j], other.min[j]);
+        box->max[j] = std::fmax(box->max[j], other.max[j]);
+    }
+}
+
+// Box in world space that holds the model space box transformed by world.
+inline void transformBox(const BoundingBox &box, const float *world, BoundingBox *result)
+{
+    float center[3];
+    float extent[3];
+    for (int j = 0; j < 3; ++j)
+    {
+        center[j] = (box.min[j] + box.max[j]) * 0.5f;
+        extent[j] = (box.max[j] - box.min[j]) * 0.5f;
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        float worldCenter = world[12 + i];
+        float worldExtent = 0.0f;
+        for (int j = 0; j < 3; ++j)
+        {
+            worldCenter += center[j] * world[j * 4 + i];
+            worldExtent += extent[j] * std::fabs(world[j * 4 + i]);
+        }
+        result->min[i] = worldCenter - worldExtent;
+        result->max[i] = worldCenter + worldExtent;
+    }
+}
+
+// Test box against the planes in *mask. Returns false if the box is outside one of them, and
+// clears the bits of the planes the box is entirely inside, which children need not test again.
+inline bool testBox(const float planes[6][4], const BoundingBox &box, int *mask)
+{
+    for (int i = 0; i < 6; ++i)
+    {
+        if ((*mask & (1 << i)) == 0)
+        {
+            continue;
+        }
+        const float *plane = planes[i];
+        float nearest      = plane[3];
+        float farthest     = plane[3];
+        for (int j = 0; j < 3; ++j)
+        {
+            if (plane[j] >= 0.0f)
+            {
+                nearest += plane[j] * box.min[j];
+                farthest += plane[j] * box.max[j];
+            }
+            else
+            {
+                nearest += plane[j] * box.max[j];
+                farthest += plane[j] * box.min[j];
+            }
+        }
+        if (farthest < 0.0f)
+        {
+            return false;
+        }
+        if (nearest >= 0.0f)
+        {
+            *mask &= ~(1 << i);
+        }
+    }
+    return true;
+}
+
+// Radius of a sphere around the model origin that holds every vertex. Fish bend their tails by
+// up to (z / fishLength)^2 * fishBendAmount along x in the vertex shader, twice as far behind the
+// origin, so that is added for fish. Other models pass 0 as fishLength.
+inline float getBoundingRadius(const float *positions,
+                               int count,
+                               int numComponents,
+                               float fishLength,
+                               float fishBendAmount)
+{
+    float radius = 0.0f;
+    for (int i = 0; i + 2 < count; i += numComponents)
+    {
+        float x = std::fabs(positions[i]);
+        float y = positions[i + 1];
+        float z = positions[i + 2];
+        if (fishLength > 0.0f)
+        {
+            float mult = z > 0.0f ? z / fishLength : -z / fishLength * 2.0f;
+            x += mult * mult * std::fabs(fishBendAmount);
+        }
+        float length = std::sqrt(x * x + y * y + z * z);
+        radius       = length > radius ? length : radius;
+    }
+    return radius;
+}
+}  // namespace culling
+
+#endif
@@ -0,0 +1,397 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FastMath.h: Polynomial sin, cos and wrap to [0, 2 pi) in scalar, SSE2 and AVX2 versions.
+// Arguments are split as x = q * pi / 2 + r and sin or cos of r is evaluated on [-pi/4, pi/4].
+// TRIGACCURATE reduces in double and stays within a few ulps of libm for the whole range of fish
+// clocks. TRIGFAST reduces in float, which is cheaper and as accurate up to kMaxFastReduce, and
+// falls back to the double reduction beyond it.
+
+#pragma once
+#ifndef FASTMATH_H
+#define FASTMATH_H 1
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define FASTMATH_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define FASTMATH_TARGET_SSE2 __attribute__((target("sse2")))
+#define FASTMATH_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define FASTMATH_TARGET_SSE2
+#define FASTMATH_TARGET_AVX2
+#endif
+
+enum TRIGMODE : short
+{
+    TRIGACCURATE,
+    TRIGFAST,
+};
+
+namespace fastMath {
+constexpr float kTwoPi      = static_cast<float>(3.14159265358979323846) * 2;
+constexpr float kOverTwoPi  = static_cast<float>(1.0 / (3.14159265358979323846 * 2));
+constexpr float kTwoOverPiF = 6.36619772367581382433e-01f;
+constexpr double kTwoOverPi = 6.36619772367581382433e-01;
+
+// pi / 2 split into the first 33 bits and the rest, so k * kPiOverTwoHi is exact in double.
+constexpr double kPiOverTwoHi = 1.57079632673412561417e+00;
+constexpr double kPiOverTwoLo = 6.07710050650619224932e-11;
+
+// pi / 2 and 2 pi split in three floats. The leading parts are 201 / 2^7 and 201 / 2^5, so
+// their products with an integer k are exact in float only while |k| * 201 < 2^24, that is
+// |k| <= 83468. Larger arguments are reduced in double instead.
+constexpr float kPiOverTwo1 = 1.5703125f;
+constexpr float kPiOverTwo2 = 4.837512969970703125e-4f;
+constexpr float kPiOverTwo3 = 7.54978995489188216e-8f;
+constexpr float kTwoPi1     = 6.28125f;
+constexpr float kTwoPi2     = 1.93500518798828125e-3f;
+constexpr float kTwoPi3     = 3.01991598195675286e-7f;
+
+// Largest arguments reduced and wrapped in float, a little below 83468 times pi / 2 and 2 pi.
+constexpr float kMaxFastReduce = 131000.0f;
+constexpr float kMaxFastWrap   = 524000.0f;
+
+// Minimax coefficients of sin and cos on [-pi/4, pi/4].
+constexpr float kSin1 = -1.6666654611e-1f;
+constexpr float kSin2 = 8.3321608736e-3f;
+constexpr float kSin3 = -1.9515295891e-4f;
+constexpr float kCos1 = 4.166664568298827e-2f;
+constexpr float kCos2 = -1.388731625493765e-3f;
+constexpr float kCos3 = 2.443315711809948e-5f;
+
+// Scalar versions of the TRIGFAST path. They follow the vector versions step by step.
+
+inline float reduce(float x, int *q)
+{
+    if (std::fabs(x) > kMaxFastReduce)
+    {
+        double k = std::floor(x * kTwoOverPi + 0.5);
+        *q       = static_cast<int>(k);
+        return static_cast<float>((x - k * kPiOverTwoHi) - k * kPiOverTwoLo);
+    }
+    float k = std::floor(x * kTwoOverPiF + 0.5f);
+    *q      = static_cast<int>(k);
+    return ((x - k * kPiOverTwo1) - k * kPiOverTwo2) - k * kPiOverTwo3;
+}
+
+// sin(q * pi / 2 + r) for r in [-pi/4, pi/4].
+inline float sinQuadrant(float r, int q)
+{
+    float z = r * r;
+    float result;
+    if (q & 1)
+    {
+        result = ((kCos3 * z + kCos2) * z + kCos1) * z * z - 0.5f * z + 1.0f;
+    }
+    else
+    {
+        result = ((kSin3 * z + kSin2) * z + kSin1) * z * r + r;
+    }
+    return (q & 2) ? -result : result;
+}
+
+inline float sin(float x)
+{
+    int q;
+    float r = reduce(x, &q);
+    return sinQuadrant(r, q);
+}
+
+inline float cos(float x)
+{
+    int q;
+    float r = reduce(x, &q);
+    return sinQuadrant(r, q + 1);
+}
+
+// fmod(x, 2 pi) for x >= 0.
+inline float wrapTwoPi(float x)
+{
+    if (x > kMaxFastWrap)
+    {
+        return static_cast<float>(std::fmod(static_cast<double>(x), kTwoPi));
+    }
+    float k = std::floor(x * kOverTwoPi);
+    float r = ((x - k * kTwoPi1) - k * kTwoPi2) - k * kTwoPi3;
+    if (r < 0.0f)
+    {
+        r += kTwoPi;
+    }
+    if (r >= kTwoPi)
+    {
+        r -= kTwoPi;
+    }
+    return r;
+}
+
+// Largest absolute differences of sin, cos and wrapTwoPi from libm over [0, range].
+inline void getMaxError(float range, float *sinError, float *cosError, float *wrapError)
+{
+    const int kSamples = 1 << 20;
+
+    double maxSin  = 0.0;
+    double maxCos  = 0.0;
+    double maxWrap = 0.0;
+    for (int i = 0; i <= kSamples; ++i)
+    {
+        float x = static_cast<float>(static_cast<double>(range) * i / kSamples);
+        maxSin  = std::fmax(maxSin, std::fabs(fastMath::sin(x) - std::sin(static_cast<double>(x))));
+        maxCos  = std::fmax(maxCos, std::fabs(fastMath::cos(x) - std::cos(static_cast<double>(x))));
+        // Results on either side of the wrap point are close on the circle.
+        double wrap = std::fabs(wrapTwoPi(x) - std::fmod(static_cast<double>(x), kTwoPi));
+        maxWrap     = std::fmax(maxWrap, std::fmin(wrap, kTwoPi - wrap));
+    }
+    *sinError  = static_cast<float>(maxSin);
+    *cosError  = static_cast<float>(maxCos);
+    *wrapError = static_cast<float>(maxWrap);
+}
+
+#ifdef FASTMATH_X86
+
+// SSE2 versions, 4 lanes.
+
+template <TRIGMODE mode>
+__m128 reduceSSE2(__m128 x, __m128i *q);
+
+template <>
+FASTMATH_TARGET_SSE2 inline __m128 reduceSSE2<TRIGACCURATE>(__m128 x, __m128i *q)
+{
+    const __m128d twoOverPi = _mm_set1_pd(kTwoOverPi);
+    const __m128d hi        = _mm_set1_pd(kPiOverTwoHi);
+    const __m128d lo        = _mm_set1_pd(kPiOverTwoLo);
+
+    __m128d x0 = _mm_cvtps_pd(x);
+    __m128d x1 = _mm_cvtps_pd(_mm_movehl_ps(x, x));
+    __m128i q0 = _mm_cvtpd_epi32(_mm_mul_pd(x0, twoOverPi));
+    __m128i q1 = _mm_cvtpd_epi32(_mm_mul_pd(x1, twoOverPi));
+    __m128d k0 = _mm_cvtepi32_pd(q0);
+    __m128d k1 = _mm_cvtepi32_pd(q1);
+    __m128d r0 = _mm_sub_pd(_mm_sub_pd(x0, _mm_mul_pd(k0, hi)), _mm_mul_pd(k0, lo));
+    __m128d r1 = _mm_sub_pd(_mm_sub_pd(x1, _mm_mul_pd(k1, hi)), _mm_mul_pd(k1, lo));
+    *q         = _mm_unpacklo_epi64(q0, q1);
+    return _mm_movelh_ps(_mm_cvtpd_ps(r0), _mm_cvtpd_ps(r1));
+}
+
+template <>
+FASTMATH_TARGET_SSE2 inline __m128 reduceSSE2<TRIGFAST>(__m128 x, __m128i *q)
+{
+    __m128 large =
+        _mm_cmpgt_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), x), _mm_set1_ps(kMaxFastReduce));
+    if (_mm_movemask_ps(large) != 0)
+    {
+        return reduceSSE2<TRIGACCURATE>(x, q);
+    }
+    *q       = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(kTwoOverPiF)));
+    __m128 k = _mm_cvtepi32_ps(*q);
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(k, _mm_set1_ps(kPiOverTwo1)));
+    r        = _mm_sub_ps(r, _mm_mul_ps(k, _mm_set1_ps(kPiOverTwo2)));
+    return _mm_sub_ps(r, _mm_mul_ps(k, _mm_set1_ps(kPiOverTwo3)));
+}
+
+FASTMATH_TARGET_SSE2 inline __m128 sinQuadrantSSE2(__m128 r, __m128i q)
+{
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i two = _mm_set1_epi32(2);
+
+    __m128 z = _mm_mul_ps(r, r);
+    __m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(kSin3), z), _mm_set1_ps(kSin2));
+    s        = _mm_add_ps(_mm_mul_ps(s, z), _mm_set1_ps(kSin1));
+    s        = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, z), r), r);
+    __m128 c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(kCos3), z), _mm_set1_ps(kCos2));
+    c        = _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(kCos1));
+    c        = _mm_add_ps(
+        _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(c, z), z), _mm_mul_ps(_mm_set1_ps(0.5f), z)),
+        _mm_set1_ps(1.0f));
+
+    __m128 useCos = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+    __m128 sign   = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, two), 30));
+    __m128 result = _mm_or_ps(_mm_and_ps(useCos, c), _mm_andnot_ps(useCos, s));
+    return _mm_xor_ps(result, sign);
+}
+
+template <TRIGMODE mode>
+FASTMATH_TARGET_SSE2 inline __m128 sinSSE2(__m128 x)
+{
+    __m128i q;
+    __m128 r = reduceSSE2<mode>(x, &q);
+    return sinQuadrantSSE2(r, q);
+}
+
+template <TRIGMODE mode>
+FASTMATH_TARGET_SSE2 inline __m128 cosSSE2(__m128 x)
+{
+    __m128i q;
+    __m128 r = reduceSSE2<mode>(x, &q);
+    return sinQuadrantSSE2(r, _mm_add_epi32(q, _mm_set1_epi32(1)));
+}
+
+// fmod(x, 2 pi) for x >= 0.
+template <TRIGMODE mode>
+__m128 wrapTwoPiSSE2(__m128 x);
+
+template <>
+FASTMATH_TARGET_SSE2 inline __m128 wrapTwoPiSSE2<TRIGACCURATE>(__m128 x)
+{
+    const __m128d twoPi = _mm_set1_pd(kTwoPi);
+
+    __m128d x0 = _mm_cvtps_pd(x);
+    __m128d x1 = _mm_cvtps_pd(_mm_movehl_ps(x, x));
+    __m128d n0 = _mm_cvtepi32_pd(_mm_cvttpd_epi32(_mm_div_pd(x0, twoPi)));
+    __m128d n1 = _mm_cvtepi32_pd(_mm_cvttpd_epi32(_mm_div_pd(x1, twoPi)));
+    __m128d r0 = _mm_sub_pd(x0, _mm_mul_pd(n0, twoPi));
+    __m128d r1 = _mm_sub_pd(x1, _mm_mul_pd(n1, twoPi));
+    // The quotient may be off by one after rounding.
+    r0 = _mm_add_pd(r0, _mm_and_pd(_mm_cmplt_pd(r0, _mm_setzero_pd()), twoPi));
+    r1 = _mm_add_pd(r1, _mm_and_pd(_mm_cmplt_pd(r1, _mm_setzero_pd()), twoPi));
+    r0 = _mm_sub_pd(r0, _mm_and_pd(_mm_cmpge_pd(r0, twoPi), twoPi));
+    r1 = _mm_sub_pd(r1, _mm_and_pd(_mm_cmpge_pd(r1, twoPi), twoPi));
+    return _mm_movelh_ps(_mm_cvtpd_ps(r0), _mm_cvtpd_ps(r1));
+}
+
+template <>
+FASTMATH_TARGET_SSE2 inline __m128 wrapTwoPiSSE2<TRIGFAST>(__m128 x)
+{
+    if (_mm_movemask_ps(_mm_cmpgt_ps(x, _mm_set1_ps(kMaxFastWrap))) != 0)
+    {
+        return wrapTwoPiSSE2<TRIGACCURATE>(x);
+    }
+    const __m128 twoPi = _mm_set1_ps(kTwoPi);
+
+    __m128 k = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(kOverTwoPi))));
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(k, _mm_set1_ps(kTwoPi1)));
+    r        = _mm_sub_ps(r, _mm_mul_ps(k, _mm_set1_ps(kTwoPi2)));
+    r        = _mm_sub_ps(r, _mm_mul_ps(k, _mm_set1_ps(kTwoPi3)));
+    r        = _mm_add_ps(r, _mm_and_ps(_mm_cmplt_ps(r, _mm_setzero_ps()), twoPi));
+    return _mm_sub_ps(r, _mm_and_ps(_mm_cmpge_ps(r, twoPi), twoPi));
+}
+
+// AVX2 versions, 8 lanes.
+
+template <TRIGMODE mode>
+__m256 reduceAVX2(__m256 x, __m256i *q);
+
+template <>
+FASTMATH_TARGET_AVX2 inline __m256 reduceAVX2<TRIGACCURATE>(__m256 x, __m256i *q)
+{
+    const __m256d twoOverPi = _mm256_set1_pd(kTwoOverPi);
+    const __m256d hi        = _mm256_set1_pd(kPiOverTwoHi);
+    const __m256d lo        = _mm256_set1_pd(kPiOverTwoLo);
+
+    __m256d x0 = _mm256_cvtps_pd(_mm256_castps256_ps128(x));
+    __m256d x1 = _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1));
+    __m256d k0 = _mm256_round_pd(_mm256_mul_pd(x0, twoOverPi),
+                                 _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d k1 = _mm256_round_pd(_mm256_mul_pd(x1, twoOverPi),
+                                 _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d r0 = _mm256_sub_pd(_mm256_sub_pd(x0, _mm256_mul_pd(k0, hi)), _mm256_mul_pd(k0, lo));
+    __m256d r1 = _mm256_sub_pd(_mm256_sub_pd(x1, _mm256_mul_pd(k1, hi)), _mm256_mul_pd(k1, lo));
+    *q         = _mm256_insertf128_si256(_mm256_castsi128_si256(_mm256_cvtpd_epi32(k0)),
+                                 _mm256_cvtpd_epi32(k1), 1);
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(r0)), _mm256_cvtpd_ps(r1),
+                                1);
+}
+
+template <>
+FASTMATH_TARGET_AVX2 inline __m256 reduceAVX2<TRIGFAST>(__m256 x, __m256i *q)
+{
+    __m256 large = _mm256_cmp_ps(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), x),
+                                 _mm256_set1_ps(kMaxFastReduce), _CMP_GT_OQ);
+    if (_mm256_movemask_ps(large) != 0)
+    {
+        return reduceAVX2<TRIGACCURATE>(x, q);
+    }
+    *q       = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(kTwoOverPiF)));
+    __m256 k = _mm256_cvtepi32_ps(*q);
+    __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(k, _mm256_set1_ps(kPiOverTwo1)));
+    r        = _mm256_sub_ps(r, _mm256_mul_ps(k, _mm256_set1_ps(kPiOverTwo2)));
+    return _mm256_sub_ps(r, _mm256_mul_ps(k, _mm256_set1_ps(kPiOverTwo3)));
+}
+
+FASTMATH_TARGET_AVX2 inline __m256 sinQuadrantAVX2(__m256 r, __m256i q)
+{
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i two = _mm256_set1_epi32(2);
+
+    __m256 z = _mm256_mul_ps(r, r);
+    __m256 s = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(kSin3), z), _mm256_set1_ps(kSin2));
+    s        = _mm256_add_ps(_mm256_mul_ps(s, z), _mm256_set1_ps(kSin1));
+    s        = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(s, z), r), r);
+    __m256 c = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(kCos3), z), _mm256_set1_ps(kCos2));
+    c        = _mm256_add_ps(_mm256_mul_ps(c, z), _mm256_set1_ps(kCos1));
+    c        = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(c, z), z),
+                                    _mm256_mul_ps(_mm256_set1_ps(0.5f), z)),
+                      _mm256_set1_ps(1.0f));
+
+    __m256 useCos = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(q, one), one));
+    __m256 sign   = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(q, two), 30));
+    return _mm256_xor_ps(_mm256_blendv_ps(s, c, useCos), sign);
+}
+
+template <TRIGMODE mode>
+FASTMATH_TARGET_AVX2 inline __m256 sinAVX2(__m256 x)
+{
+    __m256i q;
+    __m256 r = reduceAVX2<mode>(x, &q);
+    return sinQuadrantAVX2(r, q);
+}
+
+template <TRIGMODE mode>
+FASTMATH_TARGET_AVX2 inline __m256 cosAVX2(__m256 x)
+{
+    __m256i q;
+    __m256 r = reduceAVX2<mode>(x, &q);
+    return sinQuadrantAVX2(r, _mm256_add_epi32(q, _mm256_set1_epi32(1)));
+}
+
+// fmod(x, 2 pi) for x >= 0.
+FASTMATH_TARGET_AVX2 inline __m256d wrapTwoPiAVX2(__m256d x)
+{
+    const __m256d twoPi = _mm256_set1_pd(kTwoPi);
+
+    __m256d n = _mm256_floor_pd(_mm256_div_pd(x, twoPi));
+    __m256d r = _mm256_sub_pd(x, _mm256_mul_pd(n, twoPi));
+    // The quotient may be off by one after rounding.
+    r = _mm256_add_pd(r, _mm256_and_pd(_mm256_cmp_pd(r, _mm256_setzero_pd(), _CMP_LT_OQ), twoPi));
+    return _mm256_sub_pd(r, _mm256_and_pd(_mm256_cmp_pd(r, twoPi, _CMP_GE_OQ), twoPi));
+}
+
+template <TRIGMODE mode>
+__m256 wrapTwoPiAVX2(__m256 x);
+
+template <>
+FASTMATH_TARGET_AVX2 inline __m256 wrapTwoPiAVX2<TRIGACCURATE>(__m256 x)
+{
+    __m256d r0 = wrapTwoPiAVX2(_mm256_cvtps_pd(_mm256_castps256_ps128(x)));
+    __m256d r1 = wrapTwoPiAVX2(_mm256_cvtps_pd(_mm256_extractf128_ps(x, 1)));
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(r0)), _mm256_cvtpd_ps(r1),
+                                1);
+}
+
+template <>
+FASTMATH_TARGET_AVX2 inline __m256 wrapTwoPiAVX2<TRIGFAST>(__m256 x)
+{
+    if (_mm256_movemask_ps(_mm256_cmp_ps(x, _mm256_set1_ps(kMaxFastWrap), _CMP_GT_OQ)) != 0)
+    {
+        return wrapTwoPiAVX2<TRIGACCURATE>(x);
+    }
+    const __m256 twoPi = _mm256_set1_ps(kTwoPi);
+
+    __m256 k = _mm256_floor_ps(_mm256_mul_ps(x, _mm256_set1_ps(kOverTwoPi)));
+    __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(k, _mm256_set1_ps(kTwoPi1)));
+    r        = _mm256_sub_ps(r, _mm256_mul_ps(k, _mm256_set1_ps(kTwoPi2)));
+    r        = _mm256_sub_ps(r, _mm256_mul_ps(k, _mm256_set1_ps(kTwoPi3)));
+    r = _mm256_add_ps(r, _mm256_and_ps(_mm256_cmp_ps(r, _mm256_setzero_ps(), _CMP_LT_OQ), twoPi));
+    return _mm256_sub_ps(r, _mm256_and_ps(_mm256_cmp_ps(r, twoPi, _CMP_GE_OQ), twoPi));
+}
+
+#endif  // FASTMATH_X86
+}  // namespace fastMath
+
+#endif
@@ -0,0 +1,401 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FishKinematics.cpp: Implement scalar, SSE2 and AVX2 kernels of the fish update.
+// SIMD kernels take sin, cos and the wrap of the tail time from FastMath.h, in the precision
+// picked by the trig mode of the species state.
+
+#include "FishKinematics.h"
+
+#include <cmath>
+
+#include "AlignedMemory.h"
+#include "Culling.h"
+
+#if defined(FASTMATH_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+// libm in TRIGACCURATE, the polynomials of FastMath.h in TRIGFAST.
+template <TRIGMODE mode>
+inline float sinScalar(float x)
+{
+    return mode == TRIGFAST ? fastMath::sin(x) : std::sin(x);
+}
+
+template <TRIGMODE mode>
+inline float cosScalar(float x)
+{
+    return mode == TRIGFAST ? fastMath::cos(x) : std::cos(x);
+}
+
+template <TRIGMODE mode>
+inline float wrapTwoPiScalar(float x)
+{
+    return mode == TRIGFAST ? fastMath::wrapTwoPi(x) : std::fmod(x, fastMath::kTwoPi);
+}
+
+template <TRIGMODE mode>
+void updateScalar(const FishSpeciesState &state,
+                  const FishParams &params,
+                  int begin,
+                  int end,
+                  FishPer *fishPers)
+{
+    for (int ii = begin; ii < end; ++ii)
+    {
+        float fishClock      = state.fishBaseClock + ii * state.fishOffset;
+        float speed          = params.speed[ii];
+        float xRadius        = params.xRadius[ii];
+        float yRadius        = params.yRadius[ii];
+        float zRadius        = params.zRadius[ii];
+        float fishSpeedClock = fishClock * speed;
+        float xClock         = fishSpeedClock * state.fishXClock;
+        float yClock         = fishSpeedClock * state.fishYClock;
+        float zClock         = fishSpeedClock * state.fishZClock;
+
+        FishPer &fish         = fishPers[ii];
+        fish.worldPosition[0] = sinScalar<mode>(xClock) * xRadius;
+        fish.worldPosition[1] = sinScalar<mode>(yClock) * yRadius + state.fishHeight;
+        fish.worldPosition[2] = cosScalar<mode>(zClock) * zRadius;
+        fish.nextPosition[0]  = sinScalar<mode>(xClock - 0.04f) * xRadius;
+        fish.nextPosition[1]  = sinScalar<mode>(yClock - 0.01f) * yRadius + state.fishHeight;
+        fish.nextPosition[2]  = cosScalar<mode>(zClock - 0.04f) * zRadius;
+        fish.scale            = params.scale[ii];
+        fish.time             = wrapTwoPiScalar<mode>(
+            (state.clock + ii * state.tailOffsetMult) * state.fishTailSpeed * speed);
+    }
+}
+
+#ifdef FASTMATH_X86
+
+// SSE2 kernel, 4 fish per step.
+
+template <TRIGMODE mode>
+FASTMATH_TARGET_SSE2 void updateSSE2(const FishSpeciesState &state,
+                            const FishParams &params,
+                            int begin,
+                            int end,
+                            FishPer *fishPers)
+{
+    const __m128 lanes          = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128 fishBaseClock  = _mm_set1_ps(state.fishBaseClock);
+    const __m128 fishOffset     = _mm_set1_ps(state.fishOffset);
+    const __m128 clock          = _mm_set1_ps(state.clock);
+    const __m128 tailOffsetMult = _mm_set1_ps(state.tailOffsetMult);
+    const __m128 fishTailSpeed  = _mm_set1_ps(state.fishTailSpeed);
+    const __m128 fishHeight     = _mm_set1_ps(state.fishHeight);
+    const __m128 fishXClock     = _mm_set1_ps(state.fishXClock);
+    const __m128 fishYClock     = _mm_set1_ps(state.fishYClock);
+    const __m128 fishZClock     = _mm_set1_ps(state.fishZClock);
+    const __m128 nextXZ         = _mm_set1_ps(0.04f);
+    const __m128 nextY          = _mm_set1_ps(0.01f);
+
+    int ii = begin;
+    for (; ii + 4 <= end; ii += 4)
+    {
+        __m128 index   = _mm_add_ps(_mm_set1_ps(static_cast<float>(ii)), lanes);
+        __m128 speed   = _mm_loadu_ps(&params.speed[ii]);
+        __m128 xRadius = _mm_loadu_ps(&params.xRadius[ii]);
+        __m128 yRadius = _mm_loadu_ps(&params.yRadius[ii]);
+        __m128 zRadius = _mm_loadu_ps(&params.zRadius[ii]);
+
+        __m128 fishClock      = _mm_add_ps(fishBaseClock, _mm_mul_ps(index, fishOffset));
+        __m128 fishSpeedClock = _mm_mul_ps(fishClock, speed);
+        __m128 xClock         = _mm_mul_ps(fishSpeedClock, fishXClock);
+        __m128 yClock         = _mm_mul_ps(fishSpeedClock, fishYClock);
+        __m128 zClock         = _mm_mul_ps(fishSpeedClock, fishZClock);
+
+        __m128 sinX     = fastMath::sinSSE2<mode>(xClock);
+        __m128 sinY     = fastMath::sinSSE2<mode>(yClock);
+        __m128 cosZ     = fastMath::cosSSE2<mode>(zClock);
+        __m128 sinNextX = fastMath::sinSSE2<mode>(_mm_sub_ps(xClock, nextXZ));
+        __m128 sinNextY = fastMath::sinSSE2<mode>(_mm_sub_ps(yClock, nextY));
+        __m128 cosNextZ = fastMath::cosSSE2<mode>(_mm_sub_ps(zClock, nextXZ));
+
+        __m128 x      = _mm_mul_ps(sinX, xRadius);
+        __m128 y      = _mm_add_ps(_mm_mul_ps(sinY, yRadius), fishHeight);
+        __m128 z      = _mm_mul_ps(cosZ, zRadius);
+        __m128 scale  = _mm_loadu_ps(&params.scale[ii]);
+        __m128 nextX  = _mm_mul_ps(sinNextX, xRadius);
+        __m128 nextYv = _mm_add_ps(_mm_mul_ps(sinNextY, yRadius), fishHeight);
+        __m128 nextZ  = _mm_mul_ps(cosNextZ, zRadius);
+        __m128 tail   = _mm_mul_ps(
+            _mm_mul_ps(_mm_add_ps(clock, _mm_mul_ps(index, tailOffsetMult)), fishTailSpeed), speed);
+        __m128 time = fastMath::wrapTwoPiSSE2<mode>(tail);
+
+        // Transpose to FishPer records.
+        _MM_TRANSPOSE4_PS(x, y, z, scale);
+        _MM_TRANSPOSE4_PS(nextX, nextYv, nextZ, time);
+        _mm_storeu_ps(fishPers[ii].worldPosition, x);
+        _mm_storeu_ps(fishPers[ii].nextPosition, nextX);
+        _mm_storeu_ps(fishPers[ii + 1].worldPosition, y);
+        _mm_storeu_ps(fishPers[ii + 1].nextPosition, nextYv);
+        _mm_storeu_ps(fishPers[ii + 2].worldPosition, z);
+        _mm_storeu_ps(fishPers[ii + 2].nextPosition, nextZ);
+        _mm_storeu_ps(fishPers[ii + 3].worldPosition, scale);
+        _mm_storeu_ps(fishPers[ii + 3].nextPosition, time);
+    }
+
+    updateScalar<mode>(state, params, ii, end, fishPers);
+}
+
+// AVX2 kernel, 8 fish per step.
+
+template <TRIGMODE mode>
+FASTMATH_TARGET_AVX2 void updateAVX2(const FishSpeciesState &state,
+                            const FishParams &params,
+                            int begin,
+                            int end,
+                            FishPer *fishPers)
+{
+    const __m256 lanes          = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+    const __m256 fishBaseClock  = _mm256_set1_ps(state.fishBaseClock);
+    const __m256 fishOffset     = _mm256_set1_ps(state.fishOffset);
+    const __m256 clock          = _mm256_set1_ps(state.clock);
+    const __m256 tailOffsetMult = _mm256_set1_ps(state.tailOffsetMult);
+    const __m256 fishTailSpeed  = _mm256_set1_ps(state.fishTailSpeed);
+    const __m256 fishHeight     = _mm256_set1_ps(state.fishHeight);
+    const __m256 fishXClock     = _mm256_set1_ps(state.fishXClock);
+    const __m256 fishYClock     = _mm256_set1_ps(state.fishYClock);
+    const __m256 fishZClock     = _mm256_set1_ps(state.fishZClock);
+    const __m256 nextXZ         = _mm256_set1_ps(0.04f);
+    const __m256 nextY          = _mm256_set1_ps(0.01f);
+
+    int ii = begin;
+    for (; ii + 8 <= end; ii += 8)
+    {
+        __m256 index   = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(ii)), lanes);
+        __m256 speed   = _mm256_loadu_ps(&params.speed[ii]);
+        __m256 xRadius = _mm256_loadu_ps(&params.xRadius[ii]);
+        __m256 yRadius = _mm256_loadu_ps(&params.yRadius[ii]);
+        __m256 zRadius = _mm256_loadu_ps(&params.zRadius[ii]);
+
+        __m256 fishClock      = _mm256_add_ps(fishBaseClock, _mm256_mul_ps(index, fishOffset));
+        __m256 fishSpeedClock = _mm256_mul_ps(fishClock, speed);
+        __m256 xClock         = _mm256_mul_ps(fishSpeedClock, fishXClock);
+        __m256 yClock         = _mm256_mul_ps(fishSpeedClock, fishYClock);
+        __m256 zClock         = _mm256_mul_ps(fishSpeedClock, fishZClock);
+
+        __m256 sinX     = fastMath::sinAVX2<mode>(xClock);
+        __m256 sinY     = fastMath::sinAVX2<mode>(yClock);
+        __m256 cosZ     = fastMath::cosAVX2<mode>(zClock);
+        __m256 sinNextX = fastMath::sinAVX2<mode>(_mm256_sub_ps(xClock, nextXZ));
+        __m256 sinNextY = fastMath::sinAVX2<mode>(_mm256_sub_ps(yClock, nextY));
+        __m256 cosNextZ = fastMath::cosAVX2<mode>(_mm256_sub_ps(zClock, nextXZ));
+
+        __m256 r0 = _mm256_mul_ps(sinX, xRadius);
+        __m256 r1 = _mm256_add_ps(_mm256_mul_ps(sinY, yRadius), fishHeight);
+        __m256 r2 = _mm256_mul_ps(cosZ, zRadius);
+        __m256 r3 = _mm256_loadu_ps(&params.scale[ii]);
+        __m256 r4 = _mm256_mul_ps(sinNextX, xRadius);
+        __m256 r5 = _mm256_add_ps(_mm256_mul_ps(sinNextY, yRadius), fishHeight);
+        __m256 r6 = _mm256_mul_ps(cosNextZ, zRadius);
+        __m256 tailClock = _mm256_add_ps(clock, _mm256_mul_ps(index, tailOffsetMult));
+        __m256 tail      = _mm256_mul_ps(_mm256_mul_ps(tailClock, fishTailSpeed), speed);
+        __m256 r7 = fastMath::wrapTwoPiAVX2<mode>(tail);
+
+        // Transpose the 8 x 8 block so that every row becomes the FishPer record of one fish.
+        __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+        __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+        __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+        __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+        __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+        __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+        __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+        __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+        __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+        float *out = fishPers[ii].worldPosition;
+        _mm256_storeu_ps(out + 0 * 8, _mm256_permute2f128_ps(s0, s4, 0x20));
+        _mm256_storeu_ps(out + 1 * 8, _mm256_permute2f128_ps(s1, s5, 0x20));
+        _mm256_storeu_ps(out + 2 * 8, _mm256_permute2f128_ps(s2, s6, 0x20));
+        _mm256_storeu_ps(out + 3 * 8, _mm256_permute2f128_ps(s3, s7, 0x20));
+        _mm256_storeu_ps(out + 4 * 8, _mm256_permute2f128_ps(s0, s4, 0x31));
+        _mm256_storeu_ps(out + 5 * 8, _mm256_permute2f128_ps(s1, s5, 0x31));
+        _mm256_storeu_ps(out + 6 * 8, _mm256_permute2f128_ps(s2, s6, 0x31));
+        _mm256_storeu_ps(out + 7 * 8, _mm256_permute2f128_ps(s3, s7, 0x31));
+    }
+
+    updateScalar<mode>(state, params, ii, end, fishPers);
+}
+
+#endif  // FASTMATH_X86
+}  // namespace
+
+void FishParams::resize(int numFish)
+{
+    speed.resize(numFish);
+    scale.resize(numFish);
+    xRadius.resize(numFish);
+    yRadius.resize(numFish);
+    zRadius.resize(numFish);
+}
+
+namespace fishKinematics {
+FishPer *allocateFishPers(int numFish)
+{
+    return static_cast<FishPer *>(alignedMemory::allocate(sizeof(FishPer) * numFish));
+}
+
+void freeFishPers(FishPer *fishPers)
+{
+    alignedMemory::release(fishPers);
+}
+
+FISHKERNEL getKernel()
+{
+#ifdef FASTMATH_X86
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    int numIds = info[0];
+    __cpuid(info, 1);
+    bool sse2    = (info[3] & (1 << 26)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx     = (info[2] & (1 << 28)) != 0;
+    bool avx2    = false;
+    if (numIds >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+    // The OS has to save the upper halves of the YMM registers.
+    if (avx2 && avx && osxsave && (_xgetbv(0) & 6) == 6)
+    {
+        return FISHKERNEL::KERNELAVX2;
+    }
+    if (sse2)
+    {
+        return FISHKERNEL::KERNELSSE2;
+    }
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return FISHKERNEL::KERNELAVX2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return FISHKERNEL::KERNELSSE2;
+    }
+#endif
+#endif
+    return FISHKERNEL::KERNELSCALAR;
+}
+
+const char *getKernelName(FISHKERNEL kernel)
+{
+    switch (kernel)
+    {
+        case FISHKERNEL::KERNELAVX2:
+            return "avx2";
+        case FISHKERNEL::KERNELSSE2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+void update(const FishSpeciesState &state,
+            const FishParams &params,
+            int begin,
+            int end,
+            FishPer *fishPers)
+{
+    static const FISHKERNEL kernel = getKernel();
+    update(kernel, state, params, begin, end, fishPers);
+}
+
+void update(FISHKERNEL kernel,
+            const FishSpeciesState &state,
+            const FishParams &params,
+            int begin,
+            int end,
+            FishPer *fishPers)
+{
+    bool fast = state.trigMode == TRIGMODE::TRIGFAST;
+    switch (kernel)
+    {
+#ifdef FASTMATH_X86
+        case FISHKERNEL::KERNELAVX2:
+            if (fast)
+            {
+                updateAVX2<TRIGMODE::TRIGFAST>(state, params, begin, end, fishPers);
+            }
+            else
+            {
+                updateAVX2<TRIGMODE::TRIGACCURATE>(state, params, begin, end, fishPers);
+            }
+            break;
+        case FISHKERNEL::KERNELSSE2:
+            if (fast)
+            {
+                updateSSE2<TRIGMODE::TRIGFAST>(state, params, begin, end, fishPers);
+            }
+            else
+            {
+                updateSSE2<TRIGMODE::TRIGACCURATE>(state, params, begin, end, fishPers);
+            }
+            break;
+#endif
+        default:
+            if (fast)
+            {
+                updateScalar<TRIGMODE::TRIGFAST>(state, params, begin, end, fishPers);
+            }
+            else
+            {
+                updateScalar<TRIGMODE::TRIGACCURATE>(state, params, begin, end, fishPers);
+            }
+    }
+}
+
+int cull(const float planes[6][4], float boundingRadius, int begin, int end, FishPer *fishPers)
+{
+    int visible = begin;
+    for (int i = begin; i < end; ++i)
+    {
+        const FishPer &fish = fishPers[i];
+        if (culling::isSphereVisible(planes, fish.worldPosition, fish.scale * boundingRadius))
+        {
+            if (visible != i)
+            {
+                fishPers[visible] = fish;
+            }
+            ++visible;
+        }
+    }
+    return visible - begin;
+}
+
+int selectLod(const FishPer &fish, const float *eyePosition, const float *lodDistances, int numLods)
+{
+    float dx              = fish.worldPosition[0] - eyePosition[0];
+    float dy              = fish.worldPosition[1] - eyePosition[1];
+    float dz              = fish.worldPosition[2] - eyePosition[2];
+    float distanceSquared = dx * dx + dy * dy + dz * dz;
+
+    int lod = 0;
+    while (lod + 1 < numLods)
+    {
+        float lodDistance = lodDistances[lod + 1] * fish.scale;
+        if (distanceSquared < lodDistance * lodDistance)
+        {
+            break;
+        }
+        ++lod;
+    }
+    return lod;
+}
+}  // namespace fishKinematics
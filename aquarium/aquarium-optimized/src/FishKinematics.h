@@ -0,0 +1,96 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FishKinematics.h: Compute positions, next positions, scale and tail time of fish.
+// Per-fish parameters are kept as structure of arrays so that the update runs 8 fish
+// per step with AVX2 or 4 with SSE2. The kernel is picked at runtime from the features
+// of the CPU, with a scalar fallback. The trig mode trades accuracy of sin, cos and fmod
+// for speed.
+
+#pragma once
+#ifndef FISHKINEMATICS_H
+#define FISHKINEMATICS_H 1
+
+#include <vector>
+
+#include "FastMath.h"
+
+// Per-instance data of a fish. The layout matches the instance vertex buffer of the fish shaders.
+struct FishPer
+{
+    float worldPosition[3];
+    float scale;
+    float nextPosition[3];
+    float time;
+};
+
+// Random parameters of every fish of a species, one array per parameter.
+struct FishParams
+{
+    std::vector<float> speed;
+    std::vector<float> scale;
+    std::vector<float> xRadius;
+    std::vector<float> yRadius;
+    std::vector<float> zRadius;
+
+    void resize(int numFish);
+};
+
+// Parameters shared by every fish of a species in a frame.
+struct FishSpeciesState
+{
+    float clock;
+    float fishBaseClock;
+    float fishOffset;
+    float fishTailSpeed;
+    float fishHeight;
+    float fishXClock;
+    float fishYClock;
+    float fishZClock;
+    float tailOffsetMult;
+    TRIGMODE trigMode;
+};
+
+enum FISHKERNEL : short
+{
+    KERNELSCALAR,
+    KERNELSSE2,
+    KERNELAVX2,
+};
+
+namespace fishKinematics {
+// Fish records are allocated aligned to a cache line. Ranges split at multiples of kGrain fish
+// start on a cache line and a full AVX2 step, so threads updating them never share a line.
+constexpr int kGrain = 16;
+FishPer *allocateFishPers(int numFish);
+void freeFishPers(FishPer *fishPers);
+
+// Fastest kernel supported by the CPU.
+FISHKERNEL getKernel();
+const char *getKernelName(FISHKERNEL kernel);
+
+// Write fish [begin, end) of a species into fishPers, which is indexed by fish index.
+void update(const FishSpeciesState &state,
+            const FishParams &params,
+            int begin,
+            int end,
+            FishPer *fishPers);
+void update(FISHKERNEL kernel,
+            const FishSpeciesState &state,
+            const FishParams &params,
+            int begin,
+            int end,
+            FishPer *fishPers);
+
+// Test fish [begin, end) against the frustum planes, with a sphere of boundingRadius times the
+// fish scale, and move the visible ones to the front of the range in order. Returns their count.
+int cull(const float planes[6][4], float boundingRadius, int begin, int end, FishPer *fishPers);
+
+// Level of detail of a fish, the last level whose distance in lodDistances, times the scale of
+// the fish, is no farther than the fish is from the eye.
+int selectLod(const FishPer &fish, const float *eyePosition, const float *lodDistances, int numLods);
+}  // namespace fishKinematics
+
+#endif
@@ -11,9 +11,24 @@
 
 #include <string>
 
+#include "FishKinematics.h"
+#include "MeshSimplifier.h"
 #include "Model.h"
 #include "Texture.h"
 
+// Fish of one instanced draw. Larger counts are split into draws that each bind the instance
+// buffer at their first fish, so that instance indices stay small on every backend.
+constexpr int kMaxFishPerDraw = 65536;
+
+// Visible fish of a species in a frame, sorted by level of detail: lodCounts[0] fish of level 0
+// first in fishPers, then those of level 1 and so on.
+struct FishInstances
+{
+    const FishPer *fishPers;
+    int lodCounts[kMaxLods];
+    int numLods;
+};
+
 class FishModel : public Model
 {
   public:
@@ -22,14 +37,14 @@ class FishModel : public Model
     virtual void updateFishCommonUniforms(float fishLength,
                                           float fishBendAmount,
                                           float fishWaveLength) = 0;
-    virtual void updateFishPerUniforms(float x,
-                                       float y,
-                                       float z,
-                                       float nextX,
-                                       float nextY,
-                                       float nextZ,
-                                       float scale,
-                                       float time)              = 0;
+
+    // Fish are drawn instanced. The count fish of instances are uploaded in this one call per
+    // species and frame, so fishPers may be reused once it returns.
+    virtual void submitInstances(const FishInstances &instances, size_t count) = 0;
+
+    // Fish only read the view and projection of the frame, which the context binds once for
+    // every species.
+    void updatePerInstanceUniforms(ViewUniforms *viewUniforms) override {}
 };
 
 #endif
@@ -0,0 +1,95 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// GeometryArena.cpp: Append meshes to the arena and create its buffers through the context.
+
+#include "GeometryArena.h"
+
+#include <algorithm>
+
+#include "Buffer.h"
+#include "Context.h"
+
+GeometryArena::GeometryArena() : mVertexBuffer(nullptr), mIndexBuffers{nullptr, nullptr} {}
+
+GeometryArena::~GeometryArena()
+{
+    delete mVertexBuffer;
+    delete mIndexBuffers[INDEXUINT16];
+    delete mIndexBuffers[INDEXUINT32];
+}
+
+// Meshes of different strides share the buffer, so every mesh starts at a multiple of its own
+// stride and its base vertex counts in strides from the start of the buffer.
+int GeometryArena::addVertices(const std::vector<unsigned char> &vertices, int stride)
+{
+    int baseVertex = (static_cast<int>(mVertices.size()) + stride - 1) / stride;
+    mVertices.resize(static_cast<size_t>(baseVertex) * stride);
+    mVertices.insert(mVertices.end(), vertices.begin(), vertices.end());
+    return baseVertex;
+}
+
+void GeometryArena::addMesh(const std::vector<unsigned char> &vertices,
+                            int stride,
+                            const std::vector<unsigned short> &indices,
+                            GeometryRange *range)
+{
+    range->baseVertex  = addVertices(vertices, stride);
+    range->indexFormat = INDEXUINT16;
+    range->firstIndex  = static_cast<int>(mIndices16.size());
+    range->indexCount  = static_cast<int>(indices.size());
+    mIndices16.insert(mIndices16.end(), indices.begin(), indices.end());
+    mRanges.push_back(range);
+}
+
+void GeometryArena::addMesh(const std::vector<unsigned char> &vertices,
+                            int stride,
+                            const std::vector<unsigned int> &indices,
+                            GeometryRange *range)
+{
+    int numVertices = static_cast<int>(vertices.size()) / stride;
+    if (numVertices <= 65536)
+    {
+        std::vector<unsigned short> narrowed(indices.begin(), indices.end());
+        addMesh(vertices, stride, narrowed, range);
+        return;
+    }
+
+    range->baseVertex  = addVertices(vertices, stride);
+    range->indexFormat = INDEXUINT32;
+    range->firstIndex  = static_cast<int>(mIndices32.size());
+    range->indexCount  = static_cast<int>(indices.size());
+    mIndices32.insert(mIndices32.end(), indices.begin(), indices.end());
+    mRanges.push_back(range);
+}
+
+void GeometryArena::upload(Context *context)
+{
+    mVertexBuffer = context->createBuffer(1, mVertices, false);
+    if (!mIndices16.empty())
+    {
+        // Keep the size of the buffer a multiple of 4 bytes.
+        if (mIndices16.size() % 2 != 0)
+        {
+            mIndices16.push_back(0);
+        }
+        mIndexBuffers[INDEXUINT16] = context->createBuffer(1, mIndices16, true);
+    }
+    if (!mIndices32.empty())
+    {
+        mIndexBuffers[INDEXUINT32] = context->createBuffer(1, mIndices32, true);
+    }
+
+    for (GeometryRange *range : mRanges)
+    {
+        range->vertexBuffer = mVertexBuffer;
+        range->indexBuffer  = mIndexBuffers[range->indexFormat];
+    }
+
+    std::vector<unsigned char>().swap(mVertices);
+    std::vector<unsigned short>().swap(mIndices16);
+    std::vector<unsigned int>().swap(mIndices32);
+    mRanges.clear();
+}
@@ -0,0 +1,87 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// GeometryArena.h: Pack the vertices and indices of every mesh in the scene into one vertex
+// buffer and one index buffer per index format. Meshes keep indices relative to their first
+// vertex and are drawn with a base vertex, so 16 bit indices suffice for any mesh of up to
+// 65536 vertices wherever it lands in the arena.
+
+#pragma once
+#ifndef GEOMETRYARENA_H
+#define GEOMETRYARENA_H 1
+
+#include <vector>
+
+class Buffer;
+class Context;
+
+enum INDEXFORMAT : short
+{
+    INDEXUINT16,
+    INDEXUINT32
+};
+
+// Where a mesh lives in the arena. Buffers are set once the arena is uploaded.
+struct GeometryRange
+{
+    GeometryRange()
+        : vertexBuffer(nullptr),
+          indexBuffer(nullptr),
+          indexFormat(INDEXUINT16),
+          baseVertex(0),
+          firstIndex(0),
+          indexCount(0)
+    {
+    }
+
+    Buffer *vertexBuffer;
+    Buffer *indexBuffer;
+    INDEXFORMAT indexFormat;
+    int baseVertex;
+    int firstIndex;
+    int indexCount;
+};
+
+class GeometryArena
+{
+  public:
+    GeometryArena();
+    ~GeometryArena();
+
+    // Append a mesh with vertices of stride bytes, and describe it in range. The arena keeps
+    // range to fill in the buffers on upload.
+    void addMesh(const std::vector<unsigned char> &vertices,
+                 int stride,
+                 const std::vector<unsigned short> &indices,
+                 GeometryRange *range);
+    // Indices are narrowed to 16 bits when every vertex of the mesh can be reached with them.
+    void addMesh(const std::vector<unsigned char> &vertices,
+                 int stride,
+                 const std::vector<unsigned int> &indices,
+                 GeometryRange *range);
+
+    // Indices of the given format added so far.
+    int getIndexCount(INDEXFORMAT format) const
+    {
+        return static_cast<int>(format == INDEXUINT16 ? mIndices16.size() : mIndices32.size());
+    }
+
+    // Create the buffers of the meshes added so far and release their copies in memory.
+    // Meshes are not added afterwards.
+    void upload(Context *context);
+
+  private:
+    int addVertices(const std::vector<unsigned char> &vertices, int stride);
+
+    std::vector<unsigned char> mVertices;
+    std::vector<unsigned short> mIndices16;
+    std::vector<unsigned int> mIndices32;
+    std::vector<GeometryRange *> mRanges;
+
+    Buffer *mVertexBuffer;
+    Buffer *mIndexBuffers[2];
+};
+
+#endif
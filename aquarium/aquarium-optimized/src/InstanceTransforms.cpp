@@ -0,0 +1,95 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// InstanceTransforms.cpp: Implement the transforms of the placed instances of a model.
+
+#include "InstanceTransforms.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "AlignedMemory.h"
+#include "Matrix.h"
+
+InstanceTransforms::InstanceTransforms()
+    : mCount(0), mWorlds(nullptr), mWorldInverseTransposes(nullptr), mWorldViewProjections(nullptr)
+{
+}
+
+InstanceTransforms::~InstanceTransforms()
+{
+    freeMatrices(mWorlds);
+    freeMatrices(mWorldInverseTransposes);
+    freeMatrices(mWorldViewProjections);
+}
+
+// A matrix is 64 bytes, so every matrix of the arrays starts on a cache line.
+float *InstanceTransforms::allocateMatrices(int count)
+{
+    return static_cast<float *>(alignedMemory::allocate(16 * sizeof(float) * count));
+}
+
+void InstanceTransforms::freeMatrices(float *matrices)
+{
+    alignedMemory::release(matrices);
+}
+
+void InstanceTransforms::init(const std::vector<float> &worlds,
+                              const BoundingBox &box,
+                              bool billboard)
+{
+    freeMatrices(mWorlds);
+    freeMatrices(mWorldInverseTransposes);
+    freeMatrices(mWorldViewProjections);
+
+    mCount                  = static_cast<int>(worlds.size() / 16);
+    mWorlds                 = allocateMatrices(mCount);
+    mWorldInverseTransposes = allocateMatrices(mCount);
+    mWorldViewProjections   = allocateMatrices(mCount);
+    mScales.resize(mCount);
+    mBounds.resize(mCount);
+
+    float worldInverse[16];
+    for (int i = 0; i < mCount; ++i)
+    {
+        float *world = mWorlds + i * 16;
+        memcpy(world, worlds.data() + i * 16, 16 * sizeof(float));
+        matrix::inverse4(worldInverse, world);
+        matrix::transpose4(mWorldInverseTransposes + i * 16, worldInverse);
+
+        float scale = 0.0f;
+        for (int j = 0; j < 3; ++j)
+        {
+            float axis = world[j * 4] * world[j * 4] + world[j * 4 + 1] * world[j * 4 + 1] +
+                         world[j * 4 + 2] * world[j * 4 + 2];
+            scale = std::max(scale, axis);
+        }
+        mScales[i] = std::sqrt(scale);
+
+        if (billboard)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                mBounds[i].min[j] = box.min[j] + world[12 + j];
+                mBounds[i].max[j] = box.max[j] + world[12 + j];
+            }
+        }
+        else
+        {
+            culling::transformBox(box, world, &mBounds[i]);
+        }
+    }
+}
+
+void InstanceTransforms::updateWorldViewProjections(const float *viewProjection,
+                                                    const std::vector<int> &instances)
+{
+    for (int instance : instances)
+    {
+        matrix::mulMatrixMatrix4(mWorldViewProjections + instance * 16, mWorlds + instance * 16,
+                                 viewProjection);
+    }
+}
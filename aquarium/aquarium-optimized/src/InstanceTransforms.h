@@ -0,0 +1,62 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// InstanceTransforms.h: Define the transforms of the placed instances of a model. World matrices
+// never change after placement, so their inverse transpose, scale and bounds are computed once
+// at load. Matrices of every instance follow each other in arrays aligned to a cache line.
+
+#pragma once
+#ifndef INSTANCETRANSFORMS_H
+#define INSTANCETRANSFORMS_H 1
+
+#include <vector>
+
+#include "Culling.h"
+
+class InstanceTransforms
+{
+  public:
+    InstanceTransforms();
+    ~InstanceTransforms();
+    InstanceTransforms(const InstanceTransforms &) = delete;
+    InstanceTransforms &operator=(const InstanceTransforms &) = delete;
+
+    // Place instances at worlds, 16 floats each, and bound them with box in model space.
+    // Billboards face the camera from the translation of their world matrix, so their box is
+    // only moved by it.
+    void init(const std::vector<float> &worlds, const BoundingBox &box, bool billboard);
+
+    int size() const { return mCount; }
+    const float *getWorld(int instance) const { return mWorlds + instance * 16; }
+    const float *getWorldInverseTranspose(int instance) const
+    {
+        return mWorldInverseTransposes + instance * 16;
+    }
+    // Set by the last updateWorldViewProjections the instance was part of.
+    const float *getWorldViewProjection(int instance) const
+    {
+        return mWorldViewProjections + instance * 16;
+    }
+    // Longest axis of the world matrix, by which errors in model space grow in world space.
+    float getScale(int instance) const { return mScales[instance]; }
+    const BoundingBox &getBounds(int instance) const { return mBounds[instance]; }
+
+    // Multiply the world matrices of instances by viewProjection, in one pass over the arrays.
+    void updateWorldViewProjections(const float *viewProjection, const std::vector<int> &instances);
+
+  private:
+    static float *allocateMatrices(int count);
+    static void freeMatrices(float *matrices);
+
+    int mCount;
+    float *mWorlds;
+    float *mWorldInverseTransposes;
+    float *mWorldViewProjections;
+    std::vector<float> mScales;
+    // Boxes of the instances in world space.
+    std::vector<BoundingBox> mBounds;
+};
+
+#endif
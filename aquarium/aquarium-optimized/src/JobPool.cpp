@@ -0,0 +1,162 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// JobPool.cpp: Implement the worker threads and work stealing of JobPool.
+
+#include "JobPool.h"
+
+#include <algorithm>
+
+namespace {
+// Chunks dealt to every thread, so that stealing can even out uneven chunks.
+constexpr int kChunksPerThread = 4;
+}  // namespace
+
+JobPool::JobPool(int numThreads)
+    : mNumThreads(numThreads),
+      mGeneration(0),
+      mQuit(false),
+      mBody(nullptr),
+      mChunksLeft(0)
+{
+    if (mNumThreads <= 0)
+    {
+        mNumThreads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    mNumThreads = std::max(mNumThreads, 1);
+
+    for (int i = 0; i < mNumThreads; ++i)
+    {
+        mQueues.push_back(new Queue());
+    }
+    // Queue 0 belongs to the calling thread.
+    for (int i = 1; i < mNumThreads; ++i)
+    {
+        mThreads.push_back(std::thread(&JobPool::workerLoop, this, i));
+    }
+}
+
+JobPool::~JobPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mWakeCondition.notify_all();
+    for (auto &thread : mThreads)
+    {
+        thread.join();
+    }
+    for (auto queue : mQueues)
+    {
+        delete queue;
+    }
+}
+
+void JobPool::parallelFor(int begin,
+                          int end,
+                          int grain,
+                          const std::function<void(int, int)> &body)
+{
+    if (end <= begin)
+    {
+        return;
+    }
+    grain = std::max(grain, 1);
+    if (mNumThreads == 1 || end - begin <= grain)
+    {
+        body(begin, end);
+        return;
+    }
+
+    int range     = end - begin;
+    int chunkSize = range / (mNumThreads * kChunksPerThread);
+    chunkSize     = std::max((chunkSize + grain - 1) / grain * grain, grain);
+    int numChunks = (range + chunkSize - 1) / chunkSize;
+
+    mBody = &body;
+    mChunksLeft.store(numChunks);
+    for (int i = 0; i < numChunks; ++i)
+    {
+        int chunkBegin = begin + i * chunkSize;
+        int chunkEnd   = std::min(chunkBegin + chunkSize, end);
+        Queue *queue   = mQueues[i % mNumThreads];
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->chunks.push_back(std::make_pair(chunkBegin, chunkEnd));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        ++mGeneration;
+    }
+    mWakeCondition.notify_all();
+
+    runChunks(0);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDoneCondition.wait(lock, [this] { return mChunksLeft.load() == 0; });
+    mBody = nullptr;
+}
+
+void JobPool::workerLoop(int index)
+{
+    unsigned int generation = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWakeCondition.wait(lock, [&] { return mQuit || mGeneration != generation; });
+            if (mQuit)
+            {
+                return;
+            }
+            generation = mGeneration;
+        }
+        runChunks(index);
+    }
+}
+
+// Take the front chunk of the own queue, or steal the back chunk of another queue.
+bool JobPool::popChunk(int index, std::pair<int, int> *chunk)
+{
+    {
+        Queue *queue = mQueues[index];
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (!queue->chunks.empty())
+        {
+            *chunk = queue->chunks.front();
+            queue->chunks.pop_front();
+            return true;
+        }
+    }
+
+    for (int i = 1; i < mNumThreads; ++i)
+    {
+        Queue *queue = mQueues[(index + i) % mNumThreads];
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (!queue->chunks.empty())
+        {
+            *chunk = queue->chunks.back();
+            queue->chunks.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void JobPool::runChunks(int index)
+{
+    std::pair<int, int> chunk;
+    while (popChunk(index, &chunk))
+    {
+        (*mBody)(chunk.first, chunk.second);
+        if (mChunksLeft.fetch_sub(1) == 1)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mDoneCondition.notify_all();
+        }
+    }
+}
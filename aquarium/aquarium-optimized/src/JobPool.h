@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// JobPool.h: Define a pool of worker threads. parallelFor splits a range into chunks that are
+// dealt round robin to per-thread queues. A thread that runs out of chunks steals from the
+// back of the other queues, so uneven chunks do not leave threads idle.
+
+#pragma once
+#ifndef JOBPOOL_H
+#define JOBPOOL_H 1
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class JobPool
+{
+  public:
+    // numThreads counts the calling thread, which takes part in every parallelFor. 0 picks the
+    // number of hardware threads.
+    explicit JobPool(int numThreads);
+    ~JobPool();
+
+    int getNumThreads() const { return mNumThreads; }
+
+    // Run body(chunkBegin, chunkEnd) over [begin, end) and return once every chunk is done.
+    // Chunk boundaries are begin plus multiples of grain, so callers can keep chunks from
+    // sharing cache lines.
+    void parallelFor(int begin,
+                     int end,
+                     int grain,
+                     const std::function<void(int, int)> &body);
+
+  private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::pair<int, int>> chunks;
+    };
+
+    void workerLoop(int index);
+    bool popChunk(int index, std::pair<int, int> *chunk);
+    void runChunks(int index);
+
+    int mNumThreads;
+    std::vector<std::thread> mThreads;
+    std::vector<Queue *> mQueues;
+
+    std::mutex mMutex;
+    std::condition_variable mWakeCondition;
+    std::condition_variable mDoneCondition;
+    // Bumped for every parallelFor so that sleeping workers know there is new work.
+    unsigned int mGeneration;
+    bool mQuit;
+
+    const std::function<void(int, int)> *mBody;
+    std::atomic<int> mChunksLeft;
+};
+
+#endif
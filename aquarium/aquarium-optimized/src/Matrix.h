@@ -319,10 +319,38 @@ static void resetPseudoRandom()
     randomSeed_ = 0;
 }
 
+// Advance a caller-owned seed, so that threads can draw numbers independently.
+static double pseudoRandom(long long *seed)
+{
+    *seed = (134775813 * *seed + 1) % RANDOM_RANGE_;
+    return static_cast<double>(*seed) / static_cast<double>(RANDOM_RANGE_);
+}
+
 static double pseudoRandom()
 {
-    randomSeed_ = (134775813 * randomSeed_ + 1) % RANDOM_RANGE_;
-    return static_cast<double>(randomSeed_) / static_cast<double>(RANDOM_RANGE_);
+    return pseudoRandom(&randomSeed_);
+}
+
+// Seed after count calls of pseudoRandom from a reset seed. The generator is jumped ahead by
+// squaring its affine step, so any position of the sequence is reached in O(log count).
+static long long pseudoRandomSeedAt(long long count)
+{
+    // Unsigned products wrap modulo 2^64, which keeps them exact modulo RANDOM_RANGE_.
+    unsigned long long range   = static_cast<unsigned long long>(RANDOM_RANGE_);
+    unsigned long long add     = 0;
+    unsigned long long stepMul = 134775813;
+    unsigned long long stepAdd = 1;
+    while (count > 0)
+    {
+        if (count & 1)
+        {
+            add = (add * stepMul + stepAdd) % range;
+        }
+        stepAdd = ((stepMul + 1) * stepAdd) % range;
+        stepMul = (stepMul * stepMul) % range;
+        count >>= 1;
+    }
+    return static_cast<long long>(add);
 }
 
 template <typename T>
@@ -0,0 +1,408 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// MeshOptimizer.cpp: Tipsify and the overdraw cluster sort follow "Fast Triangle Reordering
+// for Vertex Locality and Reduced Overdraw", Sander et al. 2007.
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+namespace {
+// Simulate a FIFO cache of kCacheSize entries. Returns whether vertex was a miss.
+class FifoCache
+{
+  public:
+    explicit FifoCache(int numVertices) : mTimestamps(numVertices, -1), mTime(0) {}
+
+    bool access(int vertex)
+    {
+        int &timestamp = mTimestamps[vertex];
+        if (timestamp >= 0 && mTime - timestamp < meshOptimizer::kCacheSize)
+        {
+            return false;
+        }
+        timestamp = mTime++;
+        return true;
+    }
+
+    void flush() { mTime += meshOptimizer::kCacheSize; }
+
+  private:
+    std::vector<int> mTimestamps;
+    int mTime;
+};
+
+int countMisses(const unsigned int *indices, int numIndices, int numVertices)
+{
+    FifoCache cache(numVertices);
+    int misses = 0;
+    for (int i = 0; i < numIndices; ++i)
+    {
+        misses += cache.access(indices[i]) ? 1 : 0;
+    }
+    return misses;
+}
+
+// Triangles around every vertex, as offsets into a flat list.
+void buildAdjacency(const unsigned int *indices,
+                    int numIndices,
+                    int numVertices,
+                    std::vector<int> *offsets,
+                    std::vector<int> *triangles)
+{
+    offsets->assign(numVertices + 1, 0);
+    for (int i = 0; i < numIndices; ++i)
+    {
+        ++(*offsets)[indices[i] + 1];
+    }
+    for (int v = 0; v < numVertices; ++v)
+    {
+        (*offsets)[v + 1] += (*offsets)[v];
+    }
+    triangles->resize(numIndices);
+    std::vector<int> fill(offsets->begin(), offsets->end() - 1);
+    for (int i = 0; i < numIndices; ++i)
+    {
+        (*triangles)[fill[indices[i]]++] = i / 3;
+    }
+}
+}  // namespace
+
+namespace meshOptimizer {
+float getAcmr(const unsigned int *indices, int numIndices, int numVertices)
+{
+    if (numIndices < 3)
+    {
+        return 0.0f;
+    }
+    return static_cast<float>(countMisses(indices, numIndices, numVertices)) / (numIndices / 3);
+}
+
+float getAtvr(const unsigned int *indices, int numIndices, int numVertices)
+{
+    std::vector<bool> used(numVertices, false);
+    int numUsed = 0;
+    for (int i = 0; i < numIndices; ++i)
+    {
+        if (!used[indices[i]])
+        {
+            used[indices[i]] = true;
+            ++numUsed;
+        }
+    }
+    if (numUsed == 0)
+    {
+        return 0.0f;
+    }
+    return static_cast<float>(countMisses(indices, numIndices, numVertices)) / numUsed;
+}
+
+std::vector<int> weldVertices(const std::vector<VertexStream> &streams,
+                              int numVertices,
+                              unsigned int *indices,
+                              int numIndices)
+{
+    size_t vertexSize = 0;
+    for (const VertexStream &stream : streams)
+    {
+        vertexSize += stream.numComponents * sizeof(float);
+    }
+
+    // Vertices are compared by their bytes, so that only exact copies merge.
+    std::unordered_map<std::string, int> uniqueVertices;
+    std::vector<int> remap(numVertices);
+    std::vector<int> order;
+    std::string key(vertexSize, '\0');
+    for (int v = 0; v < numVertices; ++v)
+    {
+        size_t offset = 0;
+        for (const VertexStream &stream : streams)
+        {
+            size_t size = stream.numComponents * sizeof(float);
+            std::memcpy(&key[offset], stream.data + v * stream.numComponents, size);
+            offset += size;
+        }
+        auto inserted = uniqueVertices.insert(std::make_pair(key, static_cast<int>(order.size())));
+        if (inserted.second)
+        {
+            order.push_back(v);
+        }
+        remap[v] = inserted.first->second;
+    }
+
+    for (int i = 0; i < numIndices; ++i)
+    {
+        indices[i] = static_cast<unsigned int>(remap[indices[i]]);
+    }
+    return order;
+}
+
+void optimizeVertexCache(unsigned int *indices, int numIndices, int numVertices)
+{
+    int numTriangles = numIndices / 3;
+    if (numTriangles == 0)
+    {
+        return;
+    }
+
+    std::vector<int> offsets;
+    std::vector<int> adjacency;
+    buildAdjacency(indices, numTriangles * 3, numVertices, &offsets, &adjacency);
+
+    std::vector<int> liveTriangles(numVertices);
+    for (int v = 0; v < numVertices; ++v)
+    {
+        liveTriangles[v] = offsets[v + 1] - offsets[v];
+    }
+    std::vector<int> cacheTimes(numVertices, 0);
+    std::vector<bool> emitted(numTriangles, false);
+    std::vector<int> deadEnds;
+    std::vector<int> candidates;
+    std::vector<unsigned int> result;
+    result.reserve(numTriangles * 3);
+
+    int time   = kCacheSize + 1;
+    int cursor = 0;
+    int fan    = indices[0];
+    while (fan >= 0)
+    {
+        // Emit all triangles around the fanning vertex.
+        candidates.clear();
+        for (int i = offsets[fan]; i < offsets[fan + 1]; ++i)
+        {
+            int triangle = adjacency[i];
+            if (emitted[triangle])
+            {
+                continue;
+            }
+            emitted[triangle] = true;
+            for (int j = 0; j < 3; ++j)
+            {
+                int v = indices[triangle * 3 + j];
+                result.push_back(static_cast<unsigned int>(v));
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                --liveTriangles[v];
+                if (time - cacheTimes[v] > kCacheSize)
+                {
+                    cacheTimes[v] = time++;
+                }
+            }
+        }
+
+        // Continue with the candidate that will still be in the cache after its triangles are
+        // emitted and that entered the cache first.
+        int next     = -1;
+        int priority = -1;
+        for (int v : candidates)
+        {
+            if (liveTriangles[v] <= 0)
+            {
+                continue;
+            }
+            int p = 0;
+            if (time - cacheTimes[v] + 2 * liveTriangles[v] <= kCacheSize)
+            {
+                p = time - cacheTimes[v];
+            }
+            if (p > priority)
+            {
+                priority = p;
+                next     = v;
+            }
+        }
+
+        // At a dead end, go back to a recent vertex with triangles left, or scan for one.
+        while (next < 0 && !deadEnds.empty())
+        {
+            int v = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[v] > 0)
+            {
+                next = v;
+            }
+        }
+        while (next < 0 && cursor < numVertices)
+        {
+            if (liveTriangles[cursor] > 0)
+            {
+                next = cursor;
+            }
+            ++cursor;
+        }
+        fan = next;
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+}
+
+void optimizeOverdraw(unsigned int *indices,
+                      int numIndices,
+                      const float *positions,
+                      int positionComponents,
+                      int numVertices,
+                      float threshold)
+{
+    int numTriangles = numIndices / 3;
+    if (numTriangles < 2)
+    {
+        return;
+    }
+
+    // Start a cluster wherever the cache optimized order jumps to unconnected triangles, and
+    // also wherever the running miss rate of the cluster is already as good as the whole range.
+    // Clusters may be drawn in any order, so each starts with an empty cache.
+    float maxAcmr = getAcmr(indices, numTriangles * 3, numVertices) * threshold;
+    std::vector<int> clusterStarts;
+    FifoCache cache(numVertices);
+    int clusterMisses = 0;
+    int clusterSize   = 0;
+    for (int t = 0; t < numTriangles; ++t)
+    {
+        int misses = 0;
+        for (int j = 0; j < 3; ++j)
+        {
+            misses += cache.access(indices[t * 3 + j]) ? 1 : 0;
+        }
+        if (clusterSize == 0 || misses == 3)
+        {
+            clusterStarts.push_back(t);
+            clusterMisses = 0;
+            clusterSize   = 0;
+        }
+        clusterMisses += misses;
+        ++clusterSize;
+        if (static_cast<float>(clusterMisses) <= maxAcmr * clusterSize)
+        {
+            cache.flush();
+            clusterSize = 0;
+        }
+    }
+    int numClusters = static_cast<int>(clusterStarts.size());
+    clusterStarts.push_back(numTriangles);
+    if (numClusters < 2)
+    {
+        return;
+    }
+
+    // Sort clusters by how far out of the mesh center they face. Area weighted normals and
+    // centroids keep the sort stable for clusters of thin triangles.
+    float meshCenter[3] = {0.0f, 0.0f, 0.0f};
+    float meshArea      = 0.0f;
+    std::vector<float> clusterCenters(numClusters * 3, 0.0f);
+    std::vector<float> clusterNormals(numClusters * 3, 0.0f);
+    std::vector<float> clusterAreas(numClusters, 0.0f);
+    for (int c = 0; c < numClusters; ++c)
+    {
+        for (int t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+        {
+            const float *p0 = positions + indices[t * 3] * positionComponents;
+            const float *p1 = positions + indices[t * 3 + 1] * positionComponents;
+            const float *p2 = positions + indices[t * 3 + 2] * positionComponents;
+            float e1[3]     = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            float e2[3]     = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            float n[3]      = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2],
+                          e1[0] * e2[1] - e1[1] * e2[0]};
+            float area      = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int j = 0; j < 3; ++j)
+            {
+                float center = (p0[j] + p1[j] + p2[j]) / 3.0f;
+                clusterCenters[c * 3 + j] += center * area;
+                clusterNormals[c * 3 + j] += n[j];
+                meshCenter[j] += center * area;
+            }
+            clusterAreas[c] += area;
+            meshArea += area;
+        }
+    }
+    if (meshArea <= 0.0f)
+    {
+        return;
+    }
+    for (int j = 0; j < 3; ++j)
+    {
+        meshCenter[j] /= meshArea;
+    }
+
+    std::vector<float> keys(numClusters, 0.0f);
+    for (int c = 0; c < numClusters; ++c)
+    {
+        if (clusterAreas[c] <= 0.0f)
+        {
+            continue;
+        }
+        const float *n = &clusterNormals[c * 3];
+        float length   = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length <= 0.0f)
+        {
+            continue;
+        }
+        for (int j = 0; j < 3; ++j)
+        {
+            keys[c] += (clusterCenters[c * 3 + j] / clusterAreas[c] - meshCenter[j]) * n[j] / length;
+        }
+    }
+
+    std::vector<int> order(numClusters);
+    for (int c = 0; c < numClusters; ++c)
+    {
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&keys](int a, int b) { return keys[a] > keys[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(numTriangles * 3);
+    for (int c : order)
+    {
+        result.insert(result.end(), indices + clusterStarts[c] * 3,
+                      indices + clusterStarts[c + 1] * 3);
+    }
+    std::copy(result.begin(), result.end(), indices);
+}
+
+std::vector<int> optimizeVertexFetch(unsigned int *indices, int numIndices, int numVertices)
+{
+    std::vector<int> remap(numVertices, -1);
+    std::vector<int> order;
+    order.reserve(numVertices);
+    for (int i = 0; i < numIndices; ++i)
+    {
+        int &v = remap[indices[i]];
+        if (v < 0)
+        {
+            v = static_cast<int>(order.size());
+            order.push_back(indices[i]);
+        }
+        indices[i] = static_cast<unsigned int>(v);
+    }
+    for (int v = 0; v < numVertices; ++v)
+    {
+        if (remap[v] < 0)
+        {
+            remap[v] = static_cast<int>(order.size());
+            order.push_back(v);
+        }
+    }
+    return order;
+}
+
+void remapAttribute(const std::vector<int> &order, int numComponents, std::vector<float> *data)
+{
+    std::vector<float> result(order.size() * numComponents);
+    for (size_t v = 0; v < order.size(); ++v)
+    {
+        std::copy(data->begin() + order[v] * numComponents,
+                  data->begin() + (order[v] + 1) * numComponents,
+                  result.begin() + v * numComponents);
+    }
+    data->swap(result);
+}
+}  // namespace meshOptimizer
@@ -0,0 +1,64 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// MeshOptimizer.h: Reorder triangles and vertices of meshes at load time. Vertices that are
+// equal in every attribute are merged first, as the assets repeat them for every triangle and
+// the post-transform vertex cache only hits on shared vertices. Triangles are then
+// ordered for the post-transform vertex cache with Tipsify, then clusters of them are sorted
+// so that outward facing clusters draw first and hide the rest. Vertices are then renumbered
+// in the order triangles first use them, so that vertex fetch walks memory forward.
+
+#pragma once
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H 1
+
+#include <vector>
+
+namespace meshOptimizer {
+// An attribute with numComponents floats per vertex.
+struct VertexStream
+{
+    const float *data;
+    int numComponents;
+};
+
+// Entries of the FIFO cache the reorder aims for and the statistics simulate.
+constexpr int kCacheSize = 16;
+// Clusters for the overdraw sort may miss the cache this much more often than the whole mesh.
+constexpr float kOverdrawThreshold = 1.05f;
+
+// Average cache misses per triangle. Lower is better, 0.5 is ideal for large meshes.
+float getAcmr(const unsigned int *indices, int numIndices, int numVertices);
+// Average cache misses per referenced vertex. Lower is better, 1 is ideal.
+float getAtvr(const unsigned int *indices, int numIndices, int numVertices);
+
+// Point indices at the first of every set of vertices equal in all streams, and return the old
+// index of every vertex left, in their original order.
+std::vector<int> weldVertices(const std::vector<VertexStream> &streams,
+                              int numVertices,
+                              unsigned int *indices,
+                              int numIndices);
+
+void optimizeVertexCache(unsigned int *indices, int numIndices, int numVertices);
+
+// Split cache optimized triangles into clusters, keeping the miss rate within threshold times
+// that of the whole range, and sort the clusters front to back as seen from outside the mesh.
+void optimizeOverdraw(unsigned int *indices,
+                      int numIndices,
+                      const float *positions,
+                      int positionComponents,
+                      int numVertices,
+                      float threshold);
+
+// Renumber vertices in order of first use by indices, and return the old index of every new
+// vertex. Vertices that indices never use keep their relative order at the end.
+std::vector<int> optimizeVertexFetch(unsigned int *indices, int numIndices, int numVertices);
+
+// Reorder an attribute with numComponents floats per vertex by the result of weldVertices or
+// optimizeVertexFetch.
+void remapAttribute(const std::vector<int> &order, int numComponents, std::vector<float> *data);
+}  // namespace meshOptimizer
+
+#endif
@@ -0,0 +1,687 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// MeshSimplifier.cpp: Implement half edge collapse with quadric error metrics. A welded
+// position moves onto a neighbouring position, so no new vertices are made. Border positions
+// only slide along the border, and collapses that flip triangles or make the mesh non
+// manifold are skipped.
+
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <queue>
+#include <tuple>
+
+namespace {
+// Levels that keep more triangles than this share of the previous level are not worth a draw
+// call of their own.
+constexpr float kMinReduction = 0.8f;
+// Collapses may not turn a triangle by more than about 78 degrees.
+constexpr float kMinCosine = 0.2f;
+
+// Symmetric 4x4 matrix of the squared distance to a set of planes.
+struct Quadric
+{
+    double xx, xy, xz, xw, yy, yz, yw, zz, zw, ww;
+
+    Quadric() : xx(0), xy(0), xz(0), xw(0), yy(0), yz(0), yw(0), zz(0), zw(0), ww(0) {}
+
+    void addPlane(double a, double b, double c, double d)
+    {
+        xx += a * a;
+        xy += a * b;
+        xz += a * c;
+        xw += a * d;
+        yy += b * b;
+        yz += b * c;
+        yw += b * d;
+        zz += c * c;
+        zw += c * d;
+        ww += d * d;
+    }
+
+    void add(const Quadric &other)
+    {
+        xx += other.xx;
+        xy += other.xy;
+        xz += other.xz;
+        xw += other.xw;
+        yy += other.yy;
+        yz += other.yz;
+        yw += other.yw;
+        zz += other.zz;
+        zw += other.zw;
+        ww += other.ww;
+    }
+
+    double evaluate(const float *p) const
+    {
+        double x = p[0];
+        double y = p[1];
+        double z = p[2];
+        double result = xx * x * x + 2 * xy * x * y + 2 * xz * x * z + 2 * xw * x + yy * y * y +
+                        2 * yz * y * z + 2 * yw * y + zz * z * z + 2 * zw * z + ww;
+        return std::max(result, 0.0);
+    }
+};
+
+struct Collapse
+{
+    double cost;
+    int from;
+    int to;
+    unsigned int fromVersion;
+    unsigned int toVersion;
+
+    bool operator>(const Collapse &other) const { return cost > other.cost; }
+};
+
+void cross(const float *a, const float *b, const float *c, float *normal)
+{
+    float u[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    float v[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    normal[0]  = u[1] * v[2] - u[2] * v[1];
+    normal[1]  = u[2] * v[0] - u[0] * v[2];
+    normal[2]  = u[0] * v[1] - u[1] * v[0];
+}
+
+float dot(const float *a, const float *b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+float distanceSquared(const float *a, const float *b)
+{
+    float d[3] = {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+    return dot(d, d);
+}
+
+// Squared distance from p to the closest point of triangle abc.
+float distanceToTriangleSquared(const float *p, const float *a, const float *b, const float *c)
+{
+    float ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    float ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    float ap[3] = {p[0] - a[0], p[1] - a[1], p[2] - a[2]};
+    float d1    = dot(ab, ap);
+    float d2    = dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f)
+    {
+        return distanceSquared(p, a);
+    }
+    float bp[3] = {p[0] - b[0], p[1] - b[1], p[2] - b[2]};
+    float d3    = dot(ab, bp);
+    float d4    = dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3)
+    {
+        return distanceSquared(p, b);
+    }
+    float cp[3] = {p[0] - c[0], p[1] - c[1], p[2] - c[2]};
+    float d5    = dot(ab, cp);
+    float d6    = dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6)
+    {
+        return distanceSquared(p, c);
+    }
+
+    float vc = d1 * d4 - d3 * d2;
+    float vb = d5 * d2 - d1 * d6;
+    float va = d3 * d6 - d5 * d4;
+    float closest[3];
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+    {
+        float v = d1 / (d1 - d3);
+        for (int i = 0; i < 3; ++i)
+        {
+            closest[i] = a[i] + v * ab[i];
+        }
+    }
+    else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+    {
+        float w = d2 / (d2 - d6);
+        for (int i = 0; i < 3; ++i)
+        {
+            closest[i] = a[i] + w * ac[i];
+        }
+    }
+    else if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+    {
+        float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        for (int i = 0; i < 3; ++i)
+        {
+            closest[i] = b[i] + w * (c[i] - b[i]);
+        }
+    }
+    else
+    {
+        float denominator = 1.0f / (va + vb + vc);
+        float v           = vb * denominator;
+        float w           = vc * denominator;
+        for (int i = 0; i < 3; ++i)
+        {
+            closest[i] = a[i] + v * ab[i] + w * ac[i];
+        }
+    }
+    return distanceSquared(p, closest);
+}
+
+// Largest distance from a position of the full mesh to the surface of a level. The quadrics
+// only bound the distance of the level to the planes of the full mesh, which misses positions
+// left behind at the tips of thin features.
+float measureError(const SimplifierMesh &mesh, const unsigned int *indices, int numIndices)
+{
+    int numTriangles = numIndices / 3;
+    std::vector<float> spheres(numTriangles * 4);
+    for (int t = 0; t < numTriangles; ++t)
+    {
+        float *sphere = &spheres[t * 4];
+        sphere[3]     = 0.0f;
+        for (int j = 0; j < 3; ++j)
+        {
+            const float *p = mesh.positions + indices[t * 3 + j] * mesh.positionComponents;
+            for (int k = 0; k < 3; ++k)
+            {
+                sphere[k] = (j == 0 ? 0.0f : sphere[k]) + p[k] / 3.0f;
+            }
+        }
+        for (int j = 0; j < 3; ++j)
+        {
+            const float *p = mesh.positions + indices[t * 3 + j] * mesh.positionComponents;
+            sphere[3]      = std::max(sphere[3], std::sqrt(distanceSquared(sphere, p)));
+        }
+    }
+
+    std::map<std::tuple<float, float, float>, bool> measured;
+    float error       = 0.0f;
+    int startTriangle = 0;
+    for (int v = 0; v < mesh.numVertices; ++v)
+    {
+        const float *p = mesh.positions + v * mesh.positionComponents;
+        if (!measured.insert(std::make_pair(std::make_tuple(p[0], p[1], p[2]), true)).second)
+        {
+            continue;
+        }
+        // Start from the closest triangle of the previous vertex, which is usually close too,
+        // and skip triangles whose bounding sphere is farther than the best so far.
+        float best = FLT_MAX;
+        int start  = startTriangle;
+        for (int i = 0; i < numTriangles; ++i)
+        {
+            int t                = (start + i) % numTriangles;
+            const float *sphere  = &spheres[t * 4];
+            float centerDistance = std::sqrt(distanceSquared(p, sphere)) - sphere[3];
+            if (centerDistance > 0.0f && centerDistance * centerDistance >= best)
+            {
+                continue;
+            }
+            const unsigned int *triangle = indices + t * 3;
+            float distance                 = distanceToTriangleSquared(
+                p, mesh.positions + triangle[0] * mesh.positionComponents,
+                mesh.positions + triangle[1] * mesh.positionComponents,
+                mesh.positions + triangle[2] * mesh.positionComponents);
+            if (distance < best)
+            {
+                best          = distance;
+                startTriangle = t;
+            }
+        }
+        error = std::max(error, best);
+    }
+    return std::sqrt(error);
+}
+
+class Simplifier
+{
+  public:
+    explicit Simplifier(const SimplifierMesh &mesh);
+
+    // Collapse down to targetIndexCount and return the triangles left. Later runs with lower
+    // targets continue from there.
+    std::vector<unsigned int> run(int targetIndexCount, float maxError, float *resultError);
+
+  private:
+    int getPosition(int vertex) const { return mVertexPositions[vertex]; }
+    const float *getPoint(int position) const { return mPoints[position].data(); }
+    bool hasPosition(int triangle, int position) const;
+    void getNeighbours(int position, std::vector<int> *neighbours) const;
+    int countEdgeTriangles(int from, int to) const;
+    bool isValid(int from, int to) const;
+    int pickWedge(int vertex, int position) const;
+    void collapse(int from, int to);
+    void pushCollapses(int position);
+    void pushCollapse(int from, int to);
+
+    const SimplifierMesh &mMesh;
+    std::vector<int> mVertexPositions;
+    std::vector<std::vector<float>> mPoints;
+    // Vertices that share a position.
+    std::vector<std::vector<int>> mWedges;
+    std::vector<std::vector<int>> mPositionTriangles;
+    std::vector<Quadric> mQuadrics;
+    std::vector<bool> mBorder;
+    std::vector<bool> mLocked;
+    std::vector<bool> mPositionAlive;
+    std::vector<unsigned int> mVersions;
+
+    std::vector<int> mTriangles;
+    std::vector<bool> mTriangleAlive;
+    int mLiveTriangles;
+
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> mQueue;
+};
+
+Simplifier::Simplifier(const SimplifierMesh &mesh) : mMesh(mesh), mLiveTriangles(0)
+{
+    std::map<std::tuple<float, float, float>, int> positionMap;
+    mVertexPositions.resize(mesh.numVertices);
+    for (int v = 0; v < mesh.numVertices; ++v)
+    {
+        const float *p = mesh.positions + v * mesh.positionComponents;
+        auto key       = std::make_tuple(p[0], p[1], p[2]);
+        auto found     = positionMap.find(key);
+        if (found == positionMap.end())
+        {
+            int position     = static_cast<int>(mPoints.size());
+            positionMap[key] = position;
+            mPoints.push_back(std::vector<float>(p, p + 3));
+            mWedges.push_back(std::vector<int>());
+            mVertexPositions[v] = position;
+        }
+        else
+        {
+            mVertexPositions[v] = found->second;
+        }
+        mWedges[mVertexPositions[v]].push_back(v);
+    }
+
+    int numPositions = static_cast<int>(mPoints.size());
+    mPositionTriangles.resize(numPositions);
+    mQuadrics.resize(numPositions);
+    mBorder.assign(numPositions, false);
+    mLocked.assign(numPositions, false);
+    mPositionAlive.assign(numPositions, true);
+    mVersions.assign(numPositions, 0);
+
+    // Drop triangles that are degenerate already, and count the triangles of every edge.
+    std::map<std::pair<int, int>, int> edgeTriangles;
+    for (int i = 0; i + 2 < mesh.numIndices; i += 3)
+    {
+        int a = getPosition(mesh.indices[i]);
+        int b = getPosition(mesh.indices[i + 1]);
+        int c = getPosition(mesh.indices[i + 2]);
+        if (a == b || b == c || c == a)
+        {
+            continue;
+        }
+        int triangle = static_cast<int>(mTriangles.size()) / 3;
+        mTriangles.push_back(mesh.indices[i]);
+        mTriangles.push_back(mesh.indices[i + 1]);
+        mTriangles.push_back(mesh.indices[i + 2]);
+        mTriangleAlive.push_back(true);
+        ++mLiveTriangles;
+
+        int corners[3] = {a, b, c};
+        float normal[3];
+        cross(getPoint(a), getPoint(b), getPoint(c), normal);
+        float length = std::sqrt(dot(normal, normal));
+        if (length > 0.0f)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                normal[j] /= length;
+            }
+        }
+        float d = -dot(normal, getPoint(a));
+        for (int j = 0; j < 3; ++j)
+        {
+            mPositionTriangles[corners[j]].push_back(triangle);
+            mQuadrics[corners[j]].addPlane(normal[0], normal[1], normal[2], d);
+            int from = corners[j];
+            int to   = corners[(j + 1) % 3];
+            ++edgeTriangles[std::make_pair(std::min(from, to), std::max(from, to))];
+        }
+    }
+
+    // Keep borders in place with planes through the border edges, perpendicular to their
+    // triangles. Positions on edges shared by more than two triangles never move.
+    for (int t = 0; t < static_cast<int>(mTriangleAlive.size()); ++t)
+    {
+        int corners[3] = {getPosition(mTriangles[t * 3]), getPosition(mTriangles[t * 3 + 1]),
+                          getPosition(mTriangles[t * 3 + 2])};
+        float normal[3];
+        cross(getPoint(corners[0]), getPoint(corners[1]), getPoint(corners[2]), normal);
+        for (int j = 0; j < 3; ++j)
+        {
+            int from  = corners[j];
+            int to    = corners[(j + 1) % 3];
+            int count = edgeTriangles[std::make_pair(std::min(from, to), std::max(from, to))];
+            if (count > 2)
+            {
+                mLocked[from] = true;
+                mLocked[to]   = true;
+            }
+            if (count != 1)
+            {
+                continue;
+            }
+            mBorder[from] = true;
+            mBorder[to]   = true;
+
+            const float *p = getPoint(from);
+            const float *q = getPoint(to);
+            float edge[3]  = {q[0] - p[0], q[1] - p[1], q[2] - p[2]};
+            float plane[3] = {edge[1] * normal[2] - edge[2] * normal[1],
+                              edge[2] * normal[0] - edge[0] * normal[2],
+                              edge[0] * normal[1] - edge[1] * normal[0]};
+            float length   = std::sqrt(dot(plane, plane));
+            if (length == 0.0f)
+            {
+                continue;
+            }
+            for (int k = 0; k < 3; ++k)
+            {
+                plane[k] /= length;
+            }
+            float d = -dot(plane, p);
+            mQuadrics[from].addPlane(plane[0], plane[1], plane[2], d);
+            mQuadrics[to].addPlane(plane[0], plane[1], plane[2], d);
+        }
+    }
+
+    for (int position = 0; position < numPositions; ++position)
+    {
+        pushCollapses(position);
+    }
+}
+
+bool Simplifier::hasPosition(int triangle, int position) const
+{
+    for (int j = 0; j < 3; ++j)
+    {
+        if (getPosition(mTriangles[triangle * 3 + j]) == position)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Simplifier::getNeighbours(int position, std::vector<int> *neighbours) const
+{
+    neighbours->clear();
+    for (int triangle : mPositionTriangles[position])
+    {
+        if (!mTriangleAlive[triangle] || !hasPosition(triangle, position))
+        {
+            continue;
+        }
+        for (int j = 0; j < 3; ++j)
+        {
+            int other = getPosition(mTriangles[triangle * 3 + j]);
+            if (other != position &&
+                std::find(neighbours->begin(), neighbours->end(), other) == neighbours->end())
+            {
+                neighbours->push_back(other);
+            }
+        }
+    }
+}
+
+int Simplifier::countEdgeTriangles(int from, int to) const
+{
+    int count = 0;
+    for (int triangle : mPositionTriangles[from])
+    {
+        if (mTriangleAlive[triangle] && hasPosition(triangle, from) && hasPosition(triangle, to))
+        {
+            ++count;
+        }
+    }
+    return count;
+}
+
+bool Simplifier::isValid(int from, int to) const
+{
+    if (mLocked[from])
+    {
+        return false;
+    }
+    int edgeTriangles = countEdgeTriangles(from, to);
+    if (edgeTriangles == 0)
+    {
+        return false;
+    }
+    if (mBorder[from] && (!mBorder[to] || edgeTriangles != 1))
+    {
+        return false;
+    }
+
+    // Positions next to both ends must be the third corners of the triangles on the edge,
+    // otherwise the collapse pinches the surface.
+    std::vector<int> fromNeighbours;
+    std::vector<int> toNeighbours;
+    getNeighbours(from, &fromNeighbours);
+    getNeighbours(to, &toNeighbours);
+    int shared = 0;
+    for (int neighbour : fromNeighbours)
+    {
+        if (std::find(toNeighbours.begin(), toNeighbours.end(), neighbour) != toNeighbours.end())
+        {
+            ++shared;
+        }
+    }
+    if (shared != edgeTriangles)
+    {
+        return false;
+    }
+
+    for (int triangle : mPositionTriangles[from])
+    {
+        if (!mTriangleAlive[triangle] || !hasPosition(triangle, from) ||
+            hasPosition(triangle, to))
+        {
+            continue;
+        }
+        const float *before[3];
+        const float *after[3];
+        for (int j = 0; j < 3; ++j)
+        {
+            int position = getPosition(mTriangles[triangle * 3 + j]);
+            before[j]    = getPoint(position);
+            after[j]     = position == from ? getPoint(to) : before[j];
+        }
+        float normalBefore[3];
+        float normalAfter[3];
+        cross(before[0], before[1], before[2], normalBefore);
+        cross(after[0], after[1], after[2], normalAfter);
+        float lengths = std::sqrt(dot(normalBefore, normalBefore) * dot(normalAfter, normalAfter));
+        if (lengths == 0.0f || dot(normalBefore, normalAfter) < kMinCosine * lengths)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Copy of position whose normal and texture coordinates are closest to those of vertex.
+int Simplifier::pickWedge(int vertex, int position) const
+{
+    int best        = mWedges[position][0];
+    float bestScore = 0.0f;
+    for (size_t i = 0; i < mWedges[position].size(); ++i)
+    {
+        int wedge   = mWedges[position][i];
+        float score = 0.0f;
+        if (mMesh.normals != nullptr)
+        {
+            const float *a = mMesh.normals + vertex * mMesh.normalComponents;
+            const float *b = mMesh.normals + wedge * mMesh.normalComponents;
+            for (int j = 0; j < mMesh.normalComponents; ++j)
+            {
+                score += (a[j] - b[j]) * (a[j] - b[j]);
+            }
+        }
+        if (mMesh.texCoords != nullptr)
+        {
+            const float *a = mMesh.texCoords + vertex * mMesh.texCoordComponents;
+            const float *b = mMesh.texCoords + wedge * mMesh.texCoordComponents;
+            for (int j = 0; j < mMesh.texCoordComponents; ++j)
+            {
+                score += (a[j] - b[j]) * (a[j] - b[j]);
+            }
+        }
+        if (i == 0 || score < bestScore)
+        {
+            best      = wedge;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+void Simplifier::collapse(int from, int to)
+{
+    for (int triangle : mPositionTriangles[from])
+    {
+        if (!mTriangleAlive[triangle] || !hasPosition(triangle, from))
+        {
+            continue;
+        }
+        if (hasPosition(triangle, to))
+        {
+            mTriangleAlive[triangle] = false;
+            --mLiveTriangles;
+            continue;
+        }
+        for (int j = 0; j < 3; ++j)
+        {
+            int &vertex = mTriangles[triangle * 3 + j];
+            if (getPosition(vertex) == from)
+            {
+                vertex = pickWedge(vertex, to);
+            }
+        }
+        mPositionTriangles[to].push_back(triangle);
+    }
+    mPositionTriangles[from].clear();
+    mPositionAlive[from] = false;
+    mQuadrics[to].add(mQuadrics[from]);
+    ++mVersions[to];
+    pushCollapses(to);
+}
+
+void Simplifier::pushCollapses(int position)
+{
+    std::vector<int> neighbours;
+    getNeighbours(position, &neighbours);
+    for (int neighbour : neighbours)
+    {
+        pushCollapse(position, neighbour);
+        pushCollapse(neighbour, position);
+    }
+}
+
+void Simplifier::pushCollapse(int from, int to)
+{
+    Quadric quadric = mQuadrics[from];
+    quadric.add(mQuadrics[to]);
+    Collapse collapse;
+    collapse.cost        = quadric.evaluate(getPoint(to));
+    collapse.from        = from;
+    collapse.to          = to;
+    collapse.fromVersion = mVersions[from];
+    collapse.toVersion   = mVersions[to];
+    mQueue.push(collapse);
+}
+
+std::vector<unsigned int> Simplifier::run(int targetIndexCount,
+                                          float maxError,
+                                          float *resultError)
+{
+    double maxCost = static_cast<double>(maxError) * maxError;
+    double error   = 0.0;
+    while (mLiveTriangles * 3 > targetIndexCount && !mQueue.empty())
+    {
+        Collapse next = mQueue.top();
+        if (next.cost > maxCost)
+        {
+            break;
+        }
+        mQueue.pop();
+        if (!mPositionAlive[next.from] || !mPositionAlive[next.to] ||
+            next.fromVersion != mVersions[next.from] || next.toVersion != mVersions[next.to] ||
+            !isValid(next.from, next.to))
+        {
+            continue;
+        }
+        collapse(next.from, next.to);
+        error = std::max(error, next.cost);
+    }
+
+    std::vector<unsigned int> indices;
+    for (size_t triangle = 0; triangle < mTriangleAlive.size(); ++triangle)
+    {
+        if (mTriangleAlive[triangle])
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                indices.push_back(static_cast<unsigned int>(mTriangles[triangle * 3 + j]));
+            }
+        }
+    }
+    *resultError = static_cast<float>(std::sqrt(error));
+    return indices;
+}
+}  // namespace
+
+namespace meshSimplifier {
+std::vector<unsigned int> simplify(const SimplifierMesh &mesh,
+                                   int targetIndexCount,
+                                   float maxError,
+                                   float *resultError)
+{
+    Simplifier simplifier(mesh);
+    return simplifier.run(targetIndexCount, maxError, resultError);
+}
+
+void buildLods(const SimplifierMesh &mesh,
+               int maxLevels,
+               float maxError,
+               std::vector<unsigned int> *indices,
+               std::vector<LodLevel> *lods)
+{
+    lods->clear();
+    LodLevel full = {static_cast<int>(indices->size()), mesh.numIndices, 0.0f};
+    indices->insert(indices->end(), mesh.indices, mesh.indices + mesh.numIndices);
+    lods->push_back(full);
+    if (maxLevels <= 0)
+    {
+        return;
+    }
+
+    // One simplifier collapses to every target in turn, so each level continues the collapses
+    // of the previous one instead of starting over from the full mesh.
+    Simplifier simplifier(mesh);
+    for (int level = 1; level <= maxLevels; ++level)
+    {
+        const LodLevel &previous = lods->back();
+        int target               = previous.indexCount / 6 * 3;
+        float error              = 0.0f;
+        std::vector<unsigned int> result = simplifier.run(target, maxError, &error);
+        if (result.empty() || result.size() > previous.indexCount * kMinReduction)
+        {
+            break;
+        }
+        error = std::max(error, measureError(mesh, result.data(), static_cast<int>(result.size())));
+        LodLevel lod = {static_cast<int>(indices->size()), static_cast<int>(result.size()),
+                        std::max(error, previous.error)};
+        indices->insert(indices->end(), result.begin(), result.end());
+        lods->push_back(lod);
+    }
+}
+}  // namespace meshSimplifier
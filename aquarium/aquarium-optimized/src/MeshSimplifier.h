@@ -0,0 +1,61 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// MeshSimplifier.h: Build levels of detail of a mesh by quadric error edge collapse.
+// Vertices are welded by position, so that the many copies of a position with different
+// normals or texture coordinates collapse together. Every level indexes the vertices of the
+// full mesh, so levels only need their own index range.
+
+#pragma once
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H 1
+
+#include <vector>
+
+// Levels of detail of a model at most, including the full mesh.
+constexpr int kMaxLods = 4;
+
+// A level of detail of a model. error is the largest distance, in model space, that the
+// surface of the level may be from the full mesh.
+struct LodLevel
+{
+    int firstIndex;
+    int indexCount;
+    float error;
+};
+
+struct SimplifierMesh
+{
+    const float *positions;
+    int positionComponents;
+    // Optional. Pick the copy of a position whose attributes are closest after a collapse.
+    const float *normals;
+    int normalComponents;
+    const float *texCoords;
+    int texCoordComponents;
+    int numVertices;
+    const unsigned int *indices;
+    int numIndices;
+};
+
+namespace meshSimplifier {
+// Collapse edges until at most targetIndexCount indices are left or the next collapse would
+// move the surface by more than maxError. The error of the result is written to *resultError.
+std::vector<unsigned int> simplify(const SimplifierMesh &mesh,
+                                   int targetIndexCount,
+                                   float maxError,
+                                   float *resultError);
+
+// Append up to maxLevels coarser levels to indices, each with about half of the triangles of
+// the previous one, and describe all levels, starting with the full mesh, in lods. Levels stop
+// when they no longer save enough triangles within maxError.
+void buildLods(const SimplifierMesh &mesh,
+               int maxLevels,
+               float maxError,
+               std::vector<unsigned int> *indices,
+               std::vector<LodLevel> *lods);
+}  // namespace meshSimplifier
+
+#endif
@@ -8,10 +8,12 @@
 #include "Model.h"
 
 Model::Model()
-    : mProgram(nullptr),
+    : boundingRadius(0.0f),
+    mProgram(nullptr),
     mType(GROUPMAX),
     mName(MODELMAX),
-    mBlend(false)
+    mBlend(false),
+    mLod(0)
 {
 }
 
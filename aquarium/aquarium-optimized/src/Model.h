@@ -19,8 +19,13 @@
 #include "Aquarium.h"
 #include "Buffer.h"
 #include "Context.h"
+#include "Culling.h"
+#include "GeometryArena.h"
+#include "InstanceTransforms.h"
+#include "MeshSimplifier.h"
 #include "Program.h"
 #include "Texture.h"
+#include "VertexLayout.h"
 
 class Aquarium;
 class Program;
@@ -37,23 +42,45 @@ class Model
   public:
     Model();
     Model(MODELGROUP type, MODELNAME name, bool blend)
-        : mType(type), mName(name), mBlend(blend), mProgram(nullptr){};
+        : boundingRadius(0.0f),
+          mType(type),
+          mName(name),
+          mBlend(blend),
+          mProgram(nullptr),
+          mLod(0){};
     virtual ~Model();
     virtual void preDraw() const     = 0;
     virtual void updatePerInstanceUniforms(ViewUniforms* viewUniforms) = 0;
+    // Index in transforms of the instance updated next. Culled instances are skipped, so
+    // models that vary per instance key on this rather than on the order of updates.
+    virtual void setInstanceIndex(int index) {}
+    // Level of detail of the instances updated and drawn next.
+    void setLod(int lod) { mLod = lod; }
     virtual void draw() = 0;
 
     void setProgram(Program *program);
+    Program *getProgram() const { return mProgram; }
+    bool getBlend() const { return mBlend; }
     virtual void init() = 0;
 
-    std::vector<std::vector<float>> worldmatrices;
+    // Placed instances of the model.
+    InstanceTransforms transforms;
     std::unordered_map<std::string, Texture *> textureMap;
     std::unordered_map<std::string, Buffer *> bufferMap;
+    // Bounds of the vertices in model space. The sphere is centered on the model origin.
+    BoundingBox boundingBox;
+    float boundingRadius;
+    // Ranges of the index buffer for every level of detail, starting with the full mesh.
+    std::vector<LodLevel> lods;
+    // Vertices and indices of the model in the geometry arena, and their layout.
+    GeometryRange geometry;
+    VertexLayout vertexLayout;
 
   protected:
     Program *mProgram;
     bool mBlend;
     MODELNAME mName;
+    int mLod;
 
   private:
     MODELGROUP mType;
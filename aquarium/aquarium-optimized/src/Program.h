@@ -27,6 +27,8 @@ class Program
     }
     virtual ~Program(){};
     virtual void setProgram();
+    const std::string &getVertexShader() const { return vId; }
+    const std::string &getFragmentShader() const { return fId; }
 
   protected:
     std::string vId;
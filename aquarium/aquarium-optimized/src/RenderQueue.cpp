@@ -0,0 +1,184 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// RenderQueue.cpp: Build the sort keys of draws, and sort them with a least significant digit
+// radix sort over bytes of the key.
+
+#include "RenderQueue.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#include "ASSERT.h"
+#include "Model.h"
+
+namespace {
+// Bits of the fields of the key, from the most significant one.
+constexpr int kPassBits     = 2;
+constexpr int kBlendBits    = 1;
+constexpr int kProgramBits  = 8;
+constexpr int kMaterialBits = 10;
+constexpr int kModelBits    = 8;
+constexpr int kLodBits      = 3;
+constexpr int kDepthBits    = 32;
+
+constexpr int kLodShift      = kDepthBits;
+constexpr int kModelShift    = kLodShift + kLodBits;
+constexpr int kMaterialShift = kModelShift + kModelBits;
+constexpr int kProgramShift  = kMaterialShift + kMaterialBits;
+constexpr int kBlendShift    = kProgramShift + kProgramBits;
+constexpr int kPassShift     = kBlendShift + kBlendBits;
+static_assert(kPassShift + kPassBits == 64, "Fields of the sort key fill 64 bits.");
+
+constexpr uint64_t fieldMask(int bits, int shift)
+{
+    return ((uint64_t(1) << bits) - 1) << shift;
+}
+
+constexpr uint64_t kProgramMask =
+    fieldMask(kPassBits, kPassShift) | fieldMask(kProgramBits, kProgramShift);
+constexpr uint64_t kTextureMask = kProgramMask | fieldMask(kMaterialBits, kMaterialShift);
+constexpr uint64_t kPipelineMask = kProgramMask | fieldMask(kBlendBits, kBlendShift);
+
+constexpr int kRadixBits    = 8;
+constexpr int kRadixBuckets = 1 << kRadixBits;
+}  // namespace
+
+RenderQueue::RenderQueue()
+{
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+void RenderQueue::clear()
+{
+    mPackets.clear();
+}
+
+const RenderQueue::ModelState &RenderQueue::getModelState(const Model *model)
+{
+    auto it = mModelStates.find(model);
+    if (it != mModelStates.end())
+    {
+        return it->second;
+    }
+
+    // Models are told apart by program and diffuse texture, the state every backend binds per
+    // model.
+    const void *program  = model->getProgram();
+    const void *material = nullptr;
+    auto texture         = model->textureMap.find("diffuse");
+    if (texture != model->textureMap.end())
+    {
+        material = texture->second;
+    }
+
+    ModelState state;
+    state.program  = mPrograms.emplace(program, mPrograms.size()).first->second;
+    state.material = mMaterials.emplace(material, mMaterials.size()).first->second;
+    state.model    = mModelStates.size();
+    ASSERT(state.program < (uint64_t(1) << kProgramBits));
+    ASSERT(state.material < (uint64_t(1) << kMaterialBits));
+    ASSERT(state.model < (uint64_t(1) << kModelBits));
+
+    return mModelStates.emplace(model, state).first->second;
+}
+
+void RenderQueue::push(RENDERPASS pass, Model *model, int instance, int lod, float depth)
+{
+    const ModelState &state = getModelState(model);
+    bool blend              = model->getBlend();
+    ASSERT(lod >= 0 && lod < (1 << kLodBits));
+
+    // Bits of a positive float sort as the float does. Inverting them sorts far to near.
+    uint32_t depthBits;
+    depth = depth > 0.0f ? depth : 0.0f;
+    memcpy(&depthBits, &depth, sizeof(depthBits));
+    if (blend)
+    {
+        depthBits = ~depthBits;
+    }
+
+    DrawPacket packet;
+    packet.key = static_cast<uint64_t>(pass) << kPassShift |
+                 static_cast<uint64_t>(blend) << kBlendShift | state.program << kProgramShift |
+                 state.material << kMaterialShift | state.model << kModelShift |
+                 static_cast<uint64_t>(lod) << kLodShift | depthBits;
+    packet.model    = model;
+    packet.instance = instance;
+    packet.lod      = lod;
+    mPackets.push_back(packet);
+}
+
+RENDERPASS RenderQueue::getPass(const DrawPacket &packet)
+{
+    return static_cast<RENDERPASS>(packet.key >> kPassShift);
+}
+
+uint64_t RenderQueue::getModelKey(const DrawPacket &packet)
+{
+    return packet.key >> kModelShift;
+}
+
+void RenderQueue::countSwitches(int *programSwitches,
+                                int *textureSwitches,
+                                int *pipelineSwitches) const
+{
+    *programSwitches  = 0;
+    *textureSwitches  = 0;
+    *pipelineSwitches = 0;
+    for (size_t i = 0; i < mPackets.size(); ++i)
+    {
+        uint64_t key      = mPackets[i].key;
+        uint64_t previous = i > 0 ? mPackets[i - 1].key : ~key;
+        *programSwitches += (key & kProgramMask) != (previous & kProgramMask);
+        *textureSwitches += (key & kTextureMask) != (previous & kTextureMask);
+        *pipelineSwitches += (key & kPipelineMask) != (previous & kPipelineMask);
+    }
+}
+
+// Every pass moves the packets by one byte of the key, keeping the order of the previous passes
+// among equal bytes. Bytes that are the same in every key are skipped.
+void RenderQueue::sort()
+{
+    int programSwitches;
+    int textureSwitches;
+    int pipelineSwitches;
+    countSwitches(&programSwitches, &textureSwitches, &pipelineSwitches);
+
+    mSorted.resize(mPackets.size());
+    for (int shift = 0; shift < 64; shift += kRadixBits)
+    {
+        size_t counts[kRadixBuckets] = {};
+        for (const DrawPacket &packet : mPackets)
+        {
+            ++counts[(packet.key >> shift) & (kRadixBuckets - 1)];
+        }
+        if (mPackets.empty() ||
+            counts[(mPackets[0].key >> shift) & (kRadixBuckets - 1)] == mPackets.size())
+        {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (size_t &count : counts)
+        {
+            size_t bucketSize = count;
+            count             = offset;
+            offset += bucketSize;
+        }
+        for (const DrawPacket &packet : mPackets)
+        {
+            mSorted[counts[(packet.key >> shift) & (kRadixBuckets - 1)]++] = packet;
+        }
+        mPackets.swap(mSorted);
+    }
+
+    countSwitches(&mStats.programSwitches, &mStats.textureSwitches, &mStats.pipelineSwitches);
+    mStats.savedProgramSwitches  = programSwitches - mStats.programSwitches;
+    mStats.savedTextureSwitches  = textureSwitches - mStats.textureSwitches;
+    mStats.savedPipelineSwitches = pipelineSwitches - mStats.pipelineSwitches;
+}
@@ -0,0 +1,93 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// RenderQueue.h: Define the queue of draws of a frame. Models push a packet for every draw,
+// keyed by pass, blend, program, material, model, level of detail and depth. The queue is radix
+// sorted on the key before the context submits it, so that draws sharing state are adjacent.
+
+#pragma once
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H 1
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class Model;
+
+// Passes are drawn in order whatever their state. Props are drawn before the fish, and the
+// globe, seaweed and environment after them, so that the blended globe covers the fish behind it.
+enum RENDERPASS : short
+{
+    RENDERPASSBACKGROUND,
+    RENDERPASSFISH,
+    RENDERPASSFOREGROUND,
+    RENDERPASSMAX
+};
+
+// Instance of packets that draw all instances of the model at once, as fish do.
+constexpr int kInstancedDraw = -1;
+
+struct DrawPacket
+{
+    uint64_t key;
+    Model *model;
+    int instance;
+    int lod;
+};
+
+// State switches between consecutive draws of a frame, and those saved by sorting the queue
+// against the order the draws were pushed in.
+struct RenderQueueStats
+{
+    int programSwitches;
+    int textureSwitches;
+    int pipelineSwitches;
+    int savedProgramSwitches;
+    int savedTextureSwitches;
+    int savedPipelineSwitches;
+};
+
+class RenderQueue
+{
+  public:
+    RenderQueue();
+
+    void clear();
+    // Queue a draw of instance of model at level lod, depth away from the eye. Opaque draws go
+    // front to back, and blended ones back to front.
+    void push(RENDERPASS pass, Model *model, int instance, int lod, float depth);
+    void sort();
+
+    static RENDERPASS getPass(const DrawPacket &packet);
+    // Key of the model of a packet without its level of detail and depth, which orders models
+    // the same way in every frame.
+    static uint64_t getModelKey(const DrawPacket &packet);
+
+    const std::vector<DrawPacket> &getPackets() const { return mPackets; }
+    const RenderQueueStats &getStats() const { return mStats; }
+
+  private:
+    // Small ids of the state of a model, in the order models are first pushed.
+    struct ModelState
+    {
+        uint64_t program;
+        uint64_t material;
+        uint64_t model;
+    };
+
+    const ModelState &getModelState(const Model *model);
+    void countSwitches(int *programSwitches, int *textureSwitches, int *pipelineSwitches) const;
+
+    std::vector<DrawPacket> mPackets;
+    // Packets of the radix sort passes.
+    std::vector<DrawPacket> mSorted;
+    std::unordered_map<const Model *, ModelState> mModelStates;
+    std::unordered_map<const void *, uint64_t> mPrograms;
+    std::unordered_map<const void *, uint64_t> mMaterials;
+    RenderQueueStats mStats;
+};
+
+#endif
@@ -0,0 +1,70 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// UniformBlock.h: Define a uniform block kept on the CPU with a version, raised by every write.
+// Backends keep the version they last uploaded in a UniformUpload, and upload the block again
+// only when the versions differ.
+
+#pragma once
+#ifndef UNIFORMBLOCK_H
+#define UNIFORMBLOCK_H 1
+
+#include <cstddef>
+#include <cstdint>
+
+// Bytes of uniforms uploaded, and skipped because they were already uploaded, since the
+// counters were reset.
+struct UniformUploadStats
+{
+    size_t bytesUploaded;
+    size_t bytesSkipped;
+};
+
+template <typename T>
+class UniformBlock
+{
+  public:
+    UniformBlock() : mData(), mVersion(1) {}
+
+    const T &get() const { return mData; }
+    // The block is dirty from here on, whether the caller changes it or not.
+    T &edit()
+    {
+        ++mVersion;
+        return mData;
+    }
+    uint64_t getVersion() const { return mVersion; }
+
+  private:
+    T mData;
+    uint64_t mVersion;
+};
+
+class UniformUpload
+{
+  public:
+    UniformUpload() : mVersion(0) {}
+
+    // Whether block changed since the last upload, in which case the caller uploads it now.
+    // Its bytes are counted as uploaded or skipped.
+    template <typename T>
+    bool update(const UniformBlock<T> &block, UniformUploadStats *stats)
+    {
+        if (mVersion == block.getVersion())
+        {
+            stats->bytesSkipped += sizeof(T);
+            return false;
+        }
+        mVersion = block.getVersion();
+        stats->bytesUploaded += sizeof(T);
+        return true;
+    }
+
+  private:
+    // Blocks start at version 1, so that they are uploaded once at least.
+    uint64_t mVersion;
+};
+
+#endif
@@ -0,0 +1,242 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// VertexLayout.h: Describe the interleaved vertex buffer of a model. Attributes are laid out in
+// the order of their shader locations, and only those the program of the model reads, so one
+// stride, and an offset and format per attribute, describe the buffer to every backend.
+// Compressed layouts use formats that vertex fetch expands to floats, so shaders read them
+// unchanged.
+
+#pragma once
+#ifndef VERTEXLAYOUT_H
+#define VERTEXLAYOUT_H 1
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Vertex attributes, by shader location.
+enum VERTEXATTRIBUTE : short
+{
+    VERTEXPOSITION,
+    VERTEXNORMAL,
+    VERTEXTEXCOORD,
+    VERTEXTANGENT,
+    VERTEXBINORMAL,
+    VERTEXATTRIBUTEMAX
+};
+
+// Formats of vertex attribute components. Integer formats are normalized to [-1, 1] or [0, 1].
+enum VERTEXFORMAT : short
+{
+    VERTEXFLOAT32,
+    VERTEXFLOAT16,
+    VERTEXSNORM8,
+    VERTEXUNORM16
+};
+
+// Stride and offsets are in bytes. Attributes not in the buffer have offset -1.
+struct VertexLayout
+{
+    VertexLayout() : stride(0)
+    {
+        for (int i = 0; i < VERTEXATTRIBUTEMAX; ++i)
+        {
+            offsets[i]       = -1;
+            numComponents[i] = 0;
+            formats[i]       = VERTEXFLOAT32;
+        }
+    }
+
+    bool hasAttribute(int attribute) const { return offsets[attribute] >= 0; }
+
+    int stride;
+    int offsets[VERTEXATTRIBUTEMAX];
+    int numComponents[VERTEXATTRIBUTEMAX];
+    VERTEXFORMAT formats[VERTEXATTRIBUTEMAX];
+};
+
+namespace vertexLayout {
+// Names of the attributes in model files and shaders.
+constexpr const char *kAttributeNames[VERTEXATTRIBUTEMAX] = {"position", "normal", "texCoord",
+                                                             "tangent", "binormal"};
+
+inline int getComponentSize(VERTEXFORMAT format)
+{
+    switch (format)
+    {
+        case VERTEXFLOAT16:
+        case VERTEXUNORM16:
+            return 2;
+        case VERTEXSNORM8:
+            return 1;
+        default:
+            return 4;
+    }
+}
+
+// Round to nearest even. Values beyond the range of half floats become infinity.
+inline uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign     = (bits >> 16) & 0x8000;
+    int exponent      = static_cast<int>((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+    if (exponent >= 31)
+    {
+        return static_cast<uint16_t>(sign | 0x7c00);
+    }
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+        {
+            return static_cast<uint16_t>(sign);
+        }
+        mantissa |= 0x800000;
+        int shift          = 14 - exponent;
+        uint32_t half      = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway   = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1)))
+        {
+            ++half;
+        }
+        return static_cast<uint16_t>(sign | half);
+    }
+    uint32_t half      = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+    {
+        ++half;
+    }
+    return static_cast<uint16_t>(sign | half);
+}
+
+// Lay out the attributes of a mesh. Tangents and binormals are left out for programs that do
+// not read them. Compressed layouts store positions as half floats, unit vectors as snorm8 and
+// texture coordinates within [0, 1] as unorm16. Components are padded so that every attribute
+// stays 4 byte aligned; padding of positions reads as w = 1.
+inline VertexLayout build(const std::unordered_map<std::string, std::vector<float>> &attributes,
+                          const std::unordered_map<std::string, int> &attributeComponents,
+                          bool readsTangentFrame,
+                          bool compress)
+{
+    VertexLayout layout;
+    for (int i = 0; i < VERTEXATTRIBUTEMAX; ++i)
+    {
+        if (!readsTangentFrame && (i == VERTEXTANGENT || i == VERTEXBINORMAL))
+        {
+            continue;
+        }
+        auto it = attributeComponents.find(kAttributeNames[i]);
+        if (it == attributeComponents.end())
+        {
+            continue;
+        }
+        int numComponents   = it->second;
+        VERTEXFORMAT format = VERTEXFLOAT32;
+        if (compress)
+        {
+            if (i == VERTEXPOSITION)
+            {
+                format = VERTEXFLOAT16;
+            }
+            else if (i == VERTEXTEXCOORD)
+            {
+                const std::vector<float> &data = attributes.at(kAttributeNames[i]);
+                auto range = std::minmax_element(data.begin(), data.end());
+                if (data.empty() || (*range.first >= 0.0f && *range.second <= 1.0f))
+                {
+                    format = VERTEXUNORM16;
+                }
+            }
+            else
+            {
+                format = VERTEXSNORM8;
+            }
+        }
+        int size = getComponentSize(format);
+        while (numComponents * size % 4 != 0)
+        {
+            ++numComponents;
+        }
+
+        layout.offsets[i]       = layout.stride;
+        layout.numComponents[i] = numComponents;
+        layout.formats[i]       = format;
+        layout.stride += numComponents * size;
+    }
+    return layout;
+}
+
+inline std::vector<unsigned char> interleave(
+    const VertexLayout &layout,
+    const std::unordered_map<std::string, std::vector<float>> &attributes,
+    int numVertices)
+{
+    std::vector<unsigned char> vertices(numVertices * layout.stride);
+    for (int i = 0; i < VERTEXATTRIBUTEMAX; ++i)
+    {
+        if (!layout.hasAttribute(i))
+        {
+            continue;
+        }
+        const std::vector<float> &data = attributes.at(kAttributeNames[i]);
+        int sourceComponents           = static_cast<int>(data.size()) / numVertices;
+        VERTEXFORMAT format            = layout.formats[i];
+        int size                       = getComponentSize(format);
+        for (int v = 0; v < numVertices; ++v)
+        {
+            unsigned char *vertex = &vertices[v * layout.stride + layout.offsets[i]];
+            for (int c = 0; c < layout.numComponents[i]; ++c)
+            {
+                float value = 0.0f;
+                if (c < sourceComponents)
+                {
+                    value = data[v * sourceComponents + c];
+                }
+                else if (i == VERTEXPOSITION && c == 3)
+                {
+                    value = 1.0f;
+                }
+                switch (format)
+                {
+                    case VERTEXFLOAT16:
+                    {
+                        uint16_t half = floatToHalf(value);
+                        std::memcpy(vertex + c * size, &half, size);
+                        break;
+                    }
+                    case VERTEXSNORM8:
+                    {
+                        float clamped = std::min(std::max(value, -1.0f), 1.0f);
+                        int8_t snorm  = static_cast<int8_t>(std::lround(clamped * 127.0f));
+                        std::memcpy(vertex + c * size, &snorm, size);
+                        break;
+                    }
+                    case VERTEXUNORM16:
+                    {
+                        float clamped  = std::min(std::max(value, 0.0f), 1.0f);
+                        uint16_t unorm = static_cast<uint16_t>(std::lround(clamped * 65535.0f));
+                        std::memcpy(vertex + c * size, &unorm, size);
+                        break;
+                    }
+                    default:
+                        std::memcpy(vertex + c * size, &value, size);
+                        break;
+                }
+            }
+        }
+    }
+    return vertices;
+}
+}  // namespace vertexLayout
+
+#endif
@@ -37,4 +37,32 @@ BufferDawn::BufferDawn(ContextDawn* context,
     mBuf = context->createBufferFromData(buffer.data(), sizeof(unsigned short) * static_cast<int>(buffer.size()), mUsageBit);
 }
 
+BufferDawn::BufferDawn(ContextDawn* context,
+                       int totalCmoponents,
+                       int numComponents,
+                       const std::vector<unsigned int> &buffer,
+                       bool isIndex)
+    : mUsageBit(isIndex ? dawn::BufferUsageBit::Index : dawn::BufferUsageBit::Vertex),
+      mTotoalComponents(totalCmoponents),
+      mStride(0),
+      mOffset(nullptr)
+{
+    mSize = numComponents * sizeof(unsigned int);
+    mBuf = context->createBufferFromData(buffer.data(), sizeof(unsigned int) * static_cast<int>(buffer.size()), mUsageBit);
+}
+
+BufferDawn::BufferDawn(ContextDawn* context,
+                       int totalCmoponents,
+                       int numComponents,
+                       const std::vector<unsigned char> &buffer,
+                       bool isIndex)
+    : mUsageBit(isIndex ? dawn::BufferUsageBit::Index : dawn::BufferUsageBit::Vertex),
+      mTotoalComponents(totalCmoponents),
+      mStride(0),
+      mOffset(nullptr)
+{
+    mSize = numComponents;
+    mBuf = context->createBufferFromData(buffer.data(), static_cast<int>(buffer.size()), mUsageBit);
+}
+
 BufferDawn::~BufferDawn() {}
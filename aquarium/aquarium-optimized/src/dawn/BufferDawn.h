@@ -29,6 +29,16 @@ class BufferDawn : public Buffer
                int numComponents,
                const std::vector<unsigned short> &buffer,
                bool isIndex);
+    BufferDawn(ContextDawn *context,
+               int totalCmoponents,
+               int numComponents,
+               const std::vector<unsigned int> &buffer,
+               bool isIndex);
+    BufferDawn(ContextDawn *context,
+               int totalCmoponents,
+               int numComponents,
+               const std::vector<unsigned char> &buffer,
+               bool isIndex);
     ~BufferDawn() override;
 
     const dawn::Buffer &getBuffer() const { return mBuf; }
@@ -0,0 +1,68 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// CommandListDawn.cpp: Implements the recorded list of draw commands of Dawn.
+
+#include "CommandListDawn.h"
+
+void CommandListDawn::clear()
+{
+    mCommands.clear();
+    mDynamicOffsets.clear();
+}
+
+CommandListDawn::Command &CommandListDawn::push(COMMAND type)
+{
+    mCommands.emplace_back();
+    Command &command    = mCommands.back();
+    command.type        = type;
+    command.index       = 0;
+    command.offset      = 0;
+    command.firstOffset = 0;
+    command.offsetCount = 0;
+
+    return command;
+}
+
+void CommandListDawn::setPipeline(const dawn::RenderPipeline &pipeline)
+{
+    push(COMMANDSETPIPELINE).pipeline = pipeline;
+}
+
+void CommandListDawn::setBindGroup(uint32_t index,
+                                   const dawn::BindGroup &group,
+                                   uint32_t dynamicOffsetCount,
+                                   const uint64_t *dynamicOffsets)
+{
+    Command &command    = push(COMMANDSETBINDGROUP);
+    command.index       = index;
+    command.group       = group;
+    command.firstOffset = static_cast<uint32_t>(mDynamicOffsets.size());
+    command.offsetCount = dynamicOffsetCount;
+    mDynamicOffsets.insert(mDynamicOffsets.end(), dynamicOffsets,
+                           dynamicOffsets + dynamicOffsetCount);
+}
+
+void CommandListDawn::setVertexBuffer(uint32_t slot, const dawn::Buffer &buffer, uint32_t offset)
+{
+    Command &command = push(COMMANDSETVERTEXBUFFER);
+    command.index    = slot;
+    command.buffer   = buffer;
+    command.offset   = offset;
+}
+
+void CommandListDawn::setIndexBuffer(const dawn::Buffer &buffer, uint32_t offset)
+{
+    Command &command = push(COMMANDSETINDEXBUFFER);
+    command.buffer   = buffer;
+    command.offset   = offset;
+}
+
+void CommandListDawn::drawIndexedIndirect(const dawn::Buffer &buffer, uint32_t offset)
+{
+    Command &command = push(COMMANDDRAWINDEXEDINDIRECT);
+    command.buffer   = buffer;
+    command.offset   = offset;
+}
@@ -0,0 +1,107 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// CommandListDawn.h: Defines a recorded list of draw commands of Dawn. Static models record
+// their draws into it once. Their commands only refer to uniform blocks at fixed offsets and to
+// indirect draw arguments, which the models update every frame, so the list is encoded into a
+// render bundle once and executed every frame.
+
+#pragma once
+#ifndef COMMANDLISTDAWN_H
+#define COMMANDLISTDAWN_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "dawn/dawncpp.h"
+
+class CommandListDawn
+{
+  public:
+    void clear();
+
+    void setPipeline(const dawn::RenderPipeline &pipeline);
+    void setBindGroup(uint32_t index,
+                      const dawn::BindGroup &group,
+                      uint32_t dynamicOffsetCount,
+                      const uint64_t *dynamicOffsets);
+    void setVertexBuffer(uint32_t slot, const dawn::Buffer &buffer, uint32_t offset);
+    void setIndexBuffer(const dawn::Buffer &buffer, uint32_t offset);
+    void drawIndexedIndirect(const dawn::Buffer &buffer, uint32_t offset);
+
+    // Encode the commands into a render pass or render bundle encoder.
+    template <typename Encoder>
+    void encode(Encoder &encoder) const;
+
+  private:
+    enum COMMAND : short
+    {
+        COMMANDSETPIPELINE,
+        COMMANDSETBINDGROUP,
+        COMMANDSETVERTEXBUFFER,
+        COMMANDSETINDEXBUFFER,
+        COMMANDDRAWINDEXEDINDIRECT
+    };
+
+    // Arguments of every command. Dynamic offsets of bind groups are in mDynamicOffsets from
+    // firstOffset on.
+    struct Command
+    {
+        COMMAND type;
+        dawn::RenderPipeline pipeline;
+        dawn::BindGroup group;
+        dawn::Buffer buffer;
+        uint32_t index;
+        uint32_t offset;
+        uint32_t firstOffset;
+        uint32_t offsetCount;
+    };
+
+    Command &push(COMMAND type);
+
+    std::vector<Command> mCommands;
+    std::vector<uint64_t> mDynamicOffsets;
+};
+
+template <typename Encoder>
+void CommandListDawn::encode(Encoder &encoder) const
+{
+    for (const Command &command : mCommands)
+    {
+        switch (command.type)
+        {
+            case COMMANDSETPIPELINE:
+                encoder.SetPipeline(command.pipeline);
+                break;
+            case COMMANDSETBINDGROUP:
+                encoder.SetBindGroup(command.index, command.group, command.offsetCount,
+                                     mDynamicOffsets.data() + command.firstOffset);
+                break;
+            case COMMANDSETVERTEXBUFFER:
+            {
+                uint32_t offsets[1] = {command.offset};
+                encoder.SetVertexBuffers(command.index, 1, &command.buffer, offsets);
+                break;
+            }
+            case COMMANDSETINDEXBUFFER:
+                encoder.SetIndexBuffer(command.buffer, command.offset);
+                break;
+            case COMMANDDRAWINDEXEDINDIRECT:
+                encoder.DrawIndexedIndirect(command.buffer, command.offset);
+                break;
+        }
+    }
+}
+
+// A model whose draws are recorded once into the static draws of its pass.
+class StaticModelDawn
+{
+  public:
+    virtual ~StaticModelDawn() {}
+    virtual void recordDraws(CommandListDawn *commands) const = 0;
+};
+
+#endif
@@ -10,6 +10,7 @@
 #include <vector>
 
 #include "../Aquarium.h"
+#include "../RenderQueue.h"
 #include "BufferDawn.h"
 #include "ContextDawn.h"
 #include "FishModelDawn.h"
@@ -29,8 +30,15 @@
 #include "utils/ComboRenderPipelineDescriptor.h"
 #include "../ASSERT.h"
 
+#include <algorithm>
 #include <array>
 #include <cstring>
+#include <utility>
+
+namespace {
+// Alignment of the copies of textures in the staging buffer.
+constexpr uint32_t kUploadAlignment = 256;
+}  // namespace
 
 void PrintDeviceError(const char* message, dawn::CallbackUserdata) {
     std::cout << "Device error: " << message << std::endl;
@@ -39,6 +47,11 @@ void PrintDeviceError(const char* message, dawn::CallbackUserdata) {
 ContextDawn::ContextDawn()
     : mWindow(nullptr),
       pass(nullptr),
+      lightWorldPositionOffset(0),
+      viewOffset(0),
+      mUploadSize(0),
+      mStaticPacket(nullptr),
+      mDrawArgsBuffer(nullptr),
       device(nullptr),
       queue(nullptr),
       swapchain(nullptr),
@@ -50,6 +63,10 @@ ContextDawn::ContextDawn()
       mPreferredSwapChainFormat(dawn::TextureFormat::R8G8B8A8Unorm),
       renderPassDescriptor(nullptr)
 {
+    for (StaticDraws &draws : mStaticDraws)
+    {
+        draws.changed = false;
+    }
 }
 
 ContextDawn::~ContextDawn() {}
@@ -207,6 +224,69 @@ void ContextDawn::submit(int numCommands, const dawn::CommandBuffer& commands) c
     queue.Submit(numCommands, &commands);
 }
 
+void ContextDawn::uploadTexture(TextureDawn *owner,
+                                const dawn::Texture &texture,
+                                uint32_t level,
+                                uint32_t slice,
+                                const unsigned char *pixels,
+                                uint32_t rowPitch,
+                                uint32_t width,
+                                uint32_t height)
+{
+    TextureUpload upload;
+    upload.texture  = texture;
+    upload.level    = level;
+    upload.slice    = slice;
+    upload.pixels   = pixels;
+    upload.offset   = mUploadSize;
+    upload.rowPitch = rowPitch;
+    upload.width    = width;
+    upload.height   = height;
+    mTextureUploads.push_back(upload);
+
+    uint32_t size = rowPitch * height;
+    mUploadSize += (size + kUploadAlignment - 1) / kUploadAlignment * kUploadAlignment;
+    if (mUploadingTextures.empty() || mUploadingTextures.back() != owner)
+    {
+        mUploadingTextures.push_back(owner);
+    }
+}
+
+// All queued copies share one staging buffer and one command buffer, so loading submits once
+// instead of once for every level and face of every texture.
+void ContextDawn::flushUploads()
+{
+    if (mTextureUploads.empty())
+    {
+        return;
+    }
+
+    dawn::Buffer stagingBuffer = createBuffer(
+        mUploadSize, dawn::BufferUsageBit::TransferSrc | dawn::BufferUsageBit::TransferDst);
+    dawn::CommandEncoder encoder = device.CreateCommandEncoder();
+    for (const TextureUpload &upload : mTextureUploads)
+    {
+        setBufferData(stagingBuffer, upload.offset, upload.rowPitch * upload.height, upload.pixels);
+        dawn::BufferCopyView bufferCopyView =
+            createBufferCopyView(stagingBuffer, upload.offset, upload.rowPitch, upload.height);
+        dawn::TextureCopyView textureCopyView =
+            createTextureCopyView(upload.texture, upload.level, upload.slice, {0, 0, 0});
+        dawn::Extent3D copySize = {upload.width, upload.height, 1};
+        encoder.CopyBufferToTexture(&bufferCopyView, &textureCopyView, &copySize);
+    }
+    dawn::CommandBuffer copy = encoder.Finish();
+    submit(1, copy);
+
+    // The copies own their data once submitted, so pixels of the textures are released.
+    for (TextureDawn *texture : mUploadingTextures)
+    {
+        texture->releaseImageData();
+    }
+    mTextureUploads.clear();
+    mUploadingTextures.clear();
+    mUploadSize = 0;
+}
+
 dawn::ShaderModule ContextDawn::createShaderModule(dawn::ShaderStage stage,
                                                    const std::string &str) const
 {
@@ -256,7 +336,78 @@ dawn::InputState ContextDawn::createInputState(std::initializer_list<Attribute>
     return inputStateBuilder.GetResult();
 }
 
-dawn::RenderPipeline ContextDawn::createRenderPipeline(dawn::PipelineLayout pipelineLayout, ProgramDawn * programDawn, dawn::InputState inputState, bool enableBlend) const
+// Components of packed formats are padded to 4 bytes, so only these sizes occur.
+dawn::VertexFormat ContextDawn::getVertexFormat(VERTEXFORMAT format, int numComponents) const
+{
+    switch (format)
+    {
+        case VERTEXFLOAT16:
+            return numComponents == 2 ? dawn::VertexFormat::HalfR16G16
+                                      : dawn::VertexFormat::HalfR16G16B16A16;
+        case VERTEXSNORM8:
+            return dawn::VertexFormat::SnormR8G8B8A8;
+        case VERTEXUNORM16:
+            return numComponents == 2 ? dawn::VertexFormat::UnormR16G16
+                                      : dawn::VertexFormat::UnormR16G16B16A16;
+        default:
+            break;
+    }
+
+    static const dawn::VertexFormat formats[] = {
+        dawn::VertexFormat::FloatR32, dawn::VertexFormat::FloatR32G32,
+        dawn::VertexFormat::FloatR32G32B32, dawn::VertexFormat::FloatR32G32B32A32};
+    return formats[numComponents - 1];
+}
+
+dawn::InputState ContextDawn::createInputState(const VertexLayout &layout,
+                                               std::initializer_list<Attribute> attributeInitilizer,
+                                               std::initializer_list<Input> inputInitilizer) const
+{
+    dawn::InputStateBuilder inputStateBuilder = device.CreateInputStateBuilder();
+
+    for (int i = 0; i < VERTEXATTRIBUTEMAX; ++i)
+    {
+        if (!layout.hasAttribute(i))
+        {
+            continue;
+        }
+        dawn::VertexAttributeDescriptor attrib;
+        attrib.shaderLocation = i;
+        attrib.inputSlot      = 0;
+        attrib.offset         = layout.offsets[i];
+        attrib.format         = getVertexFormat(layout.formats[i], layout.numComponents[i]);
+        inputStateBuilder.SetAttribute(&attrib);
+    }
+
+    dawn::VertexInputDescriptor vertexInput;
+    vertexInput.inputSlot = 0;
+    vertexInput.stride    = layout.stride;
+    vertexInput.stepMode  = dawn::InputStepMode::Vertex;
+    inputStateBuilder.SetInput(&vertexInput);
+
+    for (auto &attribute : attributeInitilizer)
+    {
+        dawn::VertexAttributeDescriptor attrib;
+        attrib.shaderLocation = attribute.shaderLocation;
+        attrib.inputSlot      = attribute.bindingSlot;
+        attrib.offset         = attribute.offset;
+        attrib.format         = attribute.format;
+        inputStateBuilder.SetAttribute(&attrib);
+    }
+
+    for (auto &input : inputInitilizer)
+    {
+        dawn::VertexInputDescriptor in;
+        in.inputSlot = input.bindingSlot;
+        in.stride    = input.stride;
+        in.stepMode  = input.stepMode;
+        inputStateBuilder.SetInput(&in);
+    }
+
+    return inputStateBuilder.GetResult();
+}
+
+dawn::RenderPipeline ContextDawn::createRenderPipeline(dawn::PipelineLayout pipelineLayout, ProgramDawn * programDawn, dawn::InputState inputState, bool enableBlend, INDEXFORMAT indexFormat) const
 {
     const dawn::ShaderModule& vsModule = programDawn->getVSModule();
     const dawn::ShaderModule& fsModule = programDawn->getFSModule();
@@ -299,7 +450,8 @@ dawn::RenderPipeline ContextDawn::createRenderPipeline(dawn::PipelineLayout pipe
     descriptor.cDepthStencilState.depthWriteEnabled = true;
     descriptor.cDepthStencilState.depthCompare      = dawn::CompareFunction::Less;
     descriptor.primitiveTopology                    = dawn::PrimitiveTopology::TriangleList;
-    descriptor.indexFormat                          = dawn::IndexFormat::Uint16;
+    descriptor.indexFormat = indexFormat == INDEXUINT32 ? dawn::IndexFormat::Uint32
+                                                        : dawn::IndexFormat::Uint16;
     descriptor.sampleCount                          = 1;
 
     dawn::RenderPipeline pipeline = device.CreateRenderPipeline(&descriptor);
@@ -353,34 +505,185 @@ void ContextDawn::initGeneralResources(Aquarium* aquarium)
         { 1, dawn::ShaderStageBit::Fragment, dawn::BindingType::UniformBuffer },
     });
 
-    lightBuffer = createBufferFromData(&aquarium->lightUniforms, sizeof(aquarium->lightUniforms), dawn::BufferUsageBit::TransferDst | dawn::BufferUsageBit::Uniform);
-    fogBuffer = createBufferFromData(&aquarium->fogUniforms, sizeof(aquarium->fogUniforms), dawn::BufferUsageBit::TransferDst | dawn::BufferUsageBit::Uniform);
+    // Light and fog are uploaded by updateFrameUniforms whenever their version changes.
+    lightBuffer = createBuffer(sizeof(LightUniforms),
+                               dawn::BufferUsageBit::TransferDst | dawn::BufferUsageBit::Uniform);
+    fogBuffer   = createBuffer(sizeof(FogUniforms),
+                               dawn::BufferUsageBit::TransferDst | dawn::BufferUsageBit::Uniform);
 
     bindGroupGeneral = makeBindGroup(groupLayoutGeneral, {
-        { 0, lightBuffer, 0, sizeof(aquarium->lightUniforms) },
-        { 1, fogBuffer , 0, sizeof(aquarium->fogUniforms) }
+        { 0, lightBuffer, 0, sizeof(LightUniforms) },
+        { 1, fogBuffer , 0, sizeof(FogUniforms) }
     });
 
-    setBufferData(lightBuffer, 0, sizeof(LightUniforms), &aquarium->lightUniforms);
-    setBufferData(fogBuffer, 0, sizeof(FogUniforms), &aquarium->fogUniforms);
+    // Uniform blocks that change every frame are sub-allocated from the uniform ring, and bound
+    // with dynamic offsets. The models are created by now and have reserved their blocks.
+    lightWorldPositionOffset = reserveFixedUniforms(sizeof(LightWorldPositionUniform));
+    viewOffset               = reserveFixedUniforms(sizeof(ViewUniforms));
+    mUniformRing.init(this);
+
+    mDrawArgsBuffer = createBuffer(
+        static_cast<uint32_t>(std::max(mDrawArgs.size(), size_t(kDrawArgsSize)) * 4),
+        dawn::BufferUsageBit::TransferDst | dawn::BufferUsageBit::Indirect);
 
     // initilize world uniform buffers
-    groupLayoutWorld = MakeBindGroupLayout({ 
-        { 0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer },
+    groupLayoutWorld = MakeBindGroupLayout({
+        {0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer, true},
     });
 
-    lightWorldPositionBuffer = createBufferFromData(&aquarium->lightWorldPositionUniform, sizeof(aquarium->lightWorldPositionUniform), dawn::BufferUsageBit::TransferDst | dawn::BufferUsageBit::Uniform);
-    
     bindGroupWorld = makeBindGroup(groupLayoutWorld, {
-        {0, lightWorldPositionBuffer, 0, sizeof(aquarium->lightWorldPositionUniform) },
+        {0, getUniformRing(), 0, sizeof(LightWorldPositionUniform)},
     });
+}
+
+// The light world position and view are the same for every draw of the frame, so they are
+// copied once. Light and fog are copied only when they change.
+void ContextDawn::updateFrameUniforms(Aquarium *aquarium)
+{
+    updateUniformBuffer(lightBuffer, aquarium->lightUniforms, &mLightUpload);
+    updateUniformBuffer(fogBuffer, aquarium->fogUniforms, &mFogUpload);
+
+    writeUniforms(static_cast<uint32_t>(lightWorldPositionOffset),
+                  &aquarium->lightWorldPositionUniform, sizeof(LightWorldPositionUniform));
+    writeUniforms(static_cast<uint32_t>(viewOffset), &aquarium->viewUniforms,
+                  sizeof(ViewUniforms));
+}
+
+// Models keep the view uniforms of all their instances and draw them at once. Runs of static
+// models of a pass are encoded together when the run ends.
+void ContextDawn::submitRenderQueue(Aquarium *aquarium, const RenderQueue &queue)
+{
+    const std::vector<DrawPacket> &packets = queue.getPackets();
+    int staticPass                         = -1;
+    size_t begin                           = 0;
+    while (begin < packets.size())
+    {
+        Model *model = packets[begin].model;
+        size_t end   = begin + 1;
+        while (end < packets.size() && packets[end].model == model)
+        {
+            ++end;
+        }
+
+        bool isStatic = packets[begin].instance != kInstancedDraw;
+        int runPass   = isStatic ? RenderQueue::getPass(packets[begin]) : -1;
+        if (runPass != staticPass)
+        {
+            if (staticPass != -1)
+            {
+                drawStaticModels(static_cast<RENDERPASS>(staticPass));
+            }
+            staticPass = runPass;
+        }
+
+        for (size_t i = begin; i < end; ++i)
+        {
+            const DrawPacket &packet = packets[i];
+            if (isStatic)
+            {
+                aquarium->updateWorldProjections(model, packet.instance);
+                model->setInstanceIndex(packet.instance);
+                model->setLod(packet.lod);
+            }
+            model->updatePerInstanceUniforms(&aquarium->viewUniforms);
+        }
+        mStaticPacket = isStatic ? &packets[begin] : nullptr;
+        model->preDraw();
+        model->draw();
+        begin = end;
+    }
+    mStaticPacket = nullptr;
+    if (staticPass != -1)
+    {
+        drawStaticModels(static_cast<RENDERPASS>(staticPass));
+    }
+}
+
+// Models are kept in the order of their keys, which is the order they are drawn in. A model
+// not drawn in a frame keeps its commands, and its indirect draws draw nothing.
+void ContextDawn::drawStaticModel(const StaticModelDawn *model) const
+{
+    ASSERT(mStaticPacket != nullptr);
+    StaticDraws &draws = mStaticDraws[RenderQueue::getPass(*mStaticPacket)];
+    uint64_t key       = RenderQueue::getModelKey(*mStaticPacket);
+    auto it            = std::lower_bound(
+        draws.models.begin(), draws.models.end(), key,
+        [](const std::pair<uint64_t, const StaticModelDawn *> &entry, uint64_t value) {
+            return entry.first < value;
+        });
+    if (it == draws.models.end() || it->first != key)
+    {
+        draws.models.insert(it, std::make_pair(key, model));
+        draws.changed = true;
+    }
+}
+
+// Commands only bind fixed uniform offsets and indirect arguments, so they are recorded and
+// encoded again only when a pass draws a model for the first time.
+void ContextDawn::drawStaticModels(RENDERPASS renderPass)
+{
+    StaticDraws &draws = mStaticDraws[renderPass];
+    if (draws.changed)
+    {
+        draws.commands.clear();
+        for (const auto &entry : draws.models)
+        {
+            entry.second->recordDraws(&draws.commands);
+        }
+#ifdef DAWN_RENDER_BUNDLES
+        dawn::RenderBundleEncoderDescriptor descriptor;
+        descriptor.colorFormatsCount  = 1;
+        descriptor.colorFormats       = &mPreferredSwapChainFormat;
+        descriptor.depthStencilFormat = dawn::TextureFormat::D32FloatS8Uint;
+        descriptor.sampleCount        = 1;
+        dawn::RenderBundleEncoder bundleEncoder = device.CreateRenderBundleEncoder(&descriptor);
+        draws.commands.encode(bundleEncoder);
+        draws.bundle = bundleEncoder.Finish();
+#endif
+        draws.changed = false;
+    }
 
-    setBufferData(lightWorldPositionBuffer, 0, sizeof(LightWorldPositionUniform), &aquarium->lightWorldPositionUniform);
+#ifdef DAWN_RENDER_BUNDLES
+    pass.ExecuteBundles(1, &draws.bundle);
+#else
+    // Without render bundles the recorded commands are replayed into the pass every frame.
+    draws.commands.encode(pass);
+#endif
 }
 
-void ContextDawn::updateWorldlUniforms(Aquarium* aquarium)
+uint32_t ContextDawn::allocateUniforms(const void *data, size_t size) const
 {
-    setBufferData(lightWorldPositionBuffer, 0, sizeof(LightWorldPositionUniform), &aquarium->lightWorldPositionUniform);
+    mUniformStats.bytesUploaded += size;
+    return mUniformRing.allocate(data, size);
+}
+
+void ContextDawn::writeUniforms(uint32_t offset, const void *data, size_t size) const
+{
+    mUniformStats.bytesUploaded += size;
+    mUniformRing.write(offset, data, size);
+}
+
+uint32_t ContextDawn::reserveDrawArgs(int count) const
+{
+    ASSERT(!mDrawArgsBuffer);
+    uint32_t slot = static_cast<uint32_t>(mDrawArgs.size() / kDrawArgsSize);
+    mDrawArgs.resize(mDrawArgs.size() + count * kDrawArgsSize, 0);
+    return slot;
+}
+
+void ContextDawn::setDrawArgs(uint32_t slot,
+                              uint32_t indexCount,
+                              uint32_t instanceCount,
+                              uint32_t firstIndex,
+                              int32_t baseVertex,
+                              uint32_t firstInstance) const
+{
+    uint32_t *args = mDrawArgs.data() + slot * kDrawArgsSize;
+    args[0]        = indexCount;
+    args[1]        = instanceCount;
+    args[2]        = firstIndex;
+    args[3]        = static_cast<uint32_t>(baseVertex);
+    args[4]        = firstInstance;
 }
 
 Buffer *ContextDawn::createBuffer(int numComponents, const std::vector<float> &buf, bool isIndex)
@@ -397,6 +700,22 @@ Buffer *ContextDawn::createBuffer(int numComponents,
     return buffer;
 }
 
+Buffer *ContextDawn::createBuffer(int numComponents,
+                                 const std::vector<unsigned int> &buf,
+                                 bool isIndex)
+{
+    Buffer *buffer = new BufferDawn(this, static_cast<int>(buf.size()), numComponents, buf, isIndex);
+    return buffer;
+}
+
+Buffer *ContextDawn::createBuffer(int numComponents,
+                                 const std::vector<unsigned char> &buf,
+                                 bool isIndex)
+{
+    Buffer *buffer = new BufferDawn(this, static_cast<int>(buf.size()), numComponents, buf, isIndex);
+    return buffer;
+}
+
 Program *ContextDawn::createProgram(std::string vId, std::string fId)
 {
     ProgramDawn* program = new ProgramDawn(this, vId, fId);
@@ -424,6 +743,14 @@ void ContextDawn::DoFlush() {
 
     pass.EndPass();
     dawn::CommandBuffer cmd = commandEncoder.Finish();
+    // Uniform blocks and draw arguments of the frame are uploaded before the commands that read
+    // them run.
+    mUniformRing.flush();
+    if (!mDrawArgs.empty())
+    {
+        setBufferData(mDrawArgsBuffer, 0, static_cast<uint32_t>(mDrawArgs.size() * 4),
+                      mDrawArgs.data());
+    }
     queue.Submit(1, &cmd);
 
     swapchain.Present(mBackbuffer);
@@ -438,6 +765,12 @@ void ContextDawn::Terminate() {
 // Update backbuffer and renderPassDescriptor
 void ContextDawn::preFrame()
 {
+    // Static models set the instances of the draws of the frame.
+    for (size_t i = 1; i < mDrawArgs.size(); i += kDrawArgsSize)
+    {
+        mDrawArgs[i] = 0;
+    }
+
     GetNextRenderPassDescriptor(&mBackbuffer, &renderPassDescriptor);
     commandEncoder =
         device.CreateCommandEncoder();
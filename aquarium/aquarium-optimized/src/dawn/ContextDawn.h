@@ -10,6 +10,11 @@
 #define CONTEXTDAWN_H
 
 #include "../Context.h"
+#include "../GeometryArena.h"
+#include "../RenderQueue.h"
+#include "../VertexLayout.h"
+#include "CommandListDawn.h"
+#include "UniformRingDawn.h"
 
 #include <dawn_native/DawnNative.h>
 #include "dawn/dawncpp.h"
@@ -57,6 +62,12 @@ class ContextDawn : public Context
     Buffer *createBuffer(int numComponents,
         const std::vector<unsigned short> &buffer,
         bool isIndex) override;
+    Buffer *createBuffer(int numComponents,
+        const std::vector<unsigned int> &buffer,
+        bool isIndex) override;
+    Buffer *createBuffer(int numComponents,
+        const std::vector<unsigned char> &buffer,
+        bool isIndex) override;
 
     Program *createProgram(std::string vId, std::string fId) override;
 
@@ -73,6 +84,16 @@ class ContextDawn : public Context
                                             const dawn::TextureCopyView &textureCopyView,
                                             const dawn::Extent3D &ext3D) const;
     void submit(int numCommands, const dawn::CommandBuffer& commands) const;
+    // Queue a copy of pixels with rowPitch bytes per row into a level and layer of the texture
+    // of owner. Pixels stay owned by the texture until flushUploads has submitted the copies.
+    void uploadTexture(TextureDawn *owner,
+                       const dawn::Texture &texture,
+                       uint32_t level,
+                       uint32_t slice,
+                       const unsigned char *pixels,
+                       uint32_t rowPitch,
+                       uint32_t width,
+                       uint32_t height);
 
     dawn::TextureCopyView createTextureCopyView(dawn::Texture texture,
                                                 uint32_t level,
@@ -85,7 +106,13 @@ class ContextDawn : public Context
         std::vector<dawn::BindGroupLayout> bindingsInitializer) const;
     dawn::InputState createInputState(std::initializer_list<Attribute> attributeInitilizer,
         std::initializer_list<Input> inputInitilizer) const;
-    dawn::RenderPipeline createRenderPipeline(dawn::PipelineLayout pipelineLayout, ProgramDawn* programDawn, dawn::InputState inputState, bool enableBlend) const;
+    dawn::VertexFormat getVertexFormat(VERTEXFORMAT format, int numComponents) const;
+    // Read the interleaved vertex buffer described by layout from slot 0, the attributes at
+    // their own shader locations, followed by any per instance attributes and inputs.
+    dawn::InputState createInputState(const VertexLayout &layout,
+                                      std::initializer_list<Attribute> attributeInitilizer = {},
+                                      std::initializer_list<Input> inputInitilizer = {}) const;
+    dawn::RenderPipeline createRenderPipeline(dawn::PipelineLayout pipelineLayout, ProgramDawn* programDawn, dawn::InputState inputState, bool enableBlend, INDEXFORMAT indexFormat) const;
     dawn::TextureView createDepthStencilView() const;
     dawn::Buffer createBuffer(uint32_t size, dawn::BufferUsageBit bit) const;
     void setBufferData(const dawn::Buffer& buffer, uint32_t start, uint32_t size, const void* pixels) const;
@@ -96,14 +123,55 @@ class ContextDawn : public Context
                                      dawn::RenderPassDescriptor *info) const;
 
     void initGeneralResources(Aquarium* aquarium) override;
-    void updateWorldlUniforms(Aquarium* aquarium) override;
+    void flushUploads() override;
+    void updateFrameUniforms(Aquarium *aquarium) override;
+    void submitRenderQueue(Aquarium *aquarium, const RenderQueue &queue) override;
+    // Draw a static model of the packet being submitted. Its recorded draws are encoded with
+    // those of the other static models of its pass.
+    void drawStaticModel(const StaticModelDawn *model) const;
     dawn::Device getDevice() const { return device; }
+    // Copy a uniform block of the frame into the uniform ring, and return the dynamic offset
+    // that binds it.
+    // Models reserve the blocks they allocate in a frame when they are created.
+    void reserveUniforms(size_t size) const { mUniformRing.reserve(size); }
+    uint32_t allocateUniforms(const void *data, size_t size) const;
+    // Blocks of static models live at fixed offsets, which their recorded commands bind.
+    uint32_t reserveFixedUniforms(size_t size) const { return mUniformRing.reserveFixed(size); }
+    void writeUniforms(uint32_t offset, const void *data, size_t size) const;
+    // Arguments of indirect draws, reserved by static models when they are created. Every
+    // frame draws nothing from the slots its models do not set.
+    uint32_t reserveDrawArgs(int count) const;
+    void setDrawArgs(uint32_t slot,
+                     uint32_t indexCount,
+                     uint32_t instanceCount,
+                     uint32_t firstIndex,
+                     int32_t baseVertex,
+                     uint32_t firstInstance) const;
+    const dawn::Buffer &getDrawArgsBuffer() const { return mDrawArgsBuffer; }
+    static uint32_t getDrawArgsOffset(uint32_t slot) { return slot * kDrawArgsSize * 4; }
+    const dawn::Buffer &getUniformRing() const { return mUniformRing.getBuffer(); }
+    // Copy block into buffer if it changed since upload was last updated.
+    template <typename T>
+    void updateUniformBuffer(const dawn::Buffer &buffer,
+                             const UniformBlock<T> &block,
+                             UniformUpload *upload) const
+    {
+        if (upload->update(block, &mUniformStats))
+        {
+            setBufferData(buffer, 0, sizeof(T), &block.get());
+        }
+    }
 
     dawn::RenderPassEncoder pass;
     dawn::BindGroupLayout groupLayoutGeneral;
     dawn::BindGroup bindGroupGeneral;
     dawn::BindGroupLayout groupLayoutWorld;
     dawn::BindGroup bindGroupWorld;
+    // Fixed offset of the light world position of the frame in the uniform ring.
+    uint64_t lightWorldPositionOffset;
+    // Fixed offset of the view uniforms of the frame, before any world matrix is written into
+    // them.
+    uint64_t viewOffset;
 
   private:
     GLFWwindow *mWindow;
@@ -122,9 +190,51 @@ class ContextDawn : public Context
     dawn::BindGroup mBindGroup;
     dawn::TextureFormat mPreferredSwapChainFormat;
 
-    dawn::Buffer lightWorldPositionBuffer;
+    // Words of the arguments of an indexed indirect draw.
+    static constexpr uint32_t kDrawArgsSize = 5;
+
+    // Encode the static models of a pass into the render pass.
+    void drawStaticModels(RENDERPASS renderPass);
+
+    mutable UniformRingDawn mUniformRing;
+
+    // Texture copies queued since the last flushUploads, at offset in the staging buffer.
+    struct TextureUpload
+    {
+        dawn::Texture texture;
+        uint32_t level;
+        uint32_t slice;
+        const unsigned char *pixels;
+        uint32_t offset;
+        uint32_t rowPitch;
+        uint32_t width;
+        uint32_t height;
+    };
+    std::vector<TextureUpload> mTextureUploads;
+    std::vector<TextureDawn *> mUploadingTextures;
+    uint32_t mUploadSize;
+
+    // Static models every frame has drawn in a pass, by model key, and their commands. The
+    // commands are recorded again only when a model is drawn for the first time.
+    struct StaticDraws
+    {
+        std::vector<std::pair<uint64_t, const StaticModelDawn *>> models;
+        CommandListDawn commands;
+        bool changed;
+#ifdef DAWN_RENDER_BUNDLES
+        dawn::RenderBundle bundle;
+#endif
+    };
+    mutable StaticDraws mStaticDraws[RENDERPASSMAX];
+    // Packet of the static model being drawn, null while other models are drawn.
+    const DrawPacket *mStaticPacket;
+
+    mutable std::vector<uint32_t> mDrawArgs;
+    dawn::Buffer mDrawArgsBuffer;
     dawn::Buffer lightBuffer;
     dawn::Buffer fogBuffer;
+    UniformUpload mLightUpload;
+    UniformUpload mFogUpload;
 };
 
 #endif
@@ -6,6 +6,9 @@
 // FishModelDawn.cpp: Implements fish model of Dawn.
 
 #include "FishModelDawn.h"
+
+#include <algorithm>
+
 #include "BufferDawn.h"
 
 FishModelDawn::FishModelDawn(const Context *context,
@@ -13,12 +16,20 @@ FishModelDawn::FishModelDawn(const Context *context,
                              MODELGROUP type,
                              MODELNAME name,
                              bool blend)
-    : FishModel(type, name, blend), instance(0)
+    : FishModel(type, name, blend),
+      fishPersBuffer(nullptr),
+      fishPersBufferCapacity(0)
 {
     contextDawn = static_cast<const ContextDawn *>(context);
+    contextDawn->reserveUniforms(sizeof(FishVertexUniforms));
+
+    LightFactorUniforms &lightFactor = lightFactorUniforms.edit();
+    lightFactor.shininess      = 5.0f;
+    lightFactor.specularFactor = 0.3f;
+}
 
-    lightFactorUniforms.shininess      = 5.0f;
-    lightFactorUniforms.specularFactor = 0.3f;
+FishModelDawn::~FishModelDawn()
+{
 }
 
 void FishModelDawn::init()
@@ -30,40 +41,26 @@ void FishModelDawn::init()
     reflectionTexture = static_cast<TextureDawn *>(textureMap["reflectionMap"]);
     skyboxTexture     = static_cast<TextureDawn *>(textureMap["skybox"]);
 
-    positionBuffer = static_cast<BufferDawn *>(bufferMap["position"]);
-    normalBuffer   = static_cast<BufferDawn *>(bufferMap["normal"]);
-    texCoordBuffer = static_cast<BufferDawn *>(bufferMap["texCoord"]);
-    tangentBuffer  = static_cast<BufferDawn *>(bufferMap["tangent"]);
-    binormalBuffer = static_cast<BufferDawn *>(bufferMap["binormal"]);
-    indicesBuffer  = static_cast<BufferDawn *>(bufferMap["indices"]);
-
-    fishPersBuffer = contextDawn->createBuffer(
-        sizeof(FishPer) * 100000, dawn::BufferUsageBit::Vertex | dawn::BufferUsageBit::TransferDst);
+    vertexBuffer   = static_cast<BufferDawn *>(geometry.vertexBuffer);
+    indicesBuffer  = static_cast<BufferDawn *>(geometry.indexBuffer);
 
+    // Per fish data is read per instance from slot 1, after the vertices.
     inputState = contextDawn->createInputState(
+        vertexLayout,
         {
-            {0, 0, dawn::VertexFormat::FloatR32G32B32, 0},
-            {1, 1, dawn::VertexFormat::FloatR32G32B32, 0},
-            {2, 2, dawn::VertexFormat::FloatR32G32, 0},
-            {3, 3, dawn::VertexFormat::FloatR32G32B32, 0},
-            {4, 4, dawn::VertexFormat::FloatR32G32B32, 0},
-            {5, 5, dawn::VertexFormat::FloatR32G32B32, offsetof(FishPer, worldPosition)},
-            {6, 5, dawn::VertexFormat::FloatR32, offsetof(FishPer, scale)},
-            {7, 5, dawn::VertexFormat::FloatR32G32B32, offsetof(FishPer, nextPosition)},
-            {8, 5, dawn::VertexFormat::FloatR32, offsetof(FishPer, time)},
+            {5, 1, dawn::VertexFormat::FloatR32G32B32, offsetof(FishPer, worldPosition)},
+            {6, 1, dawn::VertexFormat::FloatR32, offsetof(FishPer, scale)},
+            {7, 1, dawn::VertexFormat::FloatR32G32B32, offsetof(FishPer, nextPosition)},
+            {8, 1, dawn::VertexFormat::FloatR32, offsetof(FishPer, time)},
         },
-        {{0, positionBuffer->getDataSize(), dawn::InputStepMode::Vertex},
-         {1, normalBuffer->getDataSize(), dawn::InputStepMode::Vertex},
-         {2, texCoordBuffer->getDataSize(), dawn::InputStepMode::Vertex},
-         {3, tangentBuffer->getDataSize(), dawn::InputStepMode::Vertex},
-         {4, binormalBuffer->getDataSize(), dawn::InputStepMode::Vertex},
-         {5, sizeof(FishPer), dawn::InputStepMode::Instance},
+        {
+            {1, sizeof(FishPer), dawn::InputStepMode::Instance},
         });
 
     if (skyboxTexture && reflectionTexture)
     {
         groupLayoutModel = contextDawn->MakeBindGroupLayout({
-            {0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer},
+            {0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer, true},
             {1, dawn::ShaderStageBit::Fragment, dawn::BindingType::UniformBuffer},
             {2, dawn::ShaderStageBit::Fragment, dawn::BindingType::Sampler},
             {3, dawn::ShaderStageBit::Fragment, dawn::BindingType::Sampler},
@@ -76,7 +73,7 @@ void FishModelDawn::init()
     else
     {
         groupLayoutModel = contextDawn->MakeBindGroupLayout({
-            {0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer},
+            {0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer, true},
             {1, dawn::ShaderStageBit::Fragment, dawn::BindingType::UniformBuffer},
             {2, dawn::ShaderStageBit::Fragment, dawn::BindingType::Sampler},
             {3, dawn::ShaderStageBit::Fragment, dawn::BindingType::SampledTexture},
@@ -85,7 +82,7 @@ void FishModelDawn::init()
     }
 
     groupLayoutPer = contextDawn->MakeBindGroupLayout({
-        {0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer},
+        {0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer, true},
     });
 
     pipelineLayout = contextDawn->MakeBasicPipelineLayout({
@@ -95,16 +92,11 @@ void FishModelDawn::init()
         groupLayoutPer,
     });
 
-    pipeline = contextDawn->createRenderPipeline(pipelineLayout, programDawn, inputState, mBlend);
+    pipeline = contextDawn->createRenderPipeline(pipelineLayout, programDawn, inputState, mBlend,
+                                                 geometry.indexFormat);
 
-    fishVertexBuffer = contextDawn->createBufferFromData(
-        &fishVertexUniforms, sizeof(FishVertexUniforms),
-        dawn::BufferUsageBit::TransferDst | dawn::BufferUsageBit::Uniform);
-    lightFactorBuffer = contextDawn->createBufferFromData(
-        &lightFactorUniforms, sizeof(LightFactorUniforms),
-        dawn::BufferUsageBit::TransferDst | dawn::BufferUsageBit::Uniform);
-    viewBuffer = contextDawn->createBufferFromData(
-        &viewUniformPer, sizeof(ViewUniforms),
+    lightFactorBuffer = contextDawn->createBuffer(
+        sizeof(LightFactorUniforms),
         dawn::BufferUsageBit::TransferDst | dawn::BufferUsageBit::Uniform);
 
     // Fish models includes small, medium and big. Some of them contains reflection and skybox
@@ -112,7 +104,7 @@ void FishModelDawn::init()
     if (skyboxTexture && reflectionTexture)
     {
         bindGroupModel = contextDawn->makeBindGroup(
-            groupLayoutModel, {{0, fishVertexBuffer, 0, sizeof(FishVertexUniforms)},
+            groupLayoutModel, {{0, contextDawn->getUniformRing(), 0, sizeof(FishVertexUniforms)},
                                {1, lightFactorBuffer, 0, sizeof(LightFactorUniforms)},
                                {2, reflectionTexture->getSampler()},
                                {3, skyboxTexture->getSampler()},
@@ -124,56 +116,60 @@ void FishModelDawn::init()
     else
     {
         bindGroupModel = contextDawn->makeBindGroup(
-            groupLayoutModel, {{0, fishVertexBuffer, 0, sizeof(FishVertexUniforms)},
+            groupLayoutModel, {{0, contextDawn->getUniformRing(), 0, sizeof(FishVertexUniforms)},
                                {1, lightFactorBuffer, 0, sizeof(LightFactorUniforms)},
                                {2, diffuseTexture->getSampler()},
                                {3, diffuseTexture->getTextureView()},
                                {4, normalTexture->getTextureView()}});
     }
 
-    bindGroupPer =
-        contextDawn->makeBindGroup(groupLayoutPer, {
-                                                       {0, viewBuffer, 0, sizeof(ViewUniforms)},
-                                                   });
-
-    contextDawn->setBufferData(lightFactorBuffer, 0, sizeof(LightFactorUniforms),
-                               &lightFactorUniforms);
+    bindGroupPer = contextDawn->makeBindGroup(
+        groupLayoutPer, {
+                            {0, contextDawn->getUniformRing(), 0, sizeof(ViewUniforms)},
+                        });
 }
 
 void FishModelDawn::preDraw() const
 {
-    contextDawn->setBufferData(fishVertexBuffer, 0, sizeof(FishVertexUniforms),
-                               &fishVertexUniforms);   
-    contextDawn->setBufferData(viewBuffer, 0, sizeof(ViewUniforms), &viewUniformPer);
 }
 
+// The uniforms of the species are copied when it is drawn. The view uniforms are those of the
+// frame, shared by every species.
 void FishModelDawn::draw()
 {
-    uint32_t vertexBufferOffsets[1] = {0};
+    contextDawn->updateUniformBuffer(lightFactorBuffer, lightFactorUniforms, &lightFactorUpload);
 
-    contextDawn->setBufferData(fishPersBuffer, 0, sizeof(FishPer) * 100000, fishPers);
+    uint32_t vertexBufferOffsets[1] = {0};
+    uint64_t fishVertexOffset =
+        contextDawn->allocateUniforms(&fishVertexUniforms, sizeof(FishVertexUniforms));
 
     dawn::RenderPassEncoder pass = contextDawn->pass;
     pass.SetPipeline(pipeline);
-    pass.SetBindGroup(0, contextDawn->bindGroupGeneral);
-    pass.SetBindGroup(1, contextDawn->bindGroupWorld);
-    pass.SetBindGroup(2, bindGroupModel);
-    pass.SetBindGroup(3, bindGroupPer);
-    pass.SetVertexBuffers(0, 1, &positionBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(1, 1, &normalBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(2, 1, &texCoordBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(3, 1, &tangentBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(4, 1, &binormalBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(5, 1, &fishPersBuffer, vertexBufferOffsets);
+    pass.SetBindGroup(0, contextDawn->bindGroupGeneral, 0, nullptr);
+    pass.SetBindGroup(1, contextDawn->bindGroupWorld, 1, &contextDawn->lightWorldPositionOffset);
+    pass.SetBindGroup(2, bindGroupModel, 1, &fishVertexOffset);
+    pass.SetBindGroup(3, bindGroupPer, 1, &contextDawn->viewOffset);
+    pass.SetVertexBuffers(0, 1, &vertexBuffer->getBuffer(), vertexBufferOffsets);
     pass.SetIndexBuffer(indicesBuffer->getBuffer(), 0);
-    pass.DrawIndexed(indicesBuffer->getTotalComponents(), instance, 0, 0, 0);
-
-    instance = 0;
-}
+    // One draw per level of detail, over the fish of that level, split into draws of at most
+    // kMaxFishPerDraw fish.
+    int firstInstance = 0;
+    for (size_t lod = 0; lod < lodInstanceCounts.size(); ++lod)
+    {
+        int end = firstInstance + lodInstanceCounts[lod];
+        while (firstInstance < end)
+        {
+            int count = std::min(end - firstInstance, kMaxFishPerDraw);
+            uint32_t fishPersOffsets[1] = {
+                static_cast<uint32_t>(firstInstance * sizeof(FishPer))};
+            pass.SetVertexBuffers(1, 1, &fishPersBuffer, fishPersOffsets);
+            pass.DrawIndexed(lods[lod].indexCount, count,
+                             geometry.firstIndex + lods[lod].firstIndex, geometry.baseVertex, 0);
+            firstInstance += count;
+        }
+    }
 
-void FishModelDawn::updatePerInstanceUniforms(ViewUniforms *viewUniforms)
-{
-    memcpy(&viewUniformPer, viewUniforms, sizeof(ViewUniforms));
+    lodInstanceCounts.clear();
 }
 
 void FishModelDawn::updateFishCommonUniforms(float fishLength,
@@ -185,23 +181,22 @@ void FishModelDawn::updateFishCommonUniforms(float fishLength,
     fishVertexUniforms.fishWaveLength = fishWaveLength;
 }
 
-void FishModelDawn::updateFishPerUniforms(float x,
-                                          float y,
-                                          float z,
-                                          float nextX,
-                                          float nextY,
-                                          float nextZ,
-                                          float scale,
-                                          float time)
+// The buffer grows geometrically, so that raising the fish count reallocates rarely. Only the
+// visible fish are uploaded.
+void FishModelDawn::submitInstances(const FishInstances &instances, size_t count)
 {
-    fishPers[instance].worldPosition[0]                     = x;
-    fishPers[instance].worldPosition[1]                     = y;
-    fishPers[instance].worldPosition[2]                     = z;
-    fishPers[instance].nextPosition[0]                      = nextX;
-    fishPers[instance].nextPosition[1]                      = nextY;
-    fishPers[instance].nextPosition[2]                      = nextZ;
-    fishPers[instance].scale                                = scale;
-    fishPers[instance].time                                 = time;
-
-    instance++;
+    if (count > 0)
+    {
+        int numFish = static_cast<int>(count);
+        if (fishPersBufferCapacity < numFish)
+        {
+            fishPersBufferCapacity = std::max(numFish, fishPersBufferCapacity * 2);
+            fishPersBuffer         = contextDawn->createBuffer(
+                sizeof(FishPer) * fishPersBufferCapacity,
+                dawn::BufferUsageBit::Vertex | dawn::BufferUsageBit::TransferDst);
+        }
+        contextDawn->setBufferData(fishPersBuffer, 0, sizeof(FishPer) * numFish,
+                                   instances.fishPers);
+    }
+    lodInstanceCounts.assign(instances.lodCounts, instances.lodCounts + instances.numLods);
 }
@@ -24,23 +24,16 @@ class FishModelDawn : public FishModel
                   MODELGROUP type,
                   MODELNAME name,
                   bool blend);
+    ~FishModelDawn() override;
 
     void init() override;
     void preDraw() const override;
     void draw() override;
 
-    void updatePerInstanceUniforms(ViewUniforms *viewUniforms) override;
     void updateFishCommonUniforms(float fishLength,
                                   float fishBendAmount,
                                   float fishWaveLength) override;
-    void updateFishPerUniforms(float x,
-                               float y,
-                               float z,
-                               float nextX,
-                               float nextY,
-                               float nextZ,
-                               float scale,
-                               float time) override;
+    void submitInstances(const FishInstances &instances, size_t count) override;
 
     struct FishVertexUniforms
     {
@@ -53,28 +46,15 @@ class FishModelDawn : public FishModel
     {
         float shininess;
         float specularFactor;
-    } lightFactorUniforms;
-
-    struct FishPer
-    {
-        float worldPosition[3];
-        float scale;
-        float nextPosition[3];
-        float time;
-    }fishPers[100000];
-
-    ViewUniforms viewUniformPer;
+    };
+    UniformBlock<LightFactorUniforms> lightFactorUniforms;
 
     TextureDawn *diffuseTexture;
     TextureDawn *normalTexture;
     TextureDawn *reflectionTexture;
     TextureDawn *skyboxTexture;
 
-    BufferDawn *positionBuffer;
-    BufferDawn *normalBuffer;
-    BufferDawn *texCoordBuffer;
-    BufferDawn *tangentBuffer;
-    BufferDawn *binormalBuffer;
+    BufferDawn *vertexBuffer;
 
     BufferDawn *indicesBuffer;
 
@@ -89,13 +69,14 @@ class FishModelDawn : public FishModel
     dawn::BindGroup bindGroupModel;
     dawn::BindGroup bindGroupPer;
 
-    dawn::Buffer fishVertexBuffer;
     dawn::Buffer lightFactorBuffer;
-    dawn::Buffer viewBuffer;
+    UniformUpload lightFactorUpload;
 
     dawn::Buffer fishPersBuffer;
+    int fishPersBufferCapacity;
 
-    int instance;
+    // Fish of every level of detail, which follow each other in fishPersBuffer.
+    std::vector<int> lodInstanceCounts;
 
     ProgramDawn *programDawn;
     const ContextDawn *contextDawn;
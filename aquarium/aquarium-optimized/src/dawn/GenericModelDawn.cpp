@@ -15,9 +15,12 @@ GenericModelDawn::GenericModelDawn(const Context *context,
     : GenericModel(type, name, blend), instance(0)
 {
     contextDawn = static_cast<const ContextDawn *>(context);
+    viewUniformsOffset = contextDawn->reserveFixedUniforms(sizeof(ViewUniformPer));
+    drawArgsSlot       = contextDawn->reserveDrawArgs(kMaxLods);
 
-    lightFactorUniforms.shininess      = 50.0f;
-    lightFactorUniforms.specularFactor = 1.0f;
+    LightFactorUniforms &lightFactor = lightFactorUniforms.edit();
+    lightFactor.shininess      = 50.0f;
+    lightFactor.specularFactor = 1.0f;
 }
 
 void GenericModelDawn::init()
@@ -29,47 +32,14 @@ void GenericModelDawn::init()
     reflectionTexture = static_cast<TextureDawn *>(textureMap["reflectionMap"]);
     skyboxTexture     = static_cast<TextureDawn *>(textureMap["skybox"]);
 
-    positionBuffer = static_cast<BufferDawn *>(bufferMap["position"]);
-    normalBuffer   = static_cast<BufferDawn *>(bufferMap["normal"]);
-    texCoordBuffer = static_cast<BufferDawn *>(bufferMap["texCoord"]);
-    tangentBuffer  = static_cast<BufferDawn *>(bufferMap["tangent"]);
-    binormalBuffer = static_cast<BufferDawn *>(bufferMap["binormal"]);
-    indicesBuffer  = static_cast<BufferDawn *>(bufferMap["indices"]);
+    vertexBuffer   = static_cast<BufferDawn *>(geometry.vertexBuffer);
+    indicesBuffer  = static_cast<BufferDawn *>(geometry.indexBuffer);
+
+    inputState = contextDawn->createInputState(vertexLayout);
 
     // Generic models use reflection, normal or diffuse shaders, of which groupLayouts are
     // diiferent in texture binding.  MODELGLOBEBASE use diffuse shader though it contains
     // normal and reflection textures.
-    if (normalTexture && mName != MODELNAME::MODELGLOBEBASE)
-    {
-        inputState = contextDawn->createInputState(
-            {
-                {0, 0, dawn::VertexFormat::FloatR32G32B32, 0},
-                {1, 1, dawn::VertexFormat::FloatR32G32B32, 0},
-                {2, 2, dawn::VertexFormat::FloatR32G32, 0},
-                {3, 3, dawn::VertexFormat::FloatR32G32B32, 0},
-                {4, 4, dawn::VertexFormat::FloatR32G32B32, 0},
-            },
-            {{0, positionBuffer->getDataSize(), dawn::InputStepMode::Vertex},
-             {1, normalBuffer->getDataSize(), dawn::InputStepMode::Vertex},
-             {2, texCoordBuffer->getDataSize(), dawn::InputStepMode::Vertex},
-             {3, tangentBuffer->getDataSize(), dawn::InputStepMode::Vertex},
-             {4, binormalBuffer->getDataSize(), dawn::InputStepMode::Vertex}});
-    }
-    else
-    {
-        inputState = contextDawn->createInputState(
-            {
-                {0, 0, dawn::VertexFormat::FloatR32G32B32, 0},
-                {1, 1, dawn::VertexFormat::FloatR32G32B32, 0},
-                {2, 2, dawn::VertexFormat::FloatR32G32, 0},
-            },
-            {
-                {0, positionBuffer->getDataSize(), dawn::InputStepMode::Vertex},
-                {1, normalBuffer->getDataSize(), dawn::InputStepMode::Vertex},
-                {2, texCoordBuffer->getDataSize(), dawn::InputStepMode::Vertex},
-            });
-    }
-
     if (skyboxTexture && reflectionTexture && mName != MODELNAME::MODELGLOBEBASE)
     {
         groupLayoutModel = contextDawn->MakeBindGroupLayout({
@@ -101,7 +71,7 @@ void GenericModelDawn::init()
     }
 
     groupLayoutPer = contextDawn->MakeBindGroupLayout({
-        {0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer},
+        {0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer, true},
     });
 
     pipelineLayout = contextDawn->MakeBasicPipelineLayout({
@@ -111,13 +81,11 @@ void GenericModelDawn::init()
         groupLayoutPer,
     });
 
-    pipeline = contextDawn->createRenderPipeline(pipelineLayout, programDawn, inputState, mBlend);
+    pipeline = contextDawn->createRenderPipeline(pipelineLayout, programDawn, inputState, mBlend,
+                                                 geometry.indexFormat);
 
-    lightFactorBuffer = contextDawn->createBufferFromData(
-        &lightFactorUniforms, sizeof(lightFactorUniforms),
-        dawn::BufferUsageBit::TransferDst | dawn::BufferUsageBit::Uniform);
-    viewBuffer = contextDawn->createBufferFromData(
-        &viewUniformPer, sizeof(ViewUniformPer),
+    lightFactorBuffer = contextDawn->createBuffer(
+        sizeof(LightFactorUniforms),
         dawn::BufferUsageBit::TransferDst | dawn::BufferUsageBit::Uniform);
 
     // Generic models use reflection, normal or diffuse shaders, of which grouplayouts are
@@ -154,42 +122,57 @@ void GenericModelDawn::init()
                               });
     }
 
-    bindGroupPer =
-        contextDawn->makeBindGroup(groupLayoutPer, {
-                                                       {0, viewBuffer, 0, sizeof(ViewUniformPer)},
-                                                   });
-
-    contextDawn->setBufferData(lightFactorBuffer, 0, sizeof(LightFactorUniforms),
-                               &lightFactorUniforms);
+    bindGroupPer = contextDawn->makeBindGroup(
+        groupLayoutPer, {
+                            {0, contextDawn->getUniformRing(), 0, sizeof(ViewUniformPer)},
+                        });
 }
 
 void GenericModelDawn::preDraw() const
 {
-    contextDawn->setBufferData(viewBuffer, 0, sizeof(ViewUniformPer), &viewUniformPer);
 }
 
 void GenericModelDawn::draw()
 {
-    uint32_t vertexBufferOffsets[1] = {0};
-
-    dawn::RenderPassEncoder pass = contextDawn->pass;
-    pass.SetPipeline(pipeline);
-    pass.SetBindGroup(0, contextDawn->bindGroupGeneral);
-    pass.SetBindGroup(1, contextDawn->bindGroupWorld);
-    pass.SetBindGroup(2, bindGroupModel);
-    pass.SetBindGroup(3, bindGroupPer);
-    pass.SetVertexBuffers(0, 1, &positionBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(1, 1, &normalBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(2, 1, &texCoordBuffer->getBuffer(), vertexBufferOffsets);
-    // diffuseShader doesn't have to input tangent buffer or binormal buffer.
-    if (tangentBuffer && binormalBuffer && mName != MODELNAME::MODELGLOBEBASE)
+    contextDawn->updateUniformBuffer(lightFactorBuffer, lightFactorUniforms, &lightFactorUpload);
+
+    contextDawn->writeUniforms(static_cast<uint32_t>(viewUniformsOffset), &viewUniformPer,
+                               sizeof(ViewUniformPer));
+
+    // Instances are updated grouped by level of detail, so every level draws a range of them.
+    int firstInstance = 0;
+    for (size_t lod = 0; lod < lodInstanceCounts.size(); ++lod)
     {
-        pass.SetVertexBuffers(3, 1, &tangentBuffer->getBuffer(), vertexBufferOffsets);
-        pass.SetVertexBuffers(4, 1, &binormalBuffer->getBuffer(), vertexBufferOffsets);
+        int count = lodInstanceCounts[lod];
+        contextDawn->setDrawArgs(drawArgsSlot + static_cast<uint32_t>(lod), lods[lod].indexCount,
+                                 count, geometry.firstIndex + lods[lod].firstIndex,
+                                 geometry.baseVertex, firstInstance);
+        firstInstance += count;
     }
-    pass.SetIndexBuffer(indicesBuffer->getBuffer(), 0);
-    pass.DrawIndexed(indicesBuffer->getTotalComponents(), instance, 0, 0, 0);
     instance = 0;
+    lodInstanceCounts.clear();
+
+    contextDawn->drawStaticModel(this);
+}
+
+// Every level of detail is drawn indirectly, so the commands stay the same whichever levels a
+// frame draws.
+void GenericModelDawn::recordDraws(CommandListDawn *commands) const
+{
+    commands->setPipeline(pipeline);
+    commands->setBindGroup(0, contextDawn->bindGroupGeneral, 0, nullptr);
+    commands->setBindGroup(1, contextDawn->bindGroupWorld, 1,
+                           &contextDawn->lightWorldPositionOffset);
+    commands->setBindGroup(2, bindGroupModel, 0, nullptr);
+    commands->setBindGroup(3, bindGroupPer, 1, &viewUniformsOffset);
+    commands->setVertexBuffer(0, vertexBuffer->getBuffer(), 0);
+    commands->setIndexBuffer(indicesBuffer->getBuffer(), 0);
+    for (size_t lod = 0; lod < lods.size(); ++lod)
+    {
+        commands->drawIndexedIndirect(
+            contextDawn->getDrawArgsBuffer(),
+            ContextDawn::getDrawArgsOffset(drawArgsSlot + static_cast<uint32_t>(lod)));
+    }
 }
 
 void GenericModelDawn::updatePerInstanceUniforms(ViewUniforms *viewUniforms)
@@ -197,4 +180,10 @@ void GenericModelDawn::updatePerInstanceUniforms(ViewUniforms *viewUniforms)
     viewUniformPer.viewuniforms[instance] = *viewUniforms;
     //memcpy(viewUniformPer.viewuniforms + sizeof(ViewUniforms) * instance, viewUniforms, sizeof(ViewUniforms));
     instance++;
+
+    if (static_cast<int>(lodInstanceCounts.size()) <= mLod)
+    {
+        lodInstanceCounts.resize(mLod + 1, 0);
+    }
+    ++lodInstanceCounts[mLod];
 }
@@ -16,7 +16,7 @@
 #include "ProgramDawn.h"
 #include "dawn/dawncpp.h"
 
-class GenericModelDawn : public GenericModel
+class GenericModelDawn : public GenericModel, public StaticModelDawn
 {
 public:
     GenericModelDawn(const Context* context, Aquarium* aquarium, MODELGROUP type, MODELNAME name, bool blend);
@@ -24,6 +24,7 @@ public:
     void init() override;
     void preDraw() const override;
     void draw() override;
+    void recordDraws(CommandListDawn *commands) const override;
 
     void updatePerInstanceUniforms(ViewUniforms *viewUniforms) override;
 
@@ -33,11 +34,7 @@ public:
     TextureDawn *reflectionTexture;
     TextureDawn *skyboxTexture;
 
-    BufferDawn *positionBuffer;
-    BufferDawn *normalBuffer;
-    BufferDawn *texCoordBuffer;
-    BufferDawn *tangentBuffer;
-    BufferDawn *binormalBuffer;
+    BufferDawn *vertexBuffer;
 
     BufferDawn *indicesBuffer;
 
@@ -45,7 +42,8 @@ public:
     {
         float shininess;
         float specularFactor;
-    } lightFactorUniforms;
+    };
+    UniformBlock<LightFactorUniforms> lightFactorUniforms;
 
     struct ViewUniformPer
     {
@@ -65,12 +63,17 @@ private:
     dawn::BindGroup bindGroupPer;
 
     dawn::Buffer lightFactorBuffer;
-    dawn::Buffer viewBuffer;
+    UniformUpload lightFactorUpload;
 
     const ContextDawn *contextDawn;
     ProgramDawn* programDawn;
 
     int instance;
+    // Instances of every level of detail, which follow each other in viewUniformPer.
+    std::vector<int> lodInstanceCounts;
+    // Fixed offset of viewUniformPer, and the first indirect draw of the levels of detail.
+    uint64_t viewUniformsOffset;
+    uint32_t drawArgsSlot;
 };
 
 #endif
\ No newline at end of file
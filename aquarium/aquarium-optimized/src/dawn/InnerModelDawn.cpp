@@ -11,6 +11,8 @@ InnerModelDawn::InnerModelDawn(const Context* context, Aquarium* aquarium, MODEL
     : InnerModel(type, name, blend)
 {
     contextDawn = static_cast<const ContextDawn*>(context);
+    viewUniformsOffset = contextDawn->reserveFixedUniforms(sizeof(ViewUniforms));
+    drawArgsSlot       = contextDawn->reserveDrawArgs(1);
 
     innerUniforms.eta = 1.0f;
     innerUniforms.tankColorFudge = 0.796f;
@@ -26,26 +28,10 @@ void InnerModelDawn::init()
     reflectionTexture = static_cast<TextureDawn*>(textureMap["reflectionMap"]);
     skyboxTexture = static_cast<TextureDawn*>(textureMap["skybox"]);
 
-    positionBuffer = static_cast<BufferDawn*>(bufferMap["position"]);
-    normalBuffer = static_cast<BufferDawn*>(bufferMap["normal"]);
-    texCoordBuffer = static_cast<BufferDawn*>(bufferMap["texCoord"]);
-    tangentBuffer = static_cast<BufferDawn*>(bufferMap["tangent"]);
-    binormalBuffer = static_cast<BufferDawn*>(bufferMap["binormal"]);
-    indicesBuffer = static_cast<BufferDawn*>(bufferMap["indices"]);
-
-    inputState = contextDawn->createInputState({
-        { 0, 0, dawn::VertexFormat::FloatR32G32B32, 0 },
-        { 1, 1, dawn::VertexFormat::FloatR32G32B32, 0 },
-        { 2, 2, dawn::VertexFormat::FloatR32G32, 0 },
-        { 3, 3, dawn::VertexFormat::FloatR32G32B32, 0 },
-        { 4, 4, dawn::VertexFormat::FloatR32G32B32, 0 },
-    }, {
-        { 0, positionBuffer->getDataSize(), dawn::InputStepMode::Vertex },
-        { 1, normalBuffer->getDataSize(), dawn::InputStepMode::Vertex },
-        { 2, texCoordBuffer->getDataSize(), dawn::InputStepMode::Vertex },
-        { 3, tangentBuffer->getDataSize(), dawn::InputStepMode::Vertex },
-        { 4, binormalBuffer->getDataSize(), dawn::InputStepMode::Vertex }
-    });
+    vertexBuffer = static_cast<BufferDawn*>(geometry.vertexBuffer);
+    indicesBuffer = static_cast<BufferDawn*>(geometry.indexBuffer);
+
+    inputState = contextDawn->createInputState(vertexLayout);
 
     groupLayoutModel = contextDawn->MakeBindGroupLayout({
        { 0, dawn::ShaderStageBit::Fragment, dawn::BindingType::UniformBuffer },
@@ -58,7 +44,7 @@ void InnerModelDawn::init()
     });
 
     groupLayoutPer = contextDawn->MakeBindGroupLayout({
-        {0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer},
+        {0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer, true},
     });
     
     pipelineLayout = contextDawn->MakeBasicPipelineLayout({ contextDawn->groupLayoutGeneral,
@@ -67,12 +53,10 @@ void InnerModelDawn::init()
         groupLayoutPer,
     });
 
-    pipeline = contextDawn->createRenderPipeline(pipelineLayout, programDawn, inputState, mBlend);
+    pipeline = contextDawn->createRenderPipeline(pipelineLayout, programDawn, inputState, mBlend,
+                                                 geometry.indexFormat);
 
     innerBuffer = contextDawn->createBufferFromData(&innerUniforms, sizeof(innerUniforms), dawn::BufferUsageBit::TransferDst | dawn::BufferUsageBit::Uniform);
-    viewBuffer = contextDawn->createBufferFromData(
-        &viewUniformPer, sizeof(ViewUniforms),
-        dawn::BufferUsageBit::TransferDst | dawn::BufferUsageBit::Uniform);
 
     std::initializer_list<dawn::Sampler> samplersInitializer = { reflectionTexture->getSampler(), skyboxTexture->getSampler() };
     std::initializer_list<dawn::TextureView> textureViewsInitializer = { diffuseTexture->getTextureView(),
@@ -88,10 +72,10 @@ void InnerModelDawn::init()
         { 6, skyboxTexture->getTextureView() }
     });
 
-    bindGroupPer =
-        contextDawn->makeBindGroup(groupLayoutPer, {
-                                                       {0, viewBuffer, 0, sizeof(ViewUniforms)},
-                                                   });
+    bindGroupPer = contextDawn->makeBindGroup(
+        groupLayoutPer, {
+                            {0, contextDawn->getUniformRing(), 0, sizeof(ViewUniforms)},
+                        });
 
     contextDawn->setBufferData(innerBuffer, 0, sizeof(InnerUniforms), &innerUniforms);
 }
@@ -102,26 +86,28 @@ void InnerModelDawn::preDraw() const
 
 void InnerModelDawn::draw()
 {
-    uint32_t vertexBufferOffsets[1] = { 0 };
-
-    dawn::RenderPassEncoder pass = contextDawn->pass;
-    pass.SetPipeline(pipeline);
-    pass.SetBindGroup(0, contextDawn->bindGroupGeneral);
-    pass.SetBindGroup(1, contextDawn->bindGroupWorld);
-    pass.SetBindGroup(2, bindGroupModel);
-    pass.SetBindGroup(3, bindGroupPer);
-    pass.SetVertexBuffers(0, 1, &positionBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(1, 1, &normalBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(2, 1, &texCoordBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(3, 1, &tangentBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(4, 1, &binormalBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetIndexBuffer(indicesBuffer->getBuffer(), 0);
-    pass.DrawIndexed(indicesBuffer->getTotalComponents(), 1, 0, 0, 0);
+    contextDawn->writeUniforms(static_cast<uint32_t>(viewUniformsOffset), &viewUniformPer,
+                               sizeof(ViewUniforms));
+    contextDawn->setDrawArgs(drawArgsSlot, geometry.indexCount, 1, geometry.firstIndex,
+                             geometry.baseVertex, 0);
+    contextDawn->drawStaticModel(this);
+}
+
+void InnerModelDawn::recordDraws(CommandListDawn *commands) const
+{
+    commands->setPipeline(pipeline);
+    commands->setBindGroup(0, contextDawn->bindGroupGeneral, 0, nullptr);
+    commands->setBindGroup(1, contextDawn->bindGroupWorld, 1,
+                           &contextDawn->lightWorldPositionOffset);
+    commands->setBindGroup(2, bindGroupModel, 0, nullptr);
+    commands->setBindGroup(3, bindGroupPer, 1, &viewUniformsOffset);
+    commands->setVertexBuffer(0, vertexBuffer->getBuffer(), 0);
+    commands->setIndexBuffer(indicesBuffer->getBuffer(), 0);
+    commands->drawIndexedIndirect(contextDawn->getDrawArgsBuffer(),
+                                  ContextDawn::getDrawArgsOffset(drawArgsSlot));
 }
 
 void InnerModelDawn::updatePerInstanceUniforms(ViewUniforms* viewUniforms)
 {
     memcpy(&viewUniformPer, viewUniforms, sizeof(ViewUniforms));
-
-    contextDawn->setBufferData(viewBuffer, 0, sizeof(ViewUniforms), &viewUniformPer);
 }
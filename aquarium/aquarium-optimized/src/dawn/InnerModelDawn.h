@@ -14,7 +14,7 @@
 #include "ProgramDawn.h"
 #include "dawn/dawncpp.h"
 
-class InnerModelDawn : public InnerModel
+class InnerModelDawn : public InnerModel, public StaticModelDawn
 {
   public:
     InnerModelDawn(const Context* context, Aquarium* aquarium, MODELGROUP type, MODELNAME name, bool blend);
@@ -22,6 +22,7 @@ class InnerModelDawn : public InnerModel
     void init() override;
     void preDraw() const override;
     void draw() override;
+    void recordDraws(CommandListDawn *commands) const override;
     void updatePerInstanceUniforms(ViewUniforms *viewUniforms) override;
 
     struct InnerUniforms
@@ -39,11 +40,7 @@ class InnerModelDawn : public InnerModel
     TextureDawn *reflectionTexture;
     TextureDawn *skyboxTexture;
 
-    BufferDawn *positionBuffer;
-    BufferDawn *normalBuffer;
-    BufferDawn *texCoordBuffer;
-    BufferDawn *tangentBuffer;
-    BufferDawn *binormalBuffer;
+    BufferDawn *vertexBuffer;
 
     BufferDawn *indicesBuffer;
 
@@ -60,10 +57,13 @@ private:
     dawn::BindGroup bindGroupPer;
 
     dawn::Buffer innerBuffer;
-    dawn::Buffer viewBuffer;
 
     const ContextDawn *contextDawn;
     ProgramDawn* programDawn;
+
+    // Fixed offset of viewUniformPer, and the indirect draw of the model.
+    uint64_t viewUniformsOffset;
+    uint32_t drawArgsSlot;
 };
 
 #endif // !INNERMODELDAWN_H
@@ -9,9 +9,12 @@ OutsideModelDawn::OutsideModelDawn(const Context* context, Aquarium* aquarium, M
     : OutsideModel(type, name, blend)
 {
     contextDawn = static_cast<const ContextDawn*>(context);
+    viewUniformsOffset = contextDawn->reserveFixedUniforms(sizeof(ViewUniforms));
+    drawArgsSlot       = contextDawn->reserveDrawArgs(1);
 
-    lightFactorUniforms.shininess = 50.0f;
-    lightFactorUniforms.specularFactor = 0.0f;
+    LightFactorUniforms &lightFactor = lightFactorUniforms.edit();
+    lightFactor.shininess      = 50.0f;
+    lightFactor.specularFactor = 0.0f;
 }
 
 void OutsideModelDawn::init()
@@ -23,29 +26,13 @@ void OutsideModelDawn::init()
     reflectionTexture = static_cast<TextureDawn*>(textureMap["reflectionMap"]);
     skyboxTexture = static_cast<TextureDawn*>(textureMap["skybox"]);
 
-    positionBuffer = static_cast<BufferDawn*>(bufferMap["position"]);
-    normalBuffer = static_cast<BufferDawn*>(bufferMap["normal"]);
-    texCoordBuffer = static_cast<BufferDawn*>(bufferMap["texCoord"]);
-    tangentBuffer = static_cast<BufferDawn*>(bufferMap["tangent"]);
-    binormalBuffer = static_cast<BufferDawn*>(bufferMap["binormal"]);
-    indicesBuffer = static_cast<BufferDawn*>(bufferMap["indices"]);
-
-    inputState = contextDawn->createInputState({
-        { 0, 0, dawn::VertexFormat::FloatR32G32B32, 0 },
-        { 1, 1, dawn::VertexFormat::FloatR32G32B32, 0 },
-        { 2, 2, dawn::VertexFormat::FloatR32G32, 0 },
-        { 3, 3, dawn::VertexFormat::FloatR32G32B32, 0 },
-        { 4, 4, dawn::VertexFormat::FloatR32G32B32, 0 },
-    }, {
-        { 0, positionBuffer->getDataSize(), dawn::InputStepMode::Vertex },
-        { 1, normalBuffer->getDataSize(), dawn::InputStepMode::Vertex },
-        { 2, texCoordBuffer->getDataSize(), dawn::InputStepMode::Vertex },
-        { 3, tangentBuffer->getDataSize(), dawn::InputStepMode::Vertex },
-        { 4, binormalBuffer->getDataSize(), dawn::InputStepMode::Vertex }
-    });
+    vertexBuffer = static_cast<BufferDawn*>(geometry.vertexBuffer);
+    indicesBuffer = static_cast<BufferDawn*>(geometry.indexBuffer);
+
+    inputState = contextDawn->createInputState(vertexLayout);
 
     groupLayoutPer = contextDawn->MakeBindGroupLayout({
-        {0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer},
+        {0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer, true},
     });
 
     // Outside models use diffuse shaders.
@@ -61,13 +48,11 @@ void OutsideModelDawn::init()
         groupLayoutPer,
     });
 
-    pipeline = contextDawn->createRenderPipeline(pipelineLayout, programDawn, inputState, mBlend);
+    pipeline = contextDawn->createRenderPipeline(pipelineLayout, programDawn, inputState, mBlend,
+                                                 geometry.indexFormat);
 
-    lightFactorBuffer = contextDawn->createBufferFromData(
-        &lightFactorUniforms, sizeof(lightFactorUniforms),
-        dawn::BufferUsageBit::TransferDst | dawn::BufferUsageBit::Uniform);
-    viewBuffer = contextDawn->createBufferFromData(
-        &viewUniformPer, sizeof(ViewUniforms),
+    lightFactorBuffer = contextDawn->createBuffer(
+        sizeof(LightFactorUniforms),
         dawn::BufferUsageBit::TransferDst | dawn::BufferUsageBit::Uniform);
 
     bindGroupModel = contextDawn->makeBindGroup(groupLayoutModel, {
@@ -77,10 +62,8 @@ void OutsideModelDawn::init()
     });
 
     bindGroupPer = contextDawn->makeBindGroup(groupLayoutPer, {
-        {0, viewBuffer, 0, sizeof(ViewUniforms)},
+        {0, contextDawn->getUniformRing(), 0, sizeof(ViewUniforms)},
     });
-
-    contextDawn->setBufferData(lightFactorBuffer, 0, sizeof(LightFactorUniforms), &lightFactorUniforms);
 }
 
 void OutsideModelDawn::preDraw() const
@@ -89,28 +72,29 @@ void OutsideModelDawn::preDraw() const
 
 void OutsideModelDawn::draw()
 {
-    uint32_t vertexBufferOffsets[1] = { 0 };
-
-    dawn::RenderPassEncoder pass = contextDawn->pass;
-    pass.SetPipeline(pipeline);
-    pass.SetBindGroup(0, contextDawn->bindGroupGeneral);
-    pass.SetBindGroup(1, contextDawn->bindGroupWorld);
-    pass.SetBindGroup(2, bindGroupModel);
-    pass.SetBindGroup(3, bindGroupPer);
-    pass.SetVertexBuffers(0, 1, &positionBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(1, 1, &normalBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(2, 1, &texCoordBuffer->getBuffer(), vertexBufferOffsets);
-    // diffuseShader doesn't have to input tangent buffer or binormal buffer.
-    if (tangentBuffer && binormalBuffer) {
-        pass.SetVertexBuffers(3, 1, &tangentBuffer->getBuffer(), vertexBufferOffsets);
-        pass.SetVertexBuffers(4, 1, &binormalBuffer->getBuffer(), vertexBufferOffsets);
-    }
-    pass.SetIndexBuffer(indicesBuffer->getBuffer(), 0);
-    pass.DrawIndexed(indicesBuffer->getTotalComponents(), 1, 0, 0, 0);
+    contextDawn->updateUniformBuffer(lightFactorBuffer, lightFactorUniforms, &lightFactorUpload);
+
+    contextDawn->writeUniforms(static_cast<uint32_t>(viewUniformsOffset), &viewUniformPer,
+                               sizeof(ViewUniforms));
+    contextDawn->setDrawArgs(drawArgsSlot, geometry.indexCount, 1, geometry.firstIndex,
+                             geometry.baseVertex, 0);
+    contextDawn->drawStaticModel(this);
+}
+
+void OutsideModelDawn::recordDraws(CommandListDawn *commands) const
+{
+    commands->setPipeline(pipeline);
+    commands->setBindGroup(0, contextDawn->bindGroupGeneral, 0, nullptr);
+    commands->setBindGroup(1, contextDawn->bindGroupWorld, 1,
+                           &contextDawn->lightWorldPositionOffset);
+    commands->setBindGroup(2, bindGroupModel, 0, nullptr);
+    commands->setBindGroup(3, bindGroupPer, 1, &viewUniformsOffset);
+    commands->setVertexBuffer(0, vertexBuffer->getBuffer(), 0);
+    commands->setIndexBuffer(indicesBuffer->getBuffer(), 0);
+    commands->drawIndexedIndirect(contextDawn->getDrawArgsBuffer(),
+                                  ContextDawn::getDrawArgsOffset(drawArgsSlot));
 }
 
 void OutsideModelDawn::updatePerInstanceUniforms(ViewUniforms *viewUniforms) {
     memcpy(&viewUniformPer, viewUniforms, sizeof(ViewUniforms));
-
-    contextDawn->setBufferData(viewBuffer, 0, sizeof(ViewUniforms), &viewUniformPer);
 }
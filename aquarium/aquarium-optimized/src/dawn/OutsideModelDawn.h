@@ -16,7 +16,7 @@
 #include "ProgramDawn.h"
 #include "dawn/dawncpp.h"
 
-class OutsideModelDawn : public OutsideModel
+class OutsideModelDawn : public OutsideModel, public StaticModelDawn
 {
 public:
     OutsideModelDawn(const Context* context, Aquarium* aquarium, MODELGROUP type, MODELNAME name, bool blend);
@@ -24,6 +24,7 @@ public:
     void init() override;
     void preDraw() const override;
     void draw() override;
+    void recordDraws(CommandListDawn *commands) const override;
 
     void updatePerInstanceUniforms(ViewUniforms *viewUniforms) override;
 
@@ -32,11 +33,7 @@ public:
     TextureDawn *reflectionTexture;
     TextureDawn *skyboxTexture;
 
-    BufferDawn *positionBuffer;
-    BufferDawn *normalBuffer;
-    BufferDawn *texCoordBuffer;
-    BufferDawn *tangentBuffer;
-    BufferDawn *binormalBuffer;
+    BufferDawn *vertexBuffer;
 
     BufferDawn *indicesBuffer;
 
@@ -44,7 +41,8 @@ public:
     {
         float shininess;
         float specularFactor;
-    } lightFactorUniforms;
+    };
+    UniformBlock<LightFactorUniforms> lightFactorUniforms;
 
     ViewUniforms viewUniformPer;
 
@@ -60,10 +58,14 @@ private:
     dawn::BindGroup bindGroupPer;
 
     dawn::Buffer lightFactorBuffer;
-    dawn::Buffer viewBuffer;
+    UniformUpload lightFactorUpload;
 
     const ContextDawn *contextDawn;
     ProgramDawn* programDawn;
+
+    // Fixed offset of viewUniformPer, and the indirect draw of the model.
+    uint64_t viewUniformsOffset;
+    uint32_t drawArgsSlot;
 };
 
 #endif
\ No newline at end of file
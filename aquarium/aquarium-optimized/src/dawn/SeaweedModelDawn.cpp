@@ -8,13 +8,17 @@
 #include "SeaweedModelDawn.h"
 
 SeaweedModelDawn::SeaweedModelDawn(const Context* context, Aquarium* aquarium, MODELGROUP type, MODELNAME name, bool blend)
-    : SeaweedModel(type, name, blend), instance(0)
+    : SeaweedModel(type, name, blend), instance(0), instanceIndex(0)
 {
     contextDawn = static_cast<const ContextDawn*>(context);
+    perOffsets[0] = contextDawn->reserveFixedUniforms(sizeof(ViewUniformPer));
+    perOffsets[1] = contextDawn->reserveFixedUniforms(sizeof(SeaweedPer));
+    drawArgsSlot  = contextDawn->reserveDrawArgs(1);
     mAquarium   = aquarium;
 
-    lightFactorUniforms.shininess = 50.0f;
-    lightFactorUniforms.specularFactor = 1.0f;
+    LightFactorUniforms &lightFactor = lightFactorUniforms.edit();
+    lightFactor.shininess      = 50.0f;
+    lightFactor.specularFactor = 1.0f;
 }
 
 void SeaweedModelDawn::init()
@@ -26,20 +30,10 @@ void SeaweedModelDawn::init()
     reflectionTexture = static_cast<TextureDawn*>(textureMap["reflectionMap"]);
     skyboxTexture = static_cast<TextureDawn*>(textureMap["skybox"]);
 
-    positionBuffer = static_cast<BufferDawn*>(bufferMap["position"]);
-    normalBuffer = static_cast<BufferDawn*>(bufferMap["normal"]);
-    texCoordBuffer = static_cast<BufferDawn*>(bufferMap["texCoord"]);
-    indicesBuffer = static_cast<BufferDawn*>(bufferMap["indices"]);
-
-    inputState = contextDawn->createInputState({
-        { 0, 0, dawn::VertexFormat::FloatR32G32B32, 0 },
-        { 1, 1, dawn::VertexFormat::FloatR32G32B32, 0 },
-        { 2, 2, dawn::VertexFormat::FloatR32G32, 0 },
-    }, {
-        { 0, positionBuffer->getDataSize(), dawn::InputStepMode::Vertex },
-        { 1, normalBuffer->getDataSize(), dawn::InputStepMode::Vertex },
-        { 2, texCoordBuffer->getDataSize(), dawn::InputStepMode::Vertex },
-    });
+    vertexBuffer = static_cast<BufferDawn*>(geometry.vertexBuffer);
+    indicesBuffer = static_cast<BufferDawn*>(geometry.indexBuffer);
+
+    inputState = contextDawn->createInputState(vertexLayout);
 
     groupLayoutModel = contextDawn->MakeBindGroupLayout({
         { 0, dawn::ShaderStageBit::Fragment, dawn::BindingType::UniformBuffer },
@@ -48,8 +42,8 @@ void SeaweedModelDawn::init()
     });
 
     groupLayoutPer = contextDawn->MakeBindGroupLayout({
-        { 0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer},
-        { 1, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer},
+        { 0, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer, true},
+        { 1, dawn::ShaderStageBit::Vertex, dawn::BindingType::UniformBuffer, true},
     });
 
     pipelineLayout = contextDawn->MakeBasicPipelineLayout({ contextDawn->groupLayoutGeneral,
@@ -58,14 +52,11 @@ void SeaweedModelDawn::init()
         groupLayoutPer,
     });
 
-    pipeline = contextDawn->createRenderPipeline(pipelineLayout, programDawn, inputState, mBlend);
+    pipeline = contextDawn->createRenderPipeline(pipelineLayout, programDawn, inputState, mBlend,
+                                                 geometry.indexFormat);
 
-    lightFactorBuffer = contextDawn->createBufferFromData(
-        &lightFactorUniforms, sizeof(lightFactorUniforms),
-        dawn::BufferUsageBit::TransferDst | dawn::BufferUsageBit::Uniform);
-    timeBuffer = contextDawn->createBufferFromData(&seaweedPer, sizeof(seaweedPer), dawn::BufferUsageBit::TransferDst | dawn::BufferUsageBit::Uniform);
-    viewBuffer = contextDawn->createBufferFromData(
-        &viewUniformPer, sizeof(ViewUniformPer),
+    lightFactorBuffer = contextDawn->createBuffer(
+        sizeof(LightFactorUniforms),
         dawn::BufferUsageBit::TransferDst | dawn::BufferUsageBit::Uniform);
 
     bindGroupModel = contextDawn->makeBindGroup(groupLayoutModel, {
@@ -75,45 +66,57 @@ void SeaweedModelDawn::init()
     });
 
     bindGroupPer = contextDawn->makeBindGroup(groupLayoutPer, {
-        { 0, viewBuffer, 0, sizeof(ViewUniformPer)},
-        { 1, timeBuffer, 0, sizeof(SeaweedPer) },
+        { 0, contextDawn->getUniformRing(), 0, sizeof(ViewUniformPer)},
+        { 1, contextDawn->getUniformRing(), 0, sizeof(SeaweedPer) },
     });
-
-    contextDawn->setBufferData(lightFactorBuffer, 0, sizeof(lightFactorUniforms), &lightFactorUniforms);
 }
 
 void SeaweedModelDawn::preDraw() const
 {
-    contextDawn->setBufferData(viewBuffer, 0, sizeof(ViewUniformPer), &viewUniformPer);
-    contextDawn->setBufferData(timeBuffer, 0, sizeof(SeaweedPer), &seaweedPer);
 }
 
 void SeaweedModelDawn::draw()
 {
-    uint32_t vertexBufferOffsets[1] = { 0 };
-
-    dawn::RenderPassEncoder pass = contextDawn->pass;
-    pass.SetPipeline(pipeline);
-    pass.SetBindGroup(0, contextDawn->bindGroupGeneral);
-    pass.SetBindGroup(1, contextDawn->bindGroupWorld);
-    pass.SetBindGroup(2, bindGroupModel);
-    pass.SetBindGroup(3, bindGroupPer);
-    pass.SetVertexBuffers(0, 1, &positionBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(1, 1, &normalBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetVertexBuffers(2, 1, &texCoordBuffer->getBuffer(), vertexBufferOffsets);
-    pass.SetIndexBuffer(indicesBuffer->getBuffer(), 0);
-    pass.DrawIndexed(indicesBuffer->getTotalComponents(), instance, 0, 0, 0);
+    contextDawn->updateUniformBuffer(lightFactorBuffer, lightFactorUniforms, &lightFactorUpload);
+
+    contextDawn->writeUniforms(static_cast<uint32_t>(perOffsets[0]), &viewUniformPer,
+                               sizeof(ViewUniformPer));
+    contextDawn->writeUniforms(static_cast<uint32_t>(perOffsets[1]), &seaweedPer,
+                               sizeof(SeaweedPer));
+    contextDawn->setDrawArgs(drawArgsSlot, geometry.indexCount, instance, geometry.firstIndex,
+                             geometry.baseVertex, 0);
     instance = 0;
+
+    contextDawn->drawStaticModel(this);
+}
+
+void SeaweedModelDawn::recordDraws(CommandListDawn *commands) const
+{
+    commands->setPipeline(pipeline);
+    commands->setBindGroup(0, contextDawn->bindGroupGeneral, 0, nullptr);
+    commands->setBindGroup(1, contextDawn->bindGroupWorld, 1,
+                           &contextDawn->lightWorldPositionOffset);
+    commands->setBindGroup(2, bindGroupModel, 0, nullptr);
+    commands->setBindGroup(3, bindGroupPer, 2, perOffsets);
+    commands->setVertexBuffer(0, vertexBuffer->getBuffer(), 0);
+    commands->setIndexBuffer(indicesBuffer->getBuffer(), 0);
+    commands->drawIndexedIndirect(contextDawn->getDrawArgsBuffer(),
+                                  ContextDawn::getDrawArgsOffset(drawArgsSlot));
 }
 
 void SeaweedModelDawn::updatePerInstanceUniforms(ViewUniforms *viewUniforms)
 {
     viewUniformPer.viewuniforms[instance] = *viewUniforms;
-    seaweedPer.time[instance]             = mAquarium->g.mclock + instance;
+    seaweedPer.time[instance]             = mAquarium->g.mclock + instanceIndex;
 
     instance++;
 }
 
+void SeaweedModelDawn::setInstanceIndex(int index)
+{
+    instanceIndex = index;
+}
+
 void SeaweedModelDawn::updateSeaweedModelTime(float time)
 {
 }
@@ -14,7 +14,7 @@
 #include "ProgramDawn.h"
 #include "dawn/dawncpp.h"
 
-class SeaweedModelDawn : public SeaweedModel
+class SeaweedModelDawn : public SeaweedModel, public StaticModelDawn
 {
   public:
     SeaweedModelDawn(const Context* context, Aquarium* aquarium, MODELGROUP type, MODELNAME name, bool blend);
@@ -22,8 +22,10 @@ class SeaweedModelDawn : public SeaweedModel
     void init() override;
     void preDraw() const override;
     void draw() override;
+    void recordDraws(CommandListDawn *commands) const override;
 
     void updatePerInstanceUniforms(ViewUniforms *viewUniforms) override;
+    void setInstanceIndex(int index) override;
 
 
     TextureDawn *diffuseTexture;
@@ -31,9 +33,7 @@ class SeaweedModelDawn : public SeaweedModel
     TextureDawn *reflectionTexture;
     TextureDawn *skyboxTexture;
 
-    BufferDawn *positionBuffer;
-    BufferDawn *normalBuffer;
-    BufferDawn *texCoordBuffer;
+    BufferDawn *vertexBuffer;
 
     BufferDawn *indicesBuffer;
     void updateSeaweedModelTime(float time) override;
@@ -42,7 +42,8 @@ class SeaweedModelDawn : public SeaweedModel
     {
         float shininess;
         float specularFactor;
-    } lightFactorUniforms;
+    };
+    UniformBlock<LightFactorUniforms> lightFactorUniforms;
 
     struct SeaweedPer
     {
@@ -67,14 +68,19 @@ class SeaweedModelDawn : public SeaweedModel
     dawn::BindGroup bindGroupPer;
 
     dawn::Buffer lightFactorBuffer;
-    dawn::Buffer timeBuffer;
-    dawn::Buffer viewBuffer;
+    UniformUpload lightFactorUpload;
 
     const ContextDawn *contextDawn;
     ProgramDawn* programDawn;
     Aquarium * mAquarium;
 
     int instance;
+    // Placement index of the instance updated next, which offsets its sway.
+    int instanceIndex;
+    // Fixed offsets of viewUniformPer and seaweedPer, in the order of their bindings, and the
+    // indirect draw of the model.
+    uint64_t perOffsets[2];
+    uint32_t drawArgsSlot;
 };
 
 #endif // !SEAWEEDMODEL_H
\ No newline at end of file
@@ -16,8 +16,15 @@
 
 TextureDawn::~TextureDawn() {
 
+    releaseImageData();
+}
+
+void TextureDawn::releaseImageData()
+{
     DestoryImageData(mPixelVec);
     DestoryImageData(mResizedVec);
+    mPixelVec.clear();
+    mResizedVec.clear();
 }
 
 TextureDawn::TextureDawn(ContextDawn *context, std::string name, std::string url)
@@ -65,12 +72,8 @@ void TextureDawn::loadTexture()
 
         for (unsigned int i = 0; i < 6; i++)
         {
-            dawn::Buffer stagingBuffer = context->createBufferFromData(mPixelVec[i], mWidth * mHeight * 4, dawn::BufferUsageBit::TransferSrc);
-            dawn::BufferCopyView bufferCopyView = context->createBufferCopyView(stagingBuffer, 0, mWidth * 4, mHeight);
-            dawn::TextureCopyView textureCopyView = context->createTextureCopyView(mTexture, 0, i, { 0, 0, 0 });
-            dawn::Extent3D copySize = { static_cast<uint32_t>(mWidth), static_cast<uint32_t>(mHeight), 1 };
-            dawn::CommandBuffer cmd = context->copyBufferToTexture(bufferCopyView, textureCopyView, copySize);
-            context->submit(1, cmd);
+            context->uploadTexture(this, mTexture, 0, i, mPixelVec[i], mWidth * 4, mWidth,
+                                   mHeight);
         }
 
         dawn::TextureViewDescriptor viewDescriptor;
@@ -129,15 +132,8 @@ void TextureDawn::loadTexture()
             int width                  = resizedWidth >> i;
             if (width ==0 || height == 0)
                 break;
-            dawn::Buffer stagingBuffer = context->createBufferFromData(mResizedVec[i], resizedWidth * height * 4, dawn::BufferUsageBit::TransferSrc);
-            dawn::BufferCopyView bufferCopyView = context->createBufferCopyView(stagingBuffer, 0, resizedWidth * 4, height);
-            dawn::TextureCopyView textureCopyView = context->createTextureCopyView(mTexture, i, 0, { 0, 0, 0 });
-            dawn::Extent3D copySize = {static_cast<uint32_t>(width),
-                                       static_cast<uint32_t>(height),
-                                       1};
-            dawn::CommandBuffer cmd = context->copyBufferToTexture(bufferCopyView, textureCopyView, copySize);
-
-            context->submit(1, cmd);
+            context->uploadTexture(this, mTexture, i, 0, mResizedVec[i], resizedWidth * 4, width,
+                                   height);
         }
 
         dawn::TextureViewDescriptor viewDescriptor;
@@ -174,6 +170,6 @@ void TextureDawn::loadTexture()
         mSampler = context->createSampler(samplerDesc);
     }
 
-    // TODO(yizhou): check if the pixel destory should delay or fence
+    // Pixels are released by the context once the copies queued above are submitted.
 }
 
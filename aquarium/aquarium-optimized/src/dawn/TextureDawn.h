@@ -28,6 +28,8 @@ class TextureDawn : public Texture
     dawn::TextureView getTextureView() { return mTextureView; }
 
     void loadTexture() override;
+    // Free pixels of the image and its mipmaps once their upload is submitted.
+    void releaseImageData();
 
   private:
     dawn::TextureDimension mTextureDimension;  // texture 2D or CubeMap
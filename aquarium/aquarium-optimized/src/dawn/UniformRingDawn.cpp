@@ -0,0 +1,89 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// UniformRingDawn.cpp: Implements the per frame uniform buffer of Dawn.
+
+#include "UniformRingDawn.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "../ASSERT.h"
+#include "ContextDawn.h"
+
+UniformRingDawn::UniformRingDawn()
+    : mContext(nullptr),
+      mBuffer(nullptr),
+      mFixedSize(0),
+      mReserved(0),
+      mHead(0),
+      mDirtyBegin(0),
+      mDirtyEnd(0)
+{
+}
+
+void UniformRingDawn::reserve(size_t size)
+{
+    mReserved += (size + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+uint32_t UniformRingDawn::reserveFixed(size_t size)
+{
+    ASSERT(mStaging.empty());
+    uint32_t offset = static_cast<uint32_t>(mFixedSize);
+    mFixedSize += (size + kAlignment - 1) / kAlignment * kAlignment;
+    return offset;
+}
+
+void UniformRingDawn::init(const ContextDawn *context)
+{
+    mContext = context;
+    mStaging.resize(std::max(mFixedSize + mReserved, kAlignment));
+    mHead       = mFixedSize;
+    mDirtyBegin = mStaging.size();
+    mBuffer = mContext->createBuffer(static_cast<uint32_t>(mStaging.size()),
+                                     dawn::BufferUsageBit::TransferDst |
+                                         dawn::BufferUsageBit::Uniform);
+}
+
+// The ring holds every block reserved, so it only runs out if a model allocates more than it
+// reserved. The blocks of the rest of the frame then reuse its first blocks, which draws
+// them with wrong uniforms for a frame rather than writing past the staging copy.
+uint32_t UniformRingDawn::allocate(const void *data, size_t size)
+{
+    ASSERT(mHead + size <= mStaging.size());
+    if (mHead + size > mStaging.size())
+    {
+        mHead = mFixedSize;
+    }
+
+    uint32_t offset = static_cast<uint32_t>(mHead);
+    write(offset, data, size);
+    mHead += (size + kAlignment - 1) / kAlignment * kAlignment;
+
+    return offset;
+}
+
+void UniformRingDawn::write(uint32_t offset, const void *data, size_t size)
+{
+    memcpy(mStaging.data() + offset, data, size);
+    mDirtyBegin = std::min(mDirtyBegin, static_cast<size_t>(offset));
+    mDirtyEnd   = std::max(mDirtyEnd, offset + size);
+}
+
+void UniformRingDawn::flush()
+{
+    if (mDirtyEnd > mDirtyBegin)
+    {
+        mContext->setBufferData(mBuffer, static_cast<uint32_t>(mDirtyBegin),
+                                static_cast<uint32_t>(mDirtyEnd - mDirtyBegin),
+                                mStaging.data() + mDirtyBegin);
+    }
+    mHead       = mFixedSize;
+    mDirtyBegin = mStaging.size();
+    mDirtyEnd   = 0;
+}
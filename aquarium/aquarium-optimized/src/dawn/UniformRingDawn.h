@@ -0,0 +1,58 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// UniformRingDawn.h: Defines the uniform buffer that uniform blocks of every frame are
+// sub-allocated from. Blocks are gathered in a staging copy and uploaded together when the frame
+// is submitted, and bind groups select them with dynamic offsets. Bind groups hold the buffer, so
+// it is sized once from the blocks every model reserves for a frame. Blocks of static models sit
+// at fixed offsets at the start of the buffer, so that their recorded commands never change.
+
+#pragma once
+#ifndef UNIFORMRINGDAWN_H
+#define UNIFORMRINGDAWN_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "dawn/dawncpp.h"
+
+class ContextDawn;
+
+class UniformRingDawn
+{
+  public:
+    UniformRingDawn();
+
+    // Make room for a block of size bytes in every frame. Blocks are reserved before init.
+    void reserve(size_t size);
+    // Reserve a block of size bytes that always lives at the returned offset.
+    uint32_t reserveFixed(size_t size);
+    void init(const ContextDawn *context);
+    // Copy a block into the staging copy of the frame and return its offset in the buffer.
+    uint32_t allocate(const void *data, size_t size);
+    // Copy a block into the staging copy at an offset returned by reserveFixed.
+    void write(uint32_t offset, const void *data, size_t size);
+    // Upload the blocks of the frame in one copy, and start the next frame.
+    void flush();
+    const dawn::Buffer &getBuffer() const { return mBuffer; }
+
+  private:
+    // Dynamic offsets of uniform buffers are aligned to 256 bytes.
+    static constexpr size_t kAlignment = 256;
+
+    const ContextDawn *mContext;
+    dawn::Buffer mBuffer;
+    std::vector<unsigned char> mStaging;
+    // Bytes of the fixed blocks, which allocations of the frame follow, and of those allocations.
+    size_t mFixedSize;
+    size_t mReserved;
+    size_t mHead;
+    // Range of the staging copy written in the frame, uploaded by flush.
+    size_t mDirtyBegin;
+    size_t mDirtyEnd;
+};
+
+#endif
@@ -40,6 +40,18 @@ void BufferGL::loadBuffer(const std::vector<unsigned short> &buf)
     context->uploadBuffer(mTarget, buf);
 }
 
+void BufferGL::loadBuffer(const std::vector<unsigned int> &buf)
+{
+    context->bindBuffer(mTarget, mBuf);
+    context->uploadBuffer(mTarget, buf);
+}
+
+void BufferGL::loadBuffer(const std::vector<unsigned char> &buf)
+{
+    context->bindBuffer(mTarget, mBuf);
+    context->uploadBuffer(mTarget, buf);
+}
+
 BufferGL::~BufferGL()
 {
     context->deleteBuffer(&mBuf);
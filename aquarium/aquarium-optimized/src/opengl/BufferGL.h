@@ -49,6 +49,8 @@ class BufferGL : public Buffer
     const unsigned int getTarget() const { return mTarget; }
     void loadBuffer(const std::vector<float> &buf);
     void loadBuffer(const std::vector<unsigned short> &buf);
+    void loadBuffer(const std::vector<unsigned int> &buf);
+    void loadBuffer(const std::vector<unsigned char> &buf);
 
   private:
     ContextGL *context;
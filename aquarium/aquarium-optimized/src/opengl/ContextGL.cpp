@@ -8,6 +8,8 @@
 #include "../ASSERT.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 
 #include "BufferGL.h"
 #include "ContextGL.h"
@@ -17,6 +19,7 @@
 #include "FishModelGL.h"
 #include "GenericModelGL.h"
 #include "InnerModelGL.h"
+#include "MultiDrawGL.h"
 #include "OutsideModelGL.h"
 #include "SeaweedModelGL.h"
 
@@ -27,11 +30,56 @@
 #include <GLFW/glfw3native.h>
 #endif
 
+// Errors are polled only by validation on contexts without debug output, so that runs without
+// validation make no glGetError calls.
+#define CHECK_GL_ERROR()                    \
+    do                                      \
+    {                                       \
+        if (mPollErrors)                    \
+        {                                   \
+            checkError(__FILE__, __LINE__); \
+        }                                   \
+    } while (0)
+
+namespace {
+// Bytes of uniform blocks a frame starts with. It holds the view uniforms of every placed prop.
+constexpr size_t kUniformRingFrameSize = 256 * 1024;
+
+const char *const kUniformBlockNames[UNIFORMBLOCK::UNIFORMBLOCKMAX] = {
+    "LightUniforms", "FogUniforms", "LightWorldPositionUniform", "ViewUniforms"};
+
+#ifndef EGL_EGL_PROTOTYPES
+void APIENTRY debugMessageCallback(GLenum source,
+                                   GLenum type,
+                                   GLuint id,
+                                   GLenum severity,
+                                   GLsizei length,
+                                   const GLchar *message,
+                                   const void *userParam)
+{
+    std::cout << (type == GL_DEBUG_TYPE_ERROR ? "OpenGL error " : "OpenGL message ") << id << ": "
+              << message << std::endl;
+    ASSERT(type != GL_DEBUG_TYPE_ERROR);
+}
+#endif
+}  // namespace
+
 ContextGL::ContextGL() 
-: mWindow(nullptr)
+: mSkippedStateCalls(0),
+  mValidation(false),
+  mPollErrors(false),
+  mLightBuffer(0),
+  mFogBuffer(0),
+  mNoFogBuffer(0),
+  mViewRange(),
+  mMultiDraw(nullptr),
+  mWindow(nullptr)
 {}
 
-ContextGL::~ContextGL() {}
+ContextGL::~ContextGL()
+{
+    delete mMultiDraw;
+}
 
 bool ContextGL::createContext(std::string backend, bool enableMSAA)
 {
@@ -62,6 +110,10 @@ bool ContextGL::createContext(std::string backend, bool enableMSAA)
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
     glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
 #endif
+    if (mValidation)
+    {
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+    }
 #endif
 
     GLFWmonitor *pMonitor   = glfwGetPrimaryMonitor();
@@ -205,6 +257,18 @@ bool ContextGL::createContext(std::string backend, bool enableMSAA)
 
     glViewport(0, 0, mClientWidth, mClientHeight);
 
+    if (mValidation)
+    {
+        initDebugOutput();
+    }
+    mUniformRing.init(kUniformRingFrameSize);
+
+    static const FogUniforms kNoFog = {};
+    generateBuffer(&mLightBuffer);
+    generateBuffer(&mFogBuffer);
+    generateBuffer(&mNoFogBuffer);
+    updateBuffer(GL_UNIFORM_BUFFER, mNoFogBuffer, &kNoFog, sizeof(FogUniforms));
+
     return true;
 }
 
@@ -285,6 +349,42 @@ EGLBoolean ContextGL::FindEGLConfig(EGLDisplay dpy, const EGLint *attrib_list, E
 }
 #endif
 
+void ContextGL::setValidation(bool validation)
+{
+    mValidation = validation;
+}
+
+// The debug output of OpenGL 4.3 reports errors and warnings of the driver as they happen.
+void ContextGL::initDebugOutput()
+{
+#ifndef EGL_EGL_PROTOTYPES
+    if (GLAD_GL_VERSION_4_3)
+    {
+        glEnable(GL_DEBUG_OUTPUT);
+        // Messages are reported in the call that caused them, so that a debugger stops there.
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        glDebugMessageCallback(debugMessageCallback, nullptr);
+        glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0,
+                              nullptr, GL_FALSE);
+        return;
+    }
+#endif
+    std::cout << "OpenGL debug output is not supported, errors are polled after every call."
+              << std::endl;
+    mPollErrors = true;
+}
+
+void ContextGL::checkError(const char *file, int line) const
+{
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR)
+    {
+        std::cout << "OpenGL error 0x" << std::hex << error << std::dec << ": file \"" << file
+                  << "\", line " << line << std::endl;
+    }
+    ASSERT(error == GL_NO_ERROR);
+}
+
 Texture *ContextGL::createTexture(std::string name, std::string url)
 {
     TextureGL *texture = new TextureGL(this, name, url);
@@ -306,12 +406,12 @@ void ContextGL::generateTexture(unsigned int *texture)
 
 void ContextGL::bindTexture(unsigned int target, unsigned int textureId)
 {
-    glBindTexture(target, textureId);
+    mState.bindTexture(target, textureId);
 }
 
 void ContextGL::deleteTexture(unsigned int *texture)
 {
-    glDeleteTextures(1, texture);
+    mState.deleteTexture(*texture);
 }
 
 void ContextGL::uploadTexture(unsigned int target,
@@ -321,7 +421,7 @@ void ContextGL::uploadTexture(unsigned int target,
                               unsigned char *pixels)
 {
     glTexImage2D(target, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, pixels);
-    ASSERT(glGetError() == GL_NO_ERROR);
+    CHECK_GL_ERROR();
 }
 
 void ContextGL::setParameter(unsigned int target, unsigned int pname, int param)
@@ -336,13 +436,13 @@ void ContextGL::generateMipmap(unsigned int target)
 
 void ContextGL::initState()
 {
-    glEnable(GL_DEPTH_TEST);
+    mState.enable(GL_DEPTH_TEST, true);
     glColorMask(true, true, true, true);
     glClearColor(0, 0.8f, 1, 0);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glBlendEquation(GL_FUNC_ADD);
-    glEnable(GL_CULL_FACE);
-    glDepthMask(true);
+    mState.enable(GL_CULL_FACE, true);
+    mState.depthMask(true);
 }
 
 Buffer *ContextGL::createBuffer(int numComponents, const std::vector<float> &buf, bool isIndex)
@@ -364,6 +464,28 @@ Buffer *ContextGL::createBuffer(int numComponents,
     return buffer;
 }
 
+Buffer *ContextGL::createBuffer(int numComponents,
+                                const std::vector<unsigned int> &buf,
+                                bool isIndex)
+{
+    BufferGL *buffer =
+        new BufferGL(this, static_cast<int>(buf.size()), numComponents, isIndex, GL_UNSIGNED_INT, true);
+    buffer->loadBuffer(buf);
+
+    return buffer;
+}
+
+Buffer *ContextGL::createBuffer(int numComponents,
+                                const std::vector<unsigned char> &buf,
+                                bool isIndex)
+{
+    BufferGL *buffer =
+        new BufferGL(this, static_cast<int>(buf.size()), numComponents, isIndex, GL_UNSIGNED_BYTE, false);
+    buffer->loadBuffer(buf);
+
+    return buffer;
+}
+
 Program *ContextGL::createProgram(std::string vId, std::string fId)
 {
     ProgramGL *program = new ProgramGL(this, vId, fId);
@@ -374,7 +496,8 @@ Program *ContextGL::createProgram(std::string vId, std::string fId)
 
 void ContextGL::setWindowTitle(const std::string &text)
 {
-    glfwSetWindowTitle(mWindow, text.c_str());
+    std::string title = text + ", GL calls skipped: " + std::to_string(mSkippedStateCalls);
+    glfwSetWindowTitle(mWindow, title.c_str());
 }
 
 bool ContextGL::ShouldQuit()
@@ -390,6 +513,9 @@ void ContextGL::KeyBoardQuit()
 
 void ContextGL::DoFlush()
 {
+    mUniformRing.endFrame();
+    mSkippedStateCalls = mState.getTotalSkipped();
+    mState.resetCounters();
 #ifdef GL_GLEXT_PROTOTYPES
     eglSwapBuffers(mDisplay, mSurface);
     glfwSwapBuffers(mWindow);
@@ -407,36 +533,79 @@ void ContextGL::Terminate()
 int ContextGL::getUniformLocation(unsigned int programId, std::string name) const
 {
     GLint index = glGetUniformLocation(programId, name.c_str());
-    ASSERT(glGetError() == GL_NO_ERROR);
+    CHECK_GL_ERROR();
     return index;
 }
 
 int ContextGL::getAttribLocation(unsigned int programId, std::string name) const
 {
     GLint index = glGetAttribLocation(programId, name.c_str());
-    ASSERT(glGetError() == GL_NO_ERROR);
+    CHECK_GL_ERROR();
     return index;
 }
 
-void ContextGL::enableBlend(bool flag) const
+void ContextGL::getAttribLocations(unsigned int programId, int *locations) const
 {
-    if (flag)
+    for (int i = 0; i < VERTEXATTRIBUTEMAX; ++i)
     {
-        glEnable(GL_BLEND);
-    }
-    else
-    {
-        glDisable(GL_BLEND);
+        locations[i] = getAttribLocation(programId, vertexLayout::kAttributeNames[i]);
     }
 }
 
-void ContextGL::drawElements(BufferGL *buffer) const
+void ContextGL::enableBlend(bool flag) const
+{
+    mState.enable(GL_BLEND, flag);
+}
+
+// Draw a range of the index buffer, such as a level of detail of a mesh in the geometry arena.
+void ContextGL::drawElements(BufferGL *buffer, int firstIndex, int indexCount, int baseVertex) const
+{
+    GLenum type        = buffer->getType();
+    size_t indexBytes  = type == GL_UNSIGNED_INT ? 4 : (type == GL_UNSIGNED_BYTE ? 1 : 2);
+    const void *offset = reinterpret_cast<const void *>(firstIndex * indexBytes);
+#ifdef EGL_EGL_PROTOTYPES
+    // setAttribs has moved the attributes to baseVertex already.
+    glDrawElements(GL_TRIANGLES, indexCount, type, offset);
+#else
+    glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, type, offset, baseVertex);
+#endif
+
+    CHECK_GL_ERROR();
+}
+
+void ContextGL::drawElementsInstanced(BufferGL *buffer,
+                                      int firstIndex,
+                                      int indexCount,
+                                      int baseVertex,
+                                      int instanceCount) const
 {
-    GLint totalComponents = buffer->getTotalComponents();
-    GLenum type           = buffer->getType();
-    glDrawElements(GL_TRIANGLES, totalComponents, type, 0);
+    GLenum type        = buffer->getType();
+    size_t indexBytes  = type == GL_UNSIGNED_INT ? 4 : (type == GL_UNSIGNED_BYTE ? 1 : 2);
+    const void *offset = reinterpret_cast<const void *>(firstIndex * indexBytes);
+#ifdef EGL_EGL_PROTOTYPES
+    glDrawElementsInstanced(GL_TRIANGLES, indexCount, type, offset, instanceCount);
+#else
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, indexCount, type, offset, instanceCount,
+                                      baseVertex);
+#endif
 
-    ASSERT(glGetError() == GL_NO_ERROR);
+    CHECK_GL_ERROR();
+}
+
+void ContextGL::multiDrawElementsIndirect(BufferGL *buffer,
+                                          unsigned int indirectBuffer,
+                                          int firstCommand,
+                                          int drawCount) const
+{
+#ifndef EGL_EGL_PROTOTYPES
+    // Commands are DrawElementsIndirectCommand, 5 uints each.
+    const void *offset =
+        reinterpret_cast<const void *>(static_cast<intptr_t>(firstCommand) * 5 * sizeof(GLuint));
+    mState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, buffer->getType(), offset, drawCount, 0);
+
+    CHECK_GL_ERROR();
+#endif
 }
 
 Model *ContextGL::createModel(Aquarium *aquarium, MODELGROUP type, MODELNAME name, bool blend)
@@ -469,15 +638,119 @@ Model *ContextGL::createModel(Aquarium *aquarium, MODELGROUP type, MODELNAME nam
 
 void ContextGL::preFrame()
 {
-    glEnable(GL_DEPTH_TEST);
+    mUniformRing.beginFrame();
+
+    mState.enable(GL_DEPTH_TEST, true);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
-    ASSERT(glGetError() == GL_NO_ERROR);
+    CHECK_GL_ERROR();
+}
+
+// Blocks that are the same for every draw of the frame are bound once. Light and fog have
+// buffers of their own, written only when their version changes. The light world position and
+// view move with the eye, so they are copied into the ring. Outside models are not fogged, so
+// they bind a fog block of zeros instead.
+void ContextGL::updateFrameUniforms(Aquarium *aquarium)
+{
+    if (mLightUpload.update(aquarium->lightUniforms, &mUniformStats))
+    {
+        updateBuffer(GL_UNIFORM_BUFFER, mLightBuffer, &aquarium->lightUniforms.get(),
+                     sizeof(LightUniforms));
+    }
+    if (mFogUpload.update(aquarium->fogUniforms, &mUniformStats))
+    {
+        updateBuffer(GL_UNIFORM_BUFFER, mFogBuffer, &aquarium->fogUniforms.get(),
+                     sizeof(FogUniforms));
+    }
+    bindBufferBase(GL_UNIFORM_BUFFER, UNIFORMBLOCK::UNIFORMLIGHT, mLightBuffer);
+    setUniformBlock(UNIFORMBLOCK::UNIFORMLIGHTWORLDPOSITION,
+                    &aquarium->lightWorldPositionUniform, sizeof(LightWorldPositionUniform));
+
+    mViewRange = mUniformRing.allocate(&aquarium->viewUniforms, sizeof(ViewUniforms));
+    mUniformStats.bytesUploaded += sizeof(ViewUniforms);
+    bindFogUniforms(true);
+}
+
+// Multi draws read the world matrices of every draw from gl_DrawIDARB, which needs
+// GL_ARB_shader_draw_parameters or OpenGL 4.6 besides the indirect draws of OpenGL 4.3.
+bool ContextGL::supportsMultiDrawIndirect() const
+{
+#ifdef EGL_EGL_PROTOTYPES
+    return false;
+#else
+    if (!GLAD_GL_VERSION_4_3)
+    {
+        return false;
+    }
+    GLint numExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+    for (GLint i = 0; i < numExtensions; ++i)
+    {
+        const char *extension =
+            reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+        if (strcmp(extension, "GL_ARB_shader_draw_parameters") == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+#endif
 }
 
+void ContextGL::drawStaticModels(Aquarium *aquarium, const std::vector<StaticDraw> &draws)
+{
+    if (mMultiDraw == nullptr)
+    {
+        mMultiDraw = new MultiDrawGL(this);
+    }
+    mMultiDraw->draw(aquarium, draws);
+}
+
+void ContextGL::setUniformBlock(UNIFORMBLOCK block, const void *data, size_t size) const
+{
+    mUniformStats.bytesUploaded += size;
+    mUniformRing.bindRange(block, mUniformRing.allocate(data, size));
+
+    CHECK_GL_ERROR();
+}
+
+void ContextGL::bindFogUniforms(bool fog) const
+{
+    bindBufferBase(GL_UNIFORM_BUFFER, UNIFORMBLOCK::UNIFORMFOG, fog ? mFogBuffer : mNoFogBuffer);
+}
+
+void ContextGL::bindViewUniforms() const
+{
+    mUniformRing.bindRange(UNIFORMBLOCK::UNIFORMVIEW, mViewRange);
+}
+
+// Uniforms the program already holds are skipped.
 void ContextGL::setUniform(int index, const float *v, int type) const
 {
     ASSERT(index != -1);
+    size_t size = sizeof(float);
+    switch (type)
+    {
+        case GL_FLOAT_VEC4:
+            size = 4 * sizeof(float);
+            break;
+        case GL_FLOAT_VEC3:
+            size = 3 * sizeof(float);
+            break;
+        case GL_FLOAT_VEC2:
+            size = 2 * sizeof(float);
+            break;
+        case GL_FLOAT_MAT4:
+            size = 16 * sizeof(float);
+            break;
+    }
+    if (mState.hasUniform(index, v, size))
+    {
+        mUniformStats.bytesSkipped += size;
+        return;
+    }
+    mUniformStats.bytesUploaded += size;
+
     switch (type)
     {
         case GL_FLOAT:
@@ -511,34 +784,132 @@ void ContextGL::setUniform(int index, const float *v, int type) const
         }
     }
 
-    ASSERT(glGetError() == GL_NO_ERROR);
+    CHECK_GL_ERROR();
 }
 
-void ContextGL::setTexture(const TextureGL *texture, int index, int unit) const
+void ContextGL::setUniform(int index, int v) const
 {
     ASSERT(index != -1);
-    glUniform1i(index, unit);
-    glActiveTexture(GL_TEXTURE0 + unit);
-    glBindTexture(texture->getTarget(), texture->getTextureId());
+    if (mState.hasUniform(index, &v, sizeof(v)))
+    {
+        mUniformStats.bytesSkipped += sizeof(v);
+        return;
+    }
+    mUniformStats.bytesUploaded += sizeof(v);
+    glUniform1i(index, v);
 
-    ASSERT(glGetError() == GL_NO_ERROR);
+    CHECK_GL_ERROR();
 }
 
-void ContextGL::setAttribs(BufferGL *bufferGL, int index) const
+void ContextGL::setUniformBlockBindings(unsigned int programId) const
 {
-    ASSERT(index != -1);
-    glBindBuffer(bufferGL->getTarget(), bufferGL->getBuffer());
+    for (int i = 0; i < UNIFORMBLOCK::UNIFORMBLOCKMAX; ++i)
+    {
+        GLuint index = glGetUniformBlockIndex(programId, kUniformBlockNames[i]);
+        if (index != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(programId, index, i);
+        }
+    }
+
+    CHECK_GL_ERROR();
+}
 
-    glEnableVertexAttribArray(index);
-    glVertexAttribPointer(index, bufferGL->getNumComponents(), bufferGL->getType(),
-                          bufferGL->getNormalize(), bufferGL->getStride(), bufferGL->getOffset());
+void ContextGL::setTexture(const TextureGL *texture, int index, int unit) const
+{
+    // Samplers keep their unit, so the cache skips all but the first set of every program.
+    setUniform(index, unit);
+    mState.bindTexture(unit, texture->getTarget(), texture->getTextureId());
 
-    ASSERT(glGetError() == GL_NO_ERROR);
+    CHECK_GL_ERROR();
+}
+
+void ContextGL::setAttribs(BufferGL *bufferGL,
+                           const VertexLayout &layout,
+                           const int *locations,
+                           int baseVertex) const
+{
+    // Models that share a program share its vertex array, which keeps the attributes of the
+    // last of them.
+    if (mState.hasVertexAttribs(bufferGL->getBuffer(), layout, locations, baseVertex))
+    {
+        return;
+    }
+    mState.bindBuffer(bufferGL->getTarget(), bufferGL->getBuffer());
+
+#ifdef EGL_EGL_PROTOTYPES
+    // OpenGL ES 3.0 has no base vertex for draws, so the attributes start at it instead.
+    intptr_t base = static_cast<intptr_t>(baseVertex) * layout.stride;
+#else
+    intptr_t base = 0;
+#endif
+
+    for (int i = 0; i < VERTEXATTRIBUTEMAX; ++i)
+    {
+        if (!layout.hasAttribute(i) || locations[i] == -1)
+        {
+            continue;
+        }
+        GLenum type          = GL_FLOAT;
+        GLboolean normalized = GL_FALSE;
+        switch (layout.formats[i])
+        {
+            case VERTEXFLOAT16:
+                type = GL_HALF_FLOAT;
+                break;
+            case VERTEXSNORM8:
+                type       = GL_BYTE;
+                normalized = GL_TRUE;
+                break;
+            case VERTEXUNORM16:
+                type       = GL_UNSIGNED_SHORT;
+                normalized = GL_TRUE;
+                break;
+            default:
+                break;
+        }
+        glEnableVertexAttribArray(locations[i]);
+        glVertexAttribPointer(locations[i], layout.numComponents[i], type, normalized,
+                              layout.stride,
+                              reinterpret_cast<const void *>(base + layout.offsets[i]));
+    }
+
+    CHECK_GL_ERROR();
+}
+
+// Draws have no base instance in OpenGL ES 3.0, so the attributes start at firstInstance.
+void ContextGL::setInstanceAttribs(BufferGL *bufferGL,
+                                   const int *locations,
+                                   const int *numComponents,
+                                   int numAttribs,
+                                   int firstInstance) const
+{
+    mState.bindBuffer(bufferGL->getTarget(), bufferGL->getBuffer());
+
+    int stride = 0;
+    for (int i = 0; i < numAttribs; ++i)
+    {
+        stride += numComponents[i] * static_cast<int>(sizeof(GLfloat));
+    }
+    intptr_t offset = static_cast<intptr_t>(firstInstance) * stride;
+    for (int i = 0; i < numAttribs; ++i)
+    {
+        if (locations[i] != -1)
+        {
+            glEnableVertexAttribArray(locations[i]);
+            glVertexAttribPointer(locations[i], numComponents[i], GL_FLOAT, GL_FALSE, stride,
+                                  reinterpret_cast<const void *>(offset));
+            glVertexAttribDivisor(locations[i], 1);
+        }
+        offset += numComponents[i] * sizeof(GLfloat);
+    }
+
+    CHECK_GL_ERROR();
 }
 
 void ContextGL::setIndices(BufferGL *bufferGL) const
 {
-    glBindBuffer(bufferGL->getTarget(), bufferGL->getBuffer());
+    mState.bindBuffer(bufferGL->getTarget(), bufferGL->getBuffer());
 }
 
 void ContextGL::generateVAO(unsigned int *mVAO)
@@ -548,12 +919,12 @@ void ContextGL::generateVAO(unsigned int *mVAO)
 
 void ContextGL::bindVAO(unsigned int vao) const
 {
-    glBindVertexArray(vao);
+    mState.bindVertexArray(vao);
 }
 
 void ContextGL::deleteVAO(unsigned int *mVAO)
 {
-    glDeleteVertexArrays(1, mVAO);
+    mState.deleteVertexArray(*mVAO);
 }
 
 void ContextGL::generateBuffer(unsigned int *buf)
@@ -563,26 +934,66 @@ void ContextGL::generateBuffer(unsigned int *buf)
 
 void ContextGL::deleteBuffer(unsigned int *buf)
 {
-    glDeleteBuffers(1, buf);
+    mState.deleteBuffer(*buf);
 }
 
 void ContextGL::bindBuffer(unsigned int target, unsigned int buf)
 {
-    glBindBuffer(target, buf);
+    mState.bindBuffer(target, buf);
 }
 
 void ContextGL::uploadBuffer(unsigned int target, const std::vector<float> &buf)
 {
     glBufferData(target, sizeof(GLfloat) * buf.size(), buf.data(), GL_STATIC_DRAW);
 
-    ASSERT(glGetError() == GL_NO_ERROR);
+    CHECK_GL_ERROR();
 }
 
 void ContextGL::uploadBuffer(unsigned int target, const std::vector<unsigned short> &buf)
 {
     glBufferData(target, sizeof(GLushort) * buf.size(), buf.data(), GL_STATIC_DRAW);
 
-    ASSERT(glGetError() == GL_NO_ERROR);
+    CHECK_GL_ERROR();
+}
+
+void ContextGL::uploadBuffer(unsigned int target, const std::vector<unsigned int> &buf)
+{
+    glBufferData(target, sizeof(GLuint) * buf.size(), buf.data(), GL_STATIC_DRAW);
+
+    CHECK_GL_ERROR();
+}
+
+void ContextGL::uploadBuffer(unsigned int target, const std::vector<unsigned char> &buf)
+{
+    glBufferData(target, buf.size(), buf.data(), GL_STATIC_DRAW);
+
+    CHECK_GL_ERROR();
+}
+
+void ContextGL::updateBuffer(BufferGL *bufferGL, const void *data, size_t size) const
+{
+    mState.bindBuffer(bufferGL->getTarget(), bufferGL->getBuffer());
+    glBufferData(bufferGL->getTarget(), size, data, GL_STREAM_DRAW);
+
+    CHECK_GL_ERROR();
+}
+
+void ContextGL::updateBuffer(unsigned int target,
+                             unsigned int buf,
+                             const void *data,
+                             size_t size) const
+{
+    mState.bindBuffer(target, buf);
+    glBufferData(target, size, data, GL_STREAM_DRAW);
+
+    CHECK_GL_ERROR();
+}
+
+void ContextGL::bindBufferBase(unsigned int target, unsigned int index, unsigned int buf) const
+{
+    mState.bindBufferBase(target, index, buf);
+
+    CHECK_GL_ERROR();
 }
 
 void ContextGL::generateProgram(unsigned int *program)
@@ -592,12 +1003,12 @@ void ContextGL::generateProgram(unsigned int *program)
 
 void ContextGL::setProgram(unsigned int program)
 {
-    glUseProgram(program);
+    mState.useProgram(program);
 }
 
 void ContextGL::deleteProgram(unsigned int *program)
 {
-    glDeleteProgram(*program);
+    mState.deleteProgram(*program);
 }
 
 bool ContextGL::compileProgram(unsigned int programId,
@@ -12,8 +12,13 @@
 #include <vector>
 
 #include "../Context.h"
+#include "../VertexLayout.h"
 #include "BufferGL.h"
+#include "StateCacheGL.h"
 #include "TextureGL.h"
+#include "UniformRingGL.h"
+
+class MultiDrawGL;
 
 #ifdef EGL_EGL_PROTOTYPES
 #include <angle_gl.h>
@@ -31,12 +36,24 @@
 class BufferGL;
 class TextureGL;
 
+// Binding points of the uniform blocks of the 450 shaders. The blocks have the std140 layout of
+// the structs in Aquarium.h, as in the Dawn shaders.
+enum UNIFORMBLOCK : short
+{
+    UNIFORMLIGHT,
+    UNIFORMFOG,
+    UNIFORMLIGHTWORLDPOSITION,
+    UNIFORMVIEW,
+    UNIFORMBLOCKMAX
+};
+
 class ContextGL : public Context
 {
   public:
     ContextGL();
     ~ContextGL();
     bool createContext(std::string backend, bool enableMSAA) override;
+    void setValidation(bool validation) override;
     void setWindowTitle(const std::string &text) override;
     bool ShouldQuit() override;
     void KeyBoardQuit() override;
@@ -44,16 +61,52 @@ class ContextGL : public Context
     void Terminate() override;
 
     void preFrame() override;
+    void updateFrameUniforms(Aquarium *aquarium) override;
+    bool supportsMultiDrawIndirect() const override;
+    void drawStaticModels(Aquarium *aquarium, const std::vector<StaticDraw> &draws) override;
     void enableBlend(bool flag) const;
 
     Model *createModel(Aquarium *aquarium, MODELGROUP type, MODELNAME name, bool blend) override;
     int getUniformLocation(unsigned int programId, std::string name) const;
     int getAttribLocation(unsigned int programId, std::string name) const;
+    // Locations of every vertex attribute in the program, -1 for those it does not read.
+    void getAttribLocations(unsigned int programId, int *locations) const;
     void setUniform(int index, const float *v, int type) const;
+    void setUniform(int index, int v) const;
     void setTexture(const TextureGL *texture, int index, int unit) const;
-    void setAttribs(BufferGL *bufferGL, int index) const;
+    // Copy a uniform block into the uniform ring and bind it for the following draws.
+    void setUniformBlock(UNIFORMBLOCK block, const void *data, size_t size) const;
+    // Bind the fog of the frame, or a fog that leaves colors unchanged.
+    void bindFogUniforms(bool fog) const;
+    // Bind the view uniforms of the frame, as they were before any world matrix was written
+    // into them. For draws that only read the view and projection.
+    void bindViewUniforms() const;
+    // Bind an interleaved vertex buffer and point every attribute of layout that the program
+    // reads into it, for a mesh starting at baseVertex.
+    void setAttribs(BufferGL *bufferGL,
+                    const VertexLayout &layout,
+                    const int *locations,
+                    int baseVertex) const;
+    // Point per instance attributes at locations to bufferGL from firstInstance on. Instances
+    // hold the attributes one after another, of numComponents[i] floats each.
+    void setInstanceAttribs(BufferGL *bufferGL,
+                            const int *locations,
+                            const int *numComponents,
+                            int numAttribs,
+                            int firstInstance) const;
     void setIndices(BufferGL *bufferGL) const;
-    void drawElements(BufferGL *buffer) const;
+    void drawElements(BufferGL *buffer, int firstIndex, int indexCount, int baseVertex) const;
+    void drawElementsInstanced(BufferGL *buffer,
+                               int firstIndex,
+                               int indexCount,
+                               int baseVertex,
+                               int instanceCount) const;
+    // Draw drawCount commands of the indirect buffer from firstCommand on, with the indices of
+    // buffer.
+    void multiDrawElementsIndirect(BufferGL *buffer,
+                                   unsigned int indirectBuffer,
+                                   int firstCommand,
+                                   int drawCount) const;
 
     Buffer *createBuffer(int numComponents,
                          const std::vector<float> &buffer,
@@ -61,11 +114,23 @@ class ContextGL : public Context
     Buffer *createBuffer(int numComponents,
                          const std::vector<unsigned short> &buffer,
                          bool isIndex) override;
+    Buffer *createBuffer(int numComponents,
+                         const std::vector<unsigned int> &buffer,
+                         bool isIndex) override;
+    Buffer *createBuffer(int numComponents,
+                         const std::vector<unsigned char> &buffer,
+                         bool isIndex) override;
     void generateBuffer(unsigned int *buf);
     void deleteBuffer(unsigned int *buf);
     void bindBuffer(unsigned int target, unsigned int buf);
     void uploadBuffer(unsigned int target, const std::vector<float> &buf);
     void uploadBuffer(unsigned int target, const std::vector<unsigned short> &buf);
+    void uploadBuffer(unsigned int target, const std::vector<unsigned int> &buf);
+    void uploadBuffer(unsigned int target, const std::vector<unsigned char> &buf);
+    // Replace the contents of bufferGL with data that changes every frame.
+    void updateBuffer(BufferGL *bufferGL, const void *data, size_t size) const;
+    void updateBuffer(unsigned int target, unsigned int buf, const void *data, size_t size) const;
+    void bindBufferBase(unsigned int target, unsigned int index, unsigned int buf) const;
 
     Program *createProgram(std::string vId, std::string fId) override;
     void generateProgram(unsigned int *program);
@@ -74,6 +139,8 @@ class ContextGL : public Context
     bool compileProgram(unsigned int programId,
                         const string &VertexShaderCode,
                         const string &FragmentShaderCode);
+    // Bind the uniform blocks the program declares to their binding points.
+    void setUniformBlockBindings(unsigned int programId) const;
     void bindVAO(unsigned int vao) const;
     void generateVAO(unsigned int *mVAO);
     void deleteVAO(unsigned int *mVAO);
@@ -93,6 +160,28 @@ class ContextGL : public Context
 
   private:
     void initState();
+    // Report errors through the debug output, or by polling where there is none.
+    void initDebugOutput();
+    void checkError(const char *file, int line) const;
+
+    // Program, buffers, textures and fixed function state bound by the context. Everything
+    // that binds them goes through it.
+    mutable StateCacheGL mState;
+    // Calls the state cache skipped in the last frame.
+    int mSkippedStateCalls;
+    bool mValidation;
+    // Poll glGetError after calls, for validation without debug output.
+    bool mPollErrors;
+    mutable UniformRingGL mUniformRing;
+    // Blocks that rarely change, in buffers of their own.
+    unsigned int mLightBuffer;
+    unsigned int mFogBuffer;
+    unsigned int mNoFogBuffer;
+    UniformUpload mLightUpload;
+    UniformUpload mFogUpload;
+    UniformRangeGL mViewRange;
+    // Created by the first drawStaticModels.
+    MultiDrawGL *mMultiDraw;
 
 #ifndef EGL_EGL_PROTOTYPES
       GLFWwindow *mWindow;
@@ -7,27 +7,41 @@
 
 #include "FishModelGL.h"
 
-FishModelGL::FishModelGL(const ContextGL *contextGL,
+#include <algorithm>
+
+namespace {
+const char *const kFishPerNames[FishModelGL::kFishPerAttributes] = {"worldPosition", "scale",
+                                                                    "nextPosition", "time"};
+const int kFishPerComponents[FishModelGL::kFishPerAttributes]    = {3, 1, 3, 1};
+}  // namespace
+
+FishModelGL::FishModelGL(ContextGL *contextGL,
                          Aquarium *aquarium,
                          MODELGROUP type,
                          MODELNAME name,
                          bool blend)
-    : contextGL(contextGL), FishModel(type, name, blend)
+    : contextGL(contextGL),
+      FishModel(type, name, blend),
+      fishPersBuffer(nullptr)
 {
     viewInverseUniform.first = aquarium->viewUniforms.viewInverse;
     lightWorldPosUniform.first = aquarium->lightWorldPositionUniform.lightWorldPos;
-    lightColorUniform.first = aquarium->lightUniforms.lightColor;
-    specularUniform.first = aquarium->lightUniforms.specular;
+    lightColorUniform.first = aquarium->lightUniforms.get().lightColor;
+    specularUniform.first = aquarium->lightUniforms.get().specular;
     shininessUniform.first = 5.0f;
     specularFactorUniform.first = 0.3f;
-    ambientUniform.first = aquarium->lightUniforms.ambient;
+    ambientUniform.first = aquarium->lightUniforms.get().ambient;
     fogPowerUniform.first = g_fogPower;
     fogMultUniform.first = g_fogMult;
     fogOffsetUniform.first = g_fogOffset;
-    fogColorUniform.first = aquarium->fogUniforms.fogColor;
+    fogColorUniform.first = aquarium->fogUniforms.get().fogColor;
 
     viewProjectionUniform.first = aquarium->viewUniforms.viewProjection;
-    scaleUniform.first = 1;
+}
+
+FishModelGL::~FishModelGL()
+{
+    delete fishPersBuffer;
 }
 
 void FishModelGL::init()
@@ -59,13 +73,6 @@ void FishModelGL::init()
     fishBendAmountUniform.second =
         contextGL->getUniformLocation(programGL->getProgramId(), "fishBendAmount");
 
-    worldPositionUniform.second =
-        contextGL->getUniformLocation(programGL->getProgramId(), "worldPosition");
-    nextPositionUniform.second =
-        contextGL->getUniformLocation(programGL->getProgramId(), "nextPosition");
-    scaleUniform.second = contextGL->getUniformLocation(programGL->getProgramId(), "scale");
-    timeUniform.second  = contextGL->getUniformLocation(programGL->getProgramId(), "time");
-
     diffuseTexture.first    = static_cast<TextureGL *>(textureMap["diffuse"]);
     diffuseTexture.second   = contextGL->getUniformLocation(programGL->getProgramId(), "diffuse");
     normalTexture.first     = static_cast<TextureGL *>(textureMap["normalMap"]);
@@ -76,23 +83,41 @@ void FishModelGL::init()
     skyboxTexture.first  = static_cast<TextureGL *>(textureMap["skybox"]);
     skyboxTexture.second = contextGL->getUniformLocation(programGL->getProgramId(), "skybox");
 
-    positionBuffer.first  = static_cast<BufferGL *>(bufferMap["position"]);
-    positionBuffer.second = contextGL->getAttribLocation(programGL->getProgramId(), "position");
-    normalBuffer.first    = static_cast<BufferGL *>(bufferMap["normal"]);
-    normalBuffer.second   = contextGL->getAttribLocation(programGL->getProgramId(), "normal");
-    texCoordBuffer.first  = static_cast<BufferGL *>(bufferMap["texCoord"]);
-    texCoordBuffer.second = contextGL->getAttribLocation(programGL->getProgramId(), "texCoord");
-    tangentBuffer.first   = static_cast<BufferGL *>(bufferMap["tangent"]);
-    tangentBuffer.second  = contextGL->getAttribLocation(programGL->getProgramId(), "tangent");
-    binormalBuffer.first  = static_cast<BufferGL *>(bufferMap["binormal"]);
-    binormalBuffer.second = contextGL->getAttribLocation(programGL->getProgramId(), "binormal");
-
-    indicesBuffer = static_cast<BufferGL *>(bufferMap["indices"]);
+    vertexBuffer = static_cast<BufferGL *>(geometry.vertexBuffer);
+    contextGL->getAttribLocations(programGL->getProgramId(), attribLocations);
+
+    indicesBuffer = static_cast<BufferGL *>(geometry.indexBuffer);
+
+    for (int i = 0; i < kFishPerAttributes; ++i)
+    {
+        fishPerLocations[i] =
+            contextGL->getAttribLocation(programGL->getProgramId(), kFishPerNames[i]);
+    }
+    fishPersBuffer = new BufferGL(contextGL, 0, 1, false, GL_FLOAT, false);
 }
 
+// The instance buffer holds the fish of the last submitInstances.
 void FishModelGL::draw()
 {
-    contextGL->drawElements(indicesBuffer);
+    // One draw per level of detail, over the fish of that level, split into draws of at most
+    // kMaxFishPerDraw fish.
+    int firstInstance = 0;
+    for (size_t lod = 0; lod < lodInstanceCounts.size(); ++lod)
+    {
+        int end = firstInstance + lodInstanceCounts[lod];
+        while (firstInstance < end)
+        {
+            int count = std::min(end - firstInstance, kMaxFishPerDraw);
+            contextGL->setInstanceAttribs(fishPersBuffer, fishPerLocations, kFishPerComponents,
+                                          kFishPerAttributes, firstInstance);
+            contextGL->drawElementsInstanced(indicesBuffer,
+                                             geometry.firstIndex + lods[lod].firstIndex,
+                                             lods[lod].indexCount, geometry.baseVertex, count);
+            firstInstance += count;
+        }
+    }
+
+    lodInstanceCounts.clear();
 }
 
 void FishModelGL::preDraw() const
@@ -103,28 +128,29 @@ void FishModelGL::preDraw() const
     ProgramGL *programGL = static_cast<ProgramGL *>(mProgram);
     contextGL->bindVAO(programGL->getVAOId());
 
-    contextGL->setAttribs(positionBuffer.first, positionBuffer.second);
-    contextGL->setAttribs(normalBuffer.first, normalBuffer.second);
-    contextGL->setAttribs(texCoordBuffer.first, texCoordBuffer.second);
-
-    contextGL->setAttribs(tangentBuffer.first, tangentBuffer.second);
-    contextGL->setAttribs(binormalBuffer.first, binormalBuffer.second);
+    contextGL->setAttribs(vertexBuffer, vertexLayout, attribLocations, geometry.baseVertex);
 
     contextGL->setIndices(indicesBuffer);
 
+    contextGL->setUniform(shininessUniform.second, &shininessUniform.first, GL_FLOAT);
+    contextGL->setUniform(specularFactorUniform.second, &specularFactorUniform.first, GL_FLOAT);
+#ifdef EGL_EGL_PROTOTYPES
+    // The OpenGL ES shaders have no uniform blocks.
     contextGL->setUniform(viewInverseUniform.second, viewInverseUniform.first, GL_FLOAT_MAT4);
     contextGL->setUniform(lightWorldPosUniform.second, lightWorldPosUniform.first, GL_FLOAT_VEC3);
     contextGL->setUniform(lightColorUniform.second, lightColorUniform.first, GL_FLOAT_VEC4);
     contextGL->setUniform(specularUniform.second, specularUniform.first, GL_FLOAT_VEC4);
-    contextGL->setUniform(shininessUniform.second, &shininessUniform.first, GL_FLOAT);
-    contextGL->setUniform(specularFactorUniform.second, &specularFactorUniform.first, GL_FLOAT);
     contextGL->setUniform(ambientUniform.second, ambientUniform.first, GL_FLOAT_VEC4);
     contextGL->setUniform(fogPowerUniform.second, &fogPowerUniform.first, GL_FLOAT);
     contextGL->setUniform(fogMultUniform.second, &fogMultUniform.first, GL_FLOAT);
     contextGL->setUniform(fogOffsetUniform.second, &fogOffsetUniform.first, GL_FLOAT);
     contextGL->setUniform(fogColorUniform.second, fogColorUniform.first, GL_FLOAT_VEC4);
-
     contextGL->setUniform(viewProjectionUniform.second, viewProjectionUniform.first, GL_FLOAT_MAT4);
+#else
+    contextGL->bindViewUniforms();
+    contextGL->bindFogUniforms(true);
+#endif
+
     contextGL->setUniform(fishBendAmountUniform.second, &fishBendAmountUniform.first, GL_FLOAT);
     contextGL->setUniform(fishLengthUniform.second, &fishLengthUniform.first, GL_FLOAT);
     contextGL->setUniform(fishWaveLengthUniform.second, &fishWaveLengthUniform.first, GL_FLOAT);
@@ -140,13 +166,6 @@ void FishModelGL::preDraw() const
     }
 }
 
-void FishModelGL::updatePerInstanceUniforms(ViewUniforms *viewUniforms)
-{
-    contextGL->setUniform(scaleUniform.second, &scaleUniform.first, GL_FLOAT);
-    contextGL->setUniform(timeUniform.second, &timeUniform.first, GL_FLOAT);
-    contextGL->setUniform(worldPositionUniform.second, worldPositionUniform.first, GL_FLOAT_VEC3);
-    contextGL->setUniform(nextPositionUniform.second, nextPositionUniform.first, GL_FLOAT_VEC3);
-}
 void FishModelGL::updateFishCommonUniforms(float fishLength,
                                            float fishBendAmount,
                                            float fishWaveLength)
@@ -155,21 +174,12 @@ void FishModelGL::updateFishCommonUniforms(float fishLength,
     fishBendAmountUniform.first = fishBendAmount;
     fishWaveLengthUniform.first = fishWaveLength;
 }
-void FishModelGL::updateFishPerUniforms(float x,
-                                        float y,
-                                        float z,
-                                        float nextX,
-                                        float nextY,
-                                        float nextZ,
-                                        float scale,
-                                        float time)
+
+void FishModelGL::submitInstances(const FishInstances &instances, size_t count)
 {
-    worldPositionUniform.first[0] = x;
-    worldPositionUniform.first[1] = y;
-    worldPositionUniform.first[2] = z;
-    nextPositionUniform.first[0]  = nextX;
-    nextPositionUniform.first[1]  = nextY;
-    nextPositionUniform.first[2]  = nextZ;
-    scaleUniform.first            = scale;
-    timeUniform.first             = time;
+    if (count > 0)
+    {
+        contextGL->updateBuffer(fishPersBuffer, instances.fishPers, count * sizeof(FishPer));
+    }
+    lodInstanceCounts.assign(instances.lodCounts, instances.lodCounts + instances.numLods);
 }
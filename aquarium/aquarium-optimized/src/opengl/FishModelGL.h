@@ -18,64 +18,55 @@
 class FishModelGL : public FishModel
 {
   public:
-    FishModelGL(const ContextGL *context, Aquarium *aquarium, MODELGROUP type, MODELNAME name, bool blend);
+    FishModelGL(ContextGL *context, Aquarium *aquarium, MODELGROUP type, MODELNAME name, bool blend);
+    ~FishModelGL() override;
     void preDraw() const override;
-    void updatePerInstanceUniforms(ViewUniforms *viewUniforms) override;
     void updateFishCommonUniforms(float fishLength,
                                   float fishBendAmount,
                                   float fishWaveLength) override;
     void init() override;
     void draw() override;
 
-    void updateFishPerUniforms(float x,
-                               float y,
-                               float z,
-                               float nextX,
-                               float nextY,
-                               float nextZ,
-                               float scale,
-                               float time) override;
+    void submitInstances(const FishInstances &instances, size_t count) override;
 
     std::pair<float *, int> viewInverseUniform;
     std::pair<float *, int> lightWorldPosUniform;
-    std::pair<float *, int> lightColorUniform;
-    std::pair<float *, int> specularUniform;
+    std::pair<const float *, int> lightColorUniform;
+    std::pair<const float *, int> specularUniform;
     std::pair<float, int> shininessUniform;
     std::pair<float, int> specularFactorUniform;
 
-    std::pair<float *, int> ambientUniform;
+    std::pair<const float *, int> ambientUniform;
 
     std::pair<float, int> fogPowerUniform;
     std::pair<float, int> fogMultUniform;
     std::pair<float, int> fogOffsetUniform;
-    std::pair<float *, int> fogColorUniform;
+    std::pair<const float *, int> fogColorUniform;
 
     std::pair<float *, int> viewProjectionUniform;
     std::pair<float, int> fishLengthUniform;
     std::pair<float, int> fishWaveLengthUniform;
     std::pair<float, int> fishBendAmountUniform;
 
-    std::pair<float[3], int> worldPositionUniform;
-    std::pair<float[3], int> nextPositionUniform;
-    std::pair<float, int> scaleUniform;
-    std::pair<float, int> timeUniform;
-
     std::pair<TextureGL *, int> diffuseTexture;
     std::pair<TextureGL *, int> normalTexture;
     std::pair<TextureGL *, int> reflectionTexture;
     std::pair<TextureGL *, int> skyboxTexture;
 
-    std::pair<BufferGL *, int> positionBuffer;
-    std::pair<BufferGL *, int> normalBuffer;
-    std::pair<BufferGL *, int> texCoordBuffer;
-
-    std::pair<BufferGL *, int> tangentBuffer;
-    std::pair<BufferGL *, int> binormalBuffer;
+    BufferGL *vertexBuffer;
+    int attribLocations[VERTEXATTRIBUTEMAX];
 
     BufferGL * indicesBuffer;
 
+    // Attributes of FishPer, read once per instance from fishPersBuffer.
+    static constexpr int kFishPerAttributes = 4;
+    int fishPerLocations[kFishPerAttributes];
+
   private:
-    const ContextGL *contextGL;
+    ContextGL *contextGL;
+
+    std::vector<int> lodInstanceCounts;
+    BufferGL *fishPersBuffer;
 };
 
 #endif
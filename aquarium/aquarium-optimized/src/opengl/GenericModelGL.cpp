@@ -12,22 +12,22 @@ GenericModelGL::GenericModelGL(const ContextGL *context,
                                MODELGROUP type,
                                MODELNAME name,
                                bool blend)
-    : contextGL(contextGL), GenericModel(type, name, blend)
+    : contextGL(context), GenericModel(type, name, blend)
 {
     viewInverseUniform.first = aquarium->viewUniforms.viewInverse;
     lightWorldPosUniform.first = aquarium->lightWorldPositionUniform.lightWorldPos;
-    lightColorUniform.first = aquarium->lightUniforms.lightColor;
-    specularUniform.first = aquarium->lightUniforms.specular;
+    lightColorUniform.first = aquarium->lightUniforms.get().lightColor;
+    specularUniform.first = aquarium->lightUniforms.get().specular;
     shininessUniform.first = 50.0f;
     specularFactorUniform.first = 1.0f;
-    ambientUniform.first = aquarium->lightUniforms.ambient;
+    ambientUniform.first = aquarium->lightUniforms.get().ambient;
     worldUniform.first = aquarium->viewUniforms.world;
     worldViewProjectionUniform.first = aquarium->viewUniforms.worldViewProjection;
     worldInverseTransposeUniform.first = aquarium->viewUniforms.worldInverseTranspose;
     fogPowerUniform.first = g_fogPower;
     fogMultUniform.first = g_fogMult;
     fogOffsetUniform.first = g_fogOffset;
-    fogColorUniform.first = aquarium->fogUniforms.fogColor;
+    fogColorUniform.first = aquarium->fogUniforms.get().fogColor;
 }
 
 void GenericModelGL::init()
@@ -61,23 +61,16 @@ void GenericModelGL::init()
     normalTexture.first   = static_cast<TextureGL *>(textureMap["normalMap"]);
     normalTexture.second  = contextGL->getUniformLocation(programGL->getProgramId(), "normalMap");
 
-    positionBuffer.first  = static_cast<BufferGL *>(bufferMap["position"]);
-    positionBuffer.second = contextGL->getAttribLocation(programGL->getProgramId(), "position");
-    normalBuffer.first    = static_cast<BufferGL *>(bufferMap["normal"]);
-    normalBuffer.second   = contextGL->getAttribLocation(programGL->getProgramId(), "normal");
-    texCoordBuffer.first  = static_cast<BufferGL *>(bufferMap["texCoord"]);
-    texCoordBuffer.second = contextGL->getAttribLocation(programGL->getProgramId(), "texCoord");
-    tangentBuffer.first   = static_cast<BufferGL *>(bufferMap["tangent"]);
-    tangentBuffer.second  = contextGL->getAttribLocation(programGL->getProgramId(), "tangent");
-    binormalBuffer.first  = static_cast<BufferGL *>(bufferMap["binormal"]);
-    binormalBuffer.second = contextGL->getAttribLocation(programGL->getProgramId(), "binormal");
-
-    indicesBuffer = static_cast<BufferGL *>(bufferMap["indices"]);
+    vertexBuffer = static_cast<BufferGL *>(geometry.vertexBuffer);
+    contextGL->getAttribLocations(programGL->getProgramId(), attribLocations);
+
+    indicesBuffer = static_cast<BufferGL *>(geometry.indexBuffer);
 }
 
 void GenericModelGL::draw()
 {
-    contextGL->drawElements(indicesBuffer);
+    contextGL->drawElements(indicesBuffer, geometry.firstIndex + lods[mLod].firstIndex,
+                            lods[mLod].indexCount, geometry.baseVertex);
 }
 
 void GenericModelGL::preDraw() const
@@ -88,31 +81,26 @@ void GenericModelGL::preDraw() const
     ProgramGL *programGL = static_cast<ProgramGL *>(mProgram);
     contextGL->bindVAO(programGL->getVAOId());
 
-    contextGL->setAttribs(positionBuffer.first, positionBuffer.second);
-    contextGL->setAttribs(normalBuffer.first, normalBuffer.second);
-    contextGL->setAttribs(texCoordBuffer.first, texCoordBuffer.second);
-
-    // diffuseVertexShader doesn't contains tangent and binormal but normalMapVertexShader
-    // contains the two buffers.
-    if (tangentBuffer.second != -1 && binormalBuffer.second != -1)
-    {
-        contextGL->setAttribs(tangentBuffer.first, tangentBuffer.second);
-        contextGL->setAttribs(binormalBuffer.first, binormalBuffer.second);
-    }
+    contextGL->setAttribs(vertexBuffer, vertexLayout, attribLocations, geometry.baseVertex);
 
     contextGL->setIndices(indicesBuffer);
 
+    contextGL->setUniform(shininessUniform.second, &shininessUniform.first, GL_FLOAT);
+    contextGL->setUniform(specularFactorUniform.second, &specularFactorUniform.first, GL_FLOAT);
+#ifdef EGL_EGL_PROTOTYPES
+    // The OpenGL ES shaders have no uniform blocks.
     contextGL->setUniform(viewInverseUniform.second, viewInverseUniform.first, GL_FLOAT_MAT4);
     contextGL->setUniform(lightWorldPosUniform.second, lightWorldPosUniform.first, GL_FLOAT_VEC3);
     contextGL->setUniform(lightColorUniform.second, lightColorUniform.first, GL_FLOAT_VEC4);
     contextGL->setUniform(specularUniform.second, specularUniform.first, GL_FLOAT_VEC4);
-    contextGL->setUniform(shininessUniform.second, &shininessUniform.first, GL_FLOAT);
-    contextGL->setUniform(specularFactorUniform.second, &specularFactorUniform.first, GL_FLOAT);
     contextGL->setUniform(ambientUniform.second, ambientUniform.first, GL_FLOAT_VEC4);
     contextGL->setUniform(fogPowerUniform.second, &fogPowerUniform.first, GL_FLOAT);
     contextGL->setUniform(fogMultUniform.second, &fogMultUniform.first, GL_FLOAT);
     contextGL->setUniform(fogOffsetUniform.second, &fogOffsetUniform.first, GL_FLOAT);
     contextGL->setUniform(fogColorUniform.second, fogColorUniform.first, GL_FLOAT_VEC4);
+#else
+    contextGL->bindFogUniforms(true);
+#endif
 
     contextGL->setTexture(diffuseTexture.first, diffuseTexture.second, 0);
     // Generic models includes Arch, coral, rock, ship, etc. diffuseFragmentShader doesn't contain
@@ -125,9 +113,13 @@ void GenericModelGL::preDraw() const
 
 void GenericModelGL::updatePerInstanceUniforms(ViewUniforms *viewUniforms)
 {
+#ifdef EGL_EGL_PROTOTYPES
     contextGL->setUniform(worldUniform.second, worldUniform.first, GL_FLOAT_MAT4);
     contextGL->setUniform(worldViewProjectionUniform.second, worldViewProjectionUniform.first,
                           GL_FLOAT_MAT4);
     contextGL->setUniform(worldInverseTransposeUniform.second, worldInverseTransposeUniform.first,
                           GL_FLOAT_MAT4);
+#else
+    contextGL->setUniformBlock(UNIFORMBLOCK::UNIFORMVIEW, viewUniforms, sizeof(ViewUniforms));
+#endif
 }
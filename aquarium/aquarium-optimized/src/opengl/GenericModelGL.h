@@ -32,27 +32,23 @@ class GenericModelGL : public GenericModel
 
     std::pair<float *, int> viewInverseUniform;
     std::pair<float *, int> lightWorldPosUniform;
-    std::pair<float *, int> lightColorUniform;
-    std::pair<float *, int> specularUniform;
+    std::pair<const float *, int> lightColorUniform;
+    std::pair<const float *, int> specularUniform;
     std::pair<float, int> shininessUniform;
     std::pair<float, int> specularFactorUniform;
 
-    std::pair<float *, int> ambientUniform;
+    std::pair<const float *, int> ambientUniform;
 
     std::pair<float, int> fogPowerUniform;
     std::pair<float, int> fogMultUniform;
     std::pair<float, int> fogOffsetUniform;
-    std::pair<float *, int> fogColorUniform;
+    std::pair<const float *, int> fogColorUniform;
 
     std::pair<TextureGL *, int> diffuseTexture;
     std::pair<TextureGL *, int> normalTexture;
 
-    std::pair<BufferGL *, int> positionBuffer;
-    std::pair<BufferGL *, int> normalBuffer;
-    std::pair<BufferGL *, int> texCoordBuffer;
-
-    std::pair<BufferGL *, int> tangentBuffer;
-    std::pair<BufferGL *, int> binormalBuffer;
+    BufferGL *vertexBuffer;
+    int attribLocations[VERTEXATTRIBUTEMAX];
 
     BufferGL * indicesBuffer;
 
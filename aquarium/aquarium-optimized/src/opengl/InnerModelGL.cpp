@@ -12,7 +12,7 @@ InnerModelGL::InnerModelGL(const ContextGL *context,
                            MODELGROUP type,
                            MODELNAME name,
                            bool blend)
-    : contextGL(contextGL), InnerModel(type, name, blend)
+    : contextGL(context), InnerModel(type, name, blend)
 {
     viewInverseUniform.first = aquarium->viewUniforms.viewInverse;
     lightWorldPosUniform.first = aquarium->lightWorldPositionUniform.lightWorldPos;
@@ -28,7 +28,7 @@ InnerModelGL::InnerModelGL(const ContextGL *context,
     fogPowerUniform.first = g_fogPower;
     fogMultUniform.first = g_fogMult;
     fogOffsetUniform.first = g_fogOffset;
-    fogColorUniform.first = aquarium->fogUniforms.fogColor;
+    fogColorUniform.first = aquarium->fogUniforms.get().fogColor;
 }
 
 void InnerModelGL::init()
@@ -66,23 +66,16 @@ void InnerModelGL::init()
     skyboxTexture.first  = static_cast<TextureGL *>(textureMap["skybox"]);
     skyboxTexture.second = contextGL->getUniformLocation(programGL->getProgramId(), "skybox");
 
-    positionBuffer.first  = static_cast<BufferGL *>(bufferMap["position"]);
-    positionBuffer.second = contextGL->getAttribLocation(programGL->getProgramId(), "position");
-    normalBuffer.first    = static_cast<BufferGL *>(bufferMap["normal"]);
-    normalBuffer.second   = contextGL->getAttribLocation(programGL->getProgramId(), "normal");
-    texCoordBuffer.first  = static_cast<BufferGL *>(bufferMap["texCoord"]);
-    texCoordBuffer.second = contextGL->getAttribLocation(programGL->getProgramId(), "texCoord");
-    tangentBuffer.first   = static_cast<BufferGL *>(bufferMap["tangent"]);
-    tangentBuffer.second  = contextGL->getAttribLocation(programGL->getProgramId(), "tangent");
-    binormalBuffer.first  = static_cast<BufferGL *>(bufferMap["binormal"]);
-    binormalBuffer.second = contextGL->getAttribLocation(programGL->getProgramId(), "binormal");
-
-    indicesBuffer = static_cast<BufferGL *>(bufferMap["indices"]);
+    vertexBuffer = static_cast<BufferGL *>(geometry.vertexBuffer);
+    contextGL->getAttribLocations(programGL->getProgramId(), attribLocations);
+
+    indicesBuffer = static_cast<BufferGL *>(geometry.indexBuffer);
 }
 
 void InnerModelGL::draw()
 {
-    contextGL->drawElements(indicesBuffer);
+    contextGL->drawElements(indicesBuffer, geometry.firstIndex, geometry.indexCount,
+                            geometry.baseVertex);
 }
 
 void InnerModelGL::preDraw() const
@@ -93,21 +86,21 @@ void InnerModelGL::preDraw() const
     ProgramGL *programGL = static_cast<ProgramGL *>(mProgram);
     contextGL->bindVAO(programGL->getVAOId());
 
-    contextGL->setAttribs(positionBuffer.first, positionBuffer.second);
-    contextGL->setAttribs(normalBuffer.first, normalBuffer.second);
-    contextGL->setAttribs(texCoordBuffer.first, texCoordBuffer.second);
-
-    contextGL->setAttribs(tangentBuffer.first, tangentBuffer.second);
-    contextGL->setAttribs(binormalBuffer.first, binormalBuffer.second);
+    contextGL->setAttribs(vertexBuffer, vertexLayout, attribLocations, geometry.baseVertex);
 
     contextGL->setIndices(indicesBuffer);
 
+#ifdef EGL_EGL_PROTOTYPES
+    // The OpenGL ES shaders have no uniform blocks.
     contextGL->setUniform(viewInverseUniform.second, viewInverseUniform.first, GL_FLOAT_MAT4);
     contextGL->setUniform(lightWorldPosUniform.second, lightWorldPosUniform.first, GL_FLOAT_VEC3);
     contextGL->setUniform(fogPowerUniform.second, &fogPowerUniform.first, GL_FLOAT);
     contextGL->setUniform(fogMultUniform.second, &fogMultUniform.first, GL_FLOAT);
     contextGL->setUniform(fogOffsetUniform.second, &fogOffsetUniform.first, GL_FLOAT);
     contextGL->setUniform(fogColorUniform.second, fogColorUniform.first, GL_FLOAT_VEC4);
+#else
+    contextGL->bindFogUniforms(true);
+#endif
     contextGL->setUniform(etaUniform.second, &etaUniform.first, GL_FLOAT);
     contextGL->setUniform(tankColorFudgeUniform.second, &tankColorFudgeUniform.first, GL_FLOAT);
     contextGL->setUniform(refractionFudgeUniform.second, &refractionFudgeUniform.first, GL_FLOAT);
@@ -120,9 +113,13 @@ void InnerModelGL::preDraw() const
 
 void InnerModelGL::updatePerInstanceUniforms(ViewUniforms* viewUniforms)
 {
+#ifdef EGL_EGL_PROTOTYPES
     contextGL->setUniform(worldUniform.second, worldUniform.first, GL_FLOAT_MAT4);
     contextGL->setUniform(worldViewProjectionUniform.second, worldViewProjectionUniform.first,
                           GL_FLOAT_MAT4);
     contextGL->setUniform(worldInverseTransposeUniform.second, worldInverseTransposeUniform.first,
                           GL_FLOAT_MAT4);
+#else
+    contextGL->setUniformBlock(UNIFORMBLOCK::UNIFORMVIEW, viewUniforms, sizeof(ViewUniforms));
+#endif
 }
@@ -37,19 +37,15 @@ class InnerModelGL : public InnerModel
     std::pair<float, int> fogPowerUniform;
     std::pair<float, int> fogMultUniform;
     std::pair<float, int> fogOffsetUniform;
-    std::pair<float *, int> fogColorUniform;
+    std::pair<const float *, int> fogColorUniform;
 
     std::pair<TextureGL *, int> diffuseTexture;
     std::pair<TextureGL *, int> normalTexture;
     std::pair<TextureGL *, int> reflectionTexture;
     std::pair<TextureGL *, int> skyboxTexture;
 
-    std::pair<BufferGL *, int> positionBuffer;
-    std::pair<BufferGL *, int> normalBuffer;
-    std::pair<BufferGL *, int> texCoordBuffer;
-
-    std::pair<BufferGL *, int> tangentBuffer;
-    std::pair<BufferGL *, int> binormalBuffer;
+    BufferGL *vertexBuffer;
+    int attribLocations[VERTEXATTRIBUTEMAX];
 
     BufferGL * indicesBuffer;
 
@@ -0,0 +1,227 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// MultiDrawGL.cpp: Implements the indirect multi draws of static models of OpenGL.
+
+#include "MultiDrawGL.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "../ASSERT.h"
+#include "../Aquarium.h"
+#include "GenericModelGL.h"
+#include "ProgramGL.h"
+
+namespace {
+// Binding of the DrawWorlds storage buffer in the multi draw vertex shaders.
+constexpr unsigned int kDrawWorldsBinding = 0;
+}  // namespace
+
+MultiDrawGL::MultiDrawGL(ContextGL *context)
+    : mContext(context), mCommandBuffer(0), mWorldBuffer(0)
+{
+    mContext->generateBuffer(&mCommandBuffer);
+    mContext->generateBuffer(&mWorldBuffer);
+}
+
+MultiDrawGL::~MultiDrawGL()
+{
+    for (auto &program : mPrograms)
+    {
+        delete program.second;
+    }
+    mContext->deleteBuffer(&mCommandBuffer);
+    mContext->deleteBuffer(&mWorldBuffer);
+}
+
+// The multi draw program of a model has its fragment shader, and the vertex shader of its program
+// that reads world matrices from the storage buffer.
+ProgramGL *MultiDrawGL::getProgram(const GenericModelGL *model)
+{
+    const Program *program = model->getProgram();
+    std::string vId        = program->getVertexShader();
+    size_t pos             = vId.rfind("VertexShader");
+    ASSERT(pos != std::string::npos);
+    vId.replace(pos, std::string("VertexShader").size(), "MultiDrawVertexShader");
+    const std::string &fId = program->getFragmentShader();
+
+    auto it = mPrograms.find(vId + fId);
+    if (it != mPrograms.end())
+    {
+        return it->second;
+    }
+    ProgramGL *programGL = static_cast<ProgramGL *>(mContext->createProgram(vId, fId));
+    mPrograms[vId + fId] = programGL;
+
+    return programGL;
+}
+
+bool MultiDrawGL::canShareGroup(const GenericModelGL *model, const Group &group) const
+{
+    const GenericModelGL *other = group.model;
+    if (model->getProgram() != other->getProgram() || model->getBlend() != other->getBlend() ||
+        model->diffuseTexture.first != other->diffuseTexture.first ||
+        model->normalTexture.first != other->normalTexture.first ||
+        model->vertexBuffer != other->vertexBuffer ||
+        model->indicesBuffer != other->indicesBuffer ||
+        model->shininessUniform.first != other->shininessUniform.first ||
+        model->specularFactorUniform.first != other->specularFactorUniform.first)
+    {
+        return false;
+    }
+
+    const VertexLayout &layout      = model->vertexLayout;
+    const VertexLayout &otherLayout = other->vertexLayout;
+    if (layout.stride != otherLayout.stride)
+    {
+        return false;
+    }
+    for (int i = 0; i < VERTEXATTRIBUTEMAX; ++i)
+    {
+        if (layout.offsets[i] != otherLayout.offsets[i] ||
+            layout.numComponents[i] != otherLayout.numComponents[i] ||
+            layout.formats[i] != otherLayout.formats[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int MultiDrawGL::getGroup(const Model *model)
+{
+    auto it = mModelGroups.find(model);
+    if (it != mModelGroups.end())
+    {
+        return it->second;
+    }
+
+    const GenericModelGL *genericModel = static_cast<const GenericModelGL *>(model);
+    int group                          = -1;
+    for (size_t i = 0; i < mGroups.size(); ++i)
+    {
+        if (canShareGroup(genericModel, mGroups[i]))
+        {
+            group = static_cast<int>(i);
+            break;
+        }
+    }
+
+    if (group == -1)
+    {
+        Group newGroup;
+        newGroup.model   = genericModel;
+        newGroup.program = getProgram(genericModel);
+
+        GLuint programId                = newGroup.program->getProgramId();
+        newGroup.firstDrawLocation      = mContext->getUniformLocation(programId, "firstDraw");
+        newGroup.shininessLocation      = mContext->getUniformLocation(programId, "shininess");
+        newGroup.specularFactorLocation = mContext->getUniformLocation(programId, "specularFactor");
+        newGroup.diffuseLocation        = mContext->getUniformLocation(programId, "diffuse");
+        newGroup.normalMapLocation      = mContext->getUniformLocation(programId, "normalMap");
+        mContext->getAttribLocations(programId, newGroup.attribLocations);
+
+        group = static_cast<int>(mGroups.size());
+        mGroups.push_back(newGroup);
+    }
+    mModelGroups[model] = group;
+
+    return group;
+}
+
+// Draws are sorted by group with a counting sort, then the commands and world matrices of the
+// frame are uploaded once, and every group is one multi draw.
+void MultiDrawGL::draw(Aquarium *aquarium, const std::vector<StaticDraw> &draws)
+{
+    if (draws.empty())
+    {
+        return;
+    }
+
+    std::vector<int> drawGroups(draws.size());
+    for (size_t i = 0; i < draws.size(); ++i)
+    {
+        drawGroups[i] = getGroup(draws[i].model);
+    }
+
+    mGroupCounts.assign(mGroups.size(), 0);
+    for (int group : drawGroups)
+    {
+        ++mGroupCounts[group];
+    }
+    mGroupStarts.assign(mGroups.size(), 0);
+    for (size_t i = 1; i < mGroups.size(); ++i)
+    {
+        mGroupStarts[i] = mGroupStarts[i - 1] + mGroupCounts[i - 1];
+    }
+
+    mCommands.resize(draws.size());
+    mWorlds.resize(draws.size());
+    std::vector<int> heads(mGroupStarts);
+    for (size_t i = 0; i < draws.size(); ++i)
+    {
+        const StaticDraw &draw = draws[i];
+        const Model *model     = draw.model;
+        int slot               = heads[drawGroups[i]]++;
+
+        // Transforms of the instance were computed at load and for the frame.
+        const InstanceTransforms &transforms = model->transforms;
+        DrawWorld &world                     = mWorlds[slot];
+        memcpy(world.world, transforms.getWorld(draw.instance), sizeof(world.world));
+        memcpy(world.worldInverseTranspose, transforms.getWorldInverseTranspose(draw.instance),
+               sizeof(world.worldInverseTranspose));
+        memcpy(world.worldViewProjection, transforms.getWorldViewProjection(draw.instance),
+               sizeof(world.worldViewProjection));
+
+        DrawCommand &command  = mCommands[slot];
+        command.count         = static_cast<GLuint>(model->lods[draw.lod].indexCount);
+        command.instanceCount = 1;
+        command.firstIndex =
+            static_cast<GLuint>(model->geometry.firstIndex + model->lods[draw.lod].firstIndex);
+        command.baseVertex   = model->geometry.baseVertex;
+        command.baseInstance = 0;
+    }
+
+    mContext->updateBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer, mCommands.data(),
+                           mCommands.size() * sizeof(DrawCommand));
+    mContext->updateBuffer(GL_SHADER_STORAGE_BUFFER, mWorldBuffer, mWorlds.data(),
+                           mWorlds.size() * sizeof(DrawWorld));
+    mContext->bindBufferBase(GL_SHADER_STORAGE_BUFFER, kDrawWorldsBinding, mWorldBuffer);
+    // Multi draw shaders only read viewInverse from the view uniforms.
+    mContext->bindViewUniforms();
+    mContext->bindFogUniforms(true);
+
+    for (size_t i = 0; i < mGroups.size(); ++i)
+    {
+        if (mGroupCounts[i] == 0)
+        {
+            continue;
+        }
+        const Group &group          = mGroups[i];
+        const GenericModelGL *model = group.model;
+
+        group.program->setProgram();
+        mContext->enableBlend(model->getBlend());
+        mContext->bindVAO(group.program->getVAOId());
+        mContext->setAttribs(model->vertexBuffer, model->vertexLayout, group.attribLocations, 0);
+        mContext->setIndices(model->indicesBuffer);
+
+        mContext->setUniform(group.firstDrawLocation, mGroupStarts[i]);
+        mContext->setUniform(group.shininessLocation, &model->shininessUniform.first, GL_FLOAT);
+        mContext->setUniform(group.specularFactorLocation, &model->specularFactorUniform.first,
+                             GL_FLOAT);
+        mContext->setTexture(model->diffuseTexture.first, group.diffuseLocation, 0);
+        if (group.normalMapLocation != -1)
+        {
+            mContext->setTexture(model->normalTexture.first, group.normalMapLocation, 1);
+        }
+
+        mContext->multiDrawElementsIndirect(model->indicesBuffer, mCommandBuffer, mGroupStarts[i],
+                                            mGroupCounts[i]);
+    }
+}
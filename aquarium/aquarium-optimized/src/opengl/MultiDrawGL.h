@@ -0,0 +1,86 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// MultiDrawGL.h: Defines the indirect multi draws of static models of OpenGL. Placed instances of
+// generic models that share program, material and buffers are one group, drawn by one
+// glMultiDrawElementsIndirect. Shaders read the world matrices of a draw from a storage buffer at
+// firstDraw + gl_DrawIDARB.
+
+#pragma once
+#ifndef MULTIDRAWGL_H
+#define MULTIDRAWGL_H 1
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../Model.h"
+#include "../VertexLayout.h"
+#include "ContextGL.h"
+
+class Aquarium;
+class GenericModelGL;
+class ProgramGL;
+
+class MultiDrawGL
+{
+  public:
+    explicit MultiDrawGL(ContextGL *context);
+    ~MultiDrawGL();
+
+    void draw(Aquarium *aquarium, const std::vector<StaticDraw> &draws);
+
+  private:
+    // Layout of DrawElementsIndirectCommand.
+    struct DrawCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    // std430 layout of DrawWorld in the multi draw vertex shaders.
+    struct DrawWorld
+    {
+        float world[16];
+        float worldInverseTranspose[16];
+        float worldViewProjection[16];
+    };
+
+    // Models of a group have the state of model, the first one added to it.
+    struct Group
+    {
+        const GenericModelGL *model;
+        ProgramGL *program;
+        int firstDrawLocation;
+        int shininessLocation;
+        int specularFactorLocation;
+        int diffuseLocation;
+        int normalMapLocation;
+        int attribLocations[VERTEXATTRIBUTEMAX];
+    };
+
+    int getGroup(const Model *model);
+    ProgramGL *getProgram(const GenericModelGL *model);
+    bool canShareGroup(const GenericModelGL *model, const Group &group) const;
+
+    ContextGL *mContext;
+    std::vector<Group> mGroups;
+    std::unordered_map<const Model *, int> mModelGroups;
+    // Multi draw programs by the paths of their shaders.
+    std::unordered_map<std::string, ProgramGL *> mPrograms;
+
+    // Draws of the frame sorted by group, and the first draw and draw count of every group.
+    std::vector<int> mGroupStarts;
+    std::vector<int> mGroupCounts;
+    std::vector<DrawCommand> mCommands;
+    std::vector<DrawWorld> mWorlds;
+    GLuint mCommandBuffer;
+    GLuint mWorldBuffer;
+};
+
+#endif
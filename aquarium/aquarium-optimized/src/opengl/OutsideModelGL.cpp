@@ -12,22 +12,22 @@ OutsideModelGL::OutsideModelGL(const ContextGL *context,
                                MODELGROUP type,
                                MODELNAME name,
                                bool blend)
-    : contextGL(contextGL), OutsideModel(type, name, blend)
+    : contextGL(context), OutsideModel(type, name, blend)
 {
     viewInverseUniform.first = aquarium->viewUniforms.viewInverse;
     lightWorldPosUniform.first = aquarium->lightWorldPositionUniform.lightWorldPos;
-    lightColorUniform.first = aquarium->lightUniforms.lightColor;
-    specularUniform.first = aquarium->lightUniforms.specular;
+    lightColorUniform.first = aquarium->lightUniforms.get().lightColor;
+    specularUniform.first = aquarium->lightUniforms.get().specular;
     shininessUniform.first = 50.0f;
     specularFactorUniform.first = 0.0f;
-    ambientUniform.first = aquarium->lightUniforms.ambient;
+    ambientUniform.first = aquarium->lightUniforms.get().ambient;
     worldUniform.first = aquarium->viewUniforms.world;
     worldViewProjectionUniform.first = aquarium->viewUniforms.worldViewProjection;
     worldInverseTransposeUniform.first = aquarium->viewUniforms.worldInverseTranspose;
     fogPowerUniform.first = 0;
     fogMultUniform.first = 0;
     fogOffsetUniform.first = 0;
-    fogColorUniform.first = aquarium->fogUniforms.fogColor;
+    fogColorUniform.first = aquarium->fogUniforms.get().fogColor;
 }
 
 void OutsideModelGL::init()
@@ -59,19 +59,16 @@ void OutsideModelGL::init()
     diffuseTexture.first    = static_cast<TextureGL *>(textureMap["diffuse"]);
     diffuseTexture.second   = contextGL->getUniformLocation(programGL->getProgramId(), "diffuse");
 
-    positionBuffer.first  = static_cast<BufferGL *>(bufferMap["position"]);
-    positionBuffer.second = contextGL->getAttribLocation(programGL->getProgramId(), "position");
-    normalBuffer.first    = static_cast<BufferGL *>(bufferMap["normal"]);
-    normalBuffer.second   = contextGL->getAttribLocation(programGL->getProgramId(), "normal");
-    texCoordBuffer.first  = static_cast<BufferGL *>(bufferMap["texCoord"]);
-    texCoordBuffer.second = contextGL->getAttribLocation(programGL->getProgramId(), "texCoord");
+    vertexBuffer = static_cast<BufferGL *>(geometry.vertexBuffer);
+    contextGL->getAttribLocations(programGL->getProgramId(), attribLocations);
 
-    indicesBuffer = static_cast<BufferGL *>(bufferMap["indices"]);
+    indicesBuffer = static_cast<BufferGL *>(geometry.indexBuffer);
 }
 
 void OutsideModelGL::draw()
 {
-    contextGL->drawElements(indicesBuffer);
+    contextGL->drawElements(indicesBuffer, geometry.firstIndex, geometry.indexCount,
+                            geometry.baseVertex);
 }
 
 void OutsideModelGL::preDraw() const
@@ -82,32 +79,39 @@ void OutsideModelGL::preDraw() const
     ProgramGL *programGL = static_cast<ProgramGL *>(mProgram);
     contextGL->bindVAO(programGL->getVAOId());
 
-    contextGL->setAttribs(positionBuffer.first, positionBuffer.second);
-    contextGL->setAttribs(normalBuffer.first, normalBuffer.second);
-    contextGL->setAttribs(texCoordBuffer.first, texCoordBuffer.second);
+    contextGL->setAttribs(vertexBuffer, vertexLayout, attribLocations, geometry.baseVertex);
 
     contextGL->setIndices(indicesBuffer);
 
+    contextGL->setUniform(shininessUniform.second, &shininessUniform.first, GL_FLOAT);
+    contextGL->setUniform(specularFactorUniform.second, &specularFactorUniform.first, GL_FLOAT);
+#ifdef EGL_EGL_PROTOTYPES
+    // The OpenGL ES shaders have no uniform blocks.
     contextGL->setUniform(viewInverseUniform.second, viewInverseUniform.first, GL_FLOAT_MAT4);
     contextGL->setUniform(lightWorldPosUniform.second, lightWorldPosUniform.first, GL_FLOAT_VEC3);
     contextGL->setUniform(lightColorUniform.second, lightColorUniform.first, GL_FLOAT_VEC4);
     contextGL->setUniform(specularUniform.second, specularUniform.first, GL_FLOAT_VEC4);
-    contextGL->setUniform(shininessUniform.second, &shininessUniform.first, GL_FLOAT);
-    contextGL->setUniform(specularFactorUniform.second, &specularFactorUniform.first, GL_FLOAT);
     contextGL->setUniform(ambientUniform.second, ambientUniform.first, GL_FLOAT_VEC4);
     contextGL->setUniform(fogPowerUniform.second, &fogPowerUniform.first, GL_FLOAT);
     contextGL->setUniform(fogMultUniform.second, &fogMultUniform.first, GL_FLOAT);
     contextGL->setUniform(fogOffsetUniform.second, &fogOffsetUniform.first, GL_FLOAT);
     contextGL->setUniform(fogColorUniform.second, fogColorUniform.first, GL_FLOAT_VEC4);
+#else
+    contextGL->bindFogUniforms(false);
+#endif
 
     contextGL->setTexture(diffuseTexture.first, diffuseTexture.second, 0);
 }
 
 void OutsideModelGL::updatePerInstanceUniforms(ViewUniforms *viewUniforms)
 {
+#ifdef EGL_EGL_PROTOTYPES
     contextGL->setUniform(worldUniform.second, worldUniform.first, GL_FLOAT_MAT4);
     contextGL->setUniform(worldViewProjectionUniform.second, worldViewProjectionUniform.first,
                           GL_FLOAT_MAT4);
     contextGL->setUniform(worldInverseTransposeUniform.second, worldInverseTransposeUniform.first,
                           GL_FLOAT_MAT4);
+#else
+    contextGL->setUniformBlock(UNIFORMBLOCK::UNIFORMVIEW, viewUniforms, sizeof(ViewUniforms));
+#endif
 }
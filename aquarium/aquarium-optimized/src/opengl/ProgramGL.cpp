@@ -63,11 +63,21 @@ void ProgramGL::loadProgram()
                                    std::istreambuf_iterator<char>());
     FragmentShaderStream.close();
 
+#ifdef EGL_EGL_PROTOTYPES
     const string fogUniforms =
         R"(uniform float fogPower;
         uniform float fogMult;
         uniform float fogOffset;
         uniform vec4 fogColor;)";
+#else
+    const string fogUniforms =
+        R"(layout(std140) uniform FogUniforms {
+          float fogPower;
+          float fogMult;
+          float fogOffset;
+          vec4 fogColor;
+        };)";
+#endif
     const string fogCode =
         R"(outColor = mix(outColor, vec4(fogColor.rgb, diffuseColor.a),
         clamp(pow((v_position.z / v_position.w), fogPower) * fogMult - fogOffset,0.0,1.0));)";
@@ -99,6 +109,8 @@ void ProgramGL::loadProgram()
 
     bool status = context->compileProgram(mProgramId, VertexShaderCode, FragmentShaderCode);
     ASSERT(status);
+
+    context->setUniformBlockBindings(mProgramId);
 }
 
 void ProgramGL::setProgram()
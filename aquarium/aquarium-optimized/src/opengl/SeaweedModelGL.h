@@ -32,26 +32,25 @@ class SeaweedModelGL : public SeaweedModel
 
     std::pair<float *, int> viewInverseUniform;
     std::pair<float *, int> lightWorldPosUniform;
-    std::pair<float *, int> lightColorUniform;
-    std::pair<float *, int> specularUniform;
+    std::pair<const float *, int> lightColorUniform;
+    std::pair<const float *, int> specularUniform;
     std::pair<float, int> shininessUniform;
     std::pair<float, int> specularFactorUniform;
 
-    std::pair<float *, int> ambientUniform;
+    std::pair<const float *, int> ambientUniform;
 
     std::pair<float, int> fogPowerUniform;
     std::pair<float, int> fogMultUniform;
     std::pair<float, int> fogOffsetUniform;
-    std::pair<float *, int> fogColorUniform;
+    std::pair<const float *, int> fogColorUniform;
 
     std::pair<float *, int> viewProjectionUniform;
     std::pair<float, int> timeUniform;
 
     std::pair<TextureGL *, int> diffuseTexture;
 
-    std::pair<BufferGL *, int> positionBuffer;
-    std::pair<BufferGL *, int> normalBuffer;
-    std::pair<BufferGL *, int> texCoordBuffer;
+    BufferGL *vertexBuffer;
+    int attribLocations[VERTEXATTRIBUTEMAX];
 
     BufferGL * indicesBuffer;
 
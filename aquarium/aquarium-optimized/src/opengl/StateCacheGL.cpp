@@ -0,0 +1,396 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// StateCacheGL.cpp: Implements the shadow of the OpenGL state bound by ContextGL.
+
+#include "StateCacheGL.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#include "../ASSERT.h"
+
+StateCacheGL::StateCacheGL()
+{
+    invalidate();
+    resetCounters();
+}
+
+void StateCacheGL::invalidate()
+{
+    mProgram       = kUnknown;
+    mVertexArray   = kUnknown;
+    mActiveTexture = kUnknown;
+    for (GLuint &buffer : mBuffers)
+    {
+        buffer = kUnknown;
+    }
+    for (auto &unit : mTextures)
+    {
+        for (GLuint &texture : unit)
+        {
+            texture = kUnknown;
+        }
+    }
+    for (int &capability : mCapabilities)
+    {
+        capability = -1;
+    }
+    mDepthMask = -1;
+    mVertexAttribs.clear();
+    mUniforms.clear();
+}
+
+int StateCacheGL::getBufferTarget(GLenum target)
+{
+    switch (target)
+    {
+        case GL_ARRAY_BUFFER:
+            return BUFFERTARGET::BUFFERARRAY;
+        case GL_ELEMENT_ARRAY_BUFFER:
+            return BUFFERTARGET::BUFFERELEMENTARRAY;
+#ifndef EGL_EGL_PROTOTYPES
+        case GL_DRAW_INDIRECT_BUFFER:
+            return BUFFERTARGET::BUFFERDRAWINDIRECT;
+        case GL_SHADER_STORAGE_BUFFER:
+            return BUFFERTARGET::BUFFERSHADERSTORAGE;
+#endif
+        default:
+            return -1;
+    }
+}
+
+int StateCacheGL::getTextureTarget(GLenum target)
+{
+    switch (target)
+    {
+        case GL_TEXTURE_2D:
+            return TEXTURETARGET::TEXTURE2D;
+        case GL_TEXTURE_CUBE_MAP:
+            return TEXTURETARGET::TEXTURECUBEMAP;
+        default:
+            return -1;
+    }
+}
+
+int StateCacheGL::getCapability(GLenum capability)
+{
+    switch (capability)
+    {
+        case GL_BLEND:
+            return CAPABILITY::CAPABILITYBLEND;
+        case GL_DEPTH_TEST:
+            return CAPABILITY::CAPABILITYDEPTHTEST;
+        case GL_CULL_FACE:
+            return CAPABILITY::CAPABILITYCULLFACE;
+        default:
+            return -1;
+    }
+}
+
+void StateCacheGL::useProgram(GLuint program)
+{
+    check();
+    if (mProgram == program)
+    {
+        ++mSkipped.program;
+        return;
+    }
+    glUseProgram(program);
+    mProgram = program;
+}
+
+// The element array buffer is state of the vertex array, so it is unknown after a switch.
+void StateCacheGL::bindVertexArray(GLuint vertexArray)
+{
+    check();
+    if (mVertexArray == vertexArray)
+    {
+        ++mSkipped.vertexArray;
+        return;
+    }
+    glBindVertexArray(vertexArray);
+    mVertexArray                               = vertexArray;
+    mBuffers[BUFFERTARGET::BUFFERELEMENTARRAY] = kUnknown;
+}
+
+void StateCacheGL::bindBuffer(GLenum target, GLuint buffer)
+{
+    check();
+    int index = getBufferTarget(target);
+    if (index != -1 && mBuffers[index] == buffer)
+    {
+        ++mSkipped.buffer;
+        return;
+    }
+    glBindBuffer(target, buffer);
+    if (index != -1)
+    {
+        mBuffers[index] = buffer;
+    }
+}
+
+void StateCacheGL::bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    check();
+    glBindBufferBase(target, index, buffer);
+    int bufferTarget = getBufferTarget(target);
+    if (bufferTarget != -1)
+    {
+        mBuffers[bufferTarget] = buffer;
+    }
+}
+
+void StateCacheGL::activeTexture(GLuint unit)
+{
+    if (mActiveTexture != unit)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        mActiveTexture = unit;
+    }
+}
+
+void StateCacheGL::bindTexture(GLenum target, GLuint texture)
+{
+    check();
+    int index = getTextureTarget(target);
+    if (mActiveTexture >= kMaxTextureUnits || index == -1)
+    {
+        glBindTexture(target, texture);
+        return;
+    }
+    if (mTextures[mActiveTexture][index] == texture)
+    {
+        ++mSkipped.texture;
+        return;
+    }
+    glBindTexture(target, texture);
+    mTextures[mActiveTexture][index] = texture;
+}
+
+// The active unit is only switched when the texture of the unit changes.
+void StateCacheGL::bindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    check();
+    int index = getTextureTarget(target);
+    if (unit < kMaxTextureUnits && index != -1 && mTextures[unit][index] == texture)
+    {
+        ++mSkipped.texture;
+        return;
+    }
+    activeTexture(unit);
+    bindTexture(target, texture);
+}
+
+void StateCacheGL::enable(GLenum capability, bool enabled)
+{
+    check();
+    int index = getCapability(capability);
+    if (index != -1 && mCapabilities[index] == static_cast<int>(enabled))
+    {
+        if (index == CAPABILITY::CAPABILITYBLEND)
+        {
+            ++mSkipped.blend;
+        }
+        else
+        {
+            ++mSkipped.depthCull;
+        }
+        return;
+    }
+    if (enabled)
+    {
+        glEnable(capability);
+    }
+    else
+    {
+        glDisable(capability);
+    }
+    if (index != -1)
+    {
+        mCapabilities[index] = enabled;
+    }
+}
+
+void StateCacheGL::depthMask(bool enabled)
+{
+    check();
+    if (mDepthMask == static_cast<int>(enabled))
+    {
+        ++mSkipped.depthCull;
+        return;
+    }
+    glDepthMask(enabled);
+    mDepthMask = enabled;
+}
+
+bool StateCacheGL::hasVertexAttribs(GLuint buffer,
+                                    const VertexLayout &layout,
+                                    const int *locations,
+                                    int baseVertex)
+{
+    if (mVertexArray == kUnknown)
+    {
+        return false;
+    }
+
+    auto it = mVertexAttribs.find(mVertexArray);
+    if (it != mVertexAttribs.end())
+    {
+        const VertexAttribs &bound = it->second;
+        if (bound.buffer == buffer && bound.baseVertex == baseVertex &&
+            bound.layout.stride == layout.stride &&
+            memcmp(bound.layout.offsets, layout.offsets, sizeof(layout.offsets)) == 0 &&
+            memcmp(bound.layout.numComponents, layout.numComponents,
+                   sizeof(layout.numComponents)) == 0 &&
+            memcmp(bound.layout.formats, layout.formats, sizeof(layout.formats)) == 0 &&
+            memcmp(bound.locations, locations, sizeof(bound.locations)) == 0)
+        {
+            ++mSkipped.vertexAttribs;
+            return true;
+        }
+    }
+
+    VertexAttribs &attribs = mVertexAttribs[mVertexArray];
+    attribs.buffer         = buffer;
+    attribs.layout         = layout;
+    attribs.baseVertex     = baseVertex;
+    memcpy(attribs.locations, locations, sizeof(attribs.locations));
+    return false;
+}
+
+bool StateCacheGL::hasUniform(GLint location, const void *value, size_t size)
+{
+    if (mProgram == kUnknown)
+    {
+        return false;
+    }
+
+    std::vector<unsigned char> &bound = mUniforms[mProgram][location];
+    if (bound.size() == size && memcmp(bound.data(), value, size) == 0)
+    {
+        ++mSkipped.uniform;
+        return true;
+    }
+
+    const unsigned char *bytes = static_cast<const unsigned char *>(value);
+    bound.assign(bytes, bytes + size);
+    return false;
+}
+
+void StateCacheGL::deleteBuffer(GLuint buffer)
+{
+    glDeleteBuffers(1, &buffer);
+    for (GLuint &bound : mBuffers)
+    {
+        if (bound == buffer)
+        {
+            bound = 0;
+        }
+    }
+    for (auto it = mVertexAttribs.begin(); it != mVertexAttribs.end();)
+    {
+        it = it->second.buffer == buffer ? mVertexAttribs.erase(it) : std::next(it);
+    }
+}
+
+void StateCacheGL::deleteTexture(GLuint texture)
+{
+    glDeleteTextures(1, &texture);
+    for (auto &unit : mTextures)
+    {
+        for (GLuint &bound : unit)
+        {
+            if (bound == texture)
+            {
+                bound = 0;
+            }
+        }
+    }
+}
+
+void StateCacheGL::deleteProgram(GLuint program)
+{
+    glDeleteProgram(program);
+    mUniforms.erase(program);
+}
+
+void StateCacheGL::deleteVertexArray(GLuint vertexArray)
+{
+    glDeleteVertexArrays(1, &vertexArray);
+    mVertexAttribs.erase(vertexArray);
+    if (mVertexArray == vertexArray)
+    {
+        mVertexArray                               = 0;
+        mBuffers[BUFFERTARGET::BUFFERELEMENTARRAY] = kUnknown;
+    }
+}
+
+int StateCacheGL::getTotalSkipped() const
+{
+    return mSkipped.program + mSkipped.vertexArray + mSkipped.buffer + mSkipped.texture +
+           mSkipped.vertexAttribs + mSkipped.uniform + mSkipped.blend + mSkipped.depthCull;
+}
+
+void StateCacheGL::resetCounters()
+{
+    memset(&mSkipped, 0, sizeof(mSkipped));
+}
+
+// Every known state must match what OpenGL has bound. Calls that change state without going
+// through the cache show up here.
+void StateCacheGL::check() const
+{
+#ifdef GL_STATE_CHECK
+    auto checkBinding = [](GLenum binding, GLuint shadow) {
+        if (shadow != kUnknown)
+        {
+            GLint bound = 0;
+            glGetIntegerv(binding, &bound);
+            ASSERT(static_cast<GLuint>(bound) == shadow);
+        }
+    };
+
+    checkBinding(GL_CURRENT_PROGRAM, mProgram);
+    checkBinding(GL_VERTEX_ARRAY_BINDING, mVertexArray);
+    checkBinding(GL_ARRAY_BUFFER_BINDING, mBuffers[BUFFERTARGET::BUFFERARRAY]);
+    checkBinding(GL_ELEMENT_ARRAY_BUFFER_BINDING, mBuffers[BUFFERTARGET::BUFFERELEMENTARRAY]);
+#ifndef EGL_EGL_PROTOTYPES
+    checkBinding(GL_DRAW_INDIRECT_BUFFER_BINDING, mBuffers[BUFFERTARGET::BUFFERDRAWINDIRECT]);
+    checkBinding(GL_SHADER_STORAGE_BUFFER_BINDING, mBuffers[BUFFERTARGET::BUFFERSHADERSTORAGE]);
+#endif
+
+    GLint active = 0;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &active);
+    if (mActiveTexture != kUnknown)
+    {
+        ASSERT(static_cast<GLuint>(active) == GL_TEXTURE0 + mActiveTexture);
+    }
+    for (GLuint unit = 0; unit < kMaxTextureUnits; ++unit)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        checkBinding(GL_TEXTURE_BINDING_2D, mTextures[unit][TEXTURETARGET::TEXTURE2D]);
+        checkBinding(GL_TEXTURE_BINDING_CUBE_MAP, mTextures[unit][TEXTURETARGET::TEXTURECUBEMAP]);
+    }
+    glActiveTexture(static_cast<GLenum>(active));
+
+    const GLenum capabilities[CAPABILITYMAX] = {GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE};
+    for (int i = 0; i < CAPABILITYMAX; ++i)
+    {
+        if (mCapabilities[i] != -1)
+        {
+            ASSERT(static_cast<int>(glIsEnabled(capabilities[i])) == mCapabilities[i]);
+        }
+    }
+    if (mDepthMask != -1)
+    {
+        GLboolean depthMask = GL_FALSE;
+        glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+        ASSERT(static_cast<int>(depthMask) == mDepthMask);
+    }
+#endif
+}
@@ -0,0 +1,134 @@
+//
+// Copyright (c) 2019 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// StateCacheGL.h: Defines the shadow of the OpenGL state that ContextGL binds. Calls that would
+// bind the state already bound are skipped and counted. Builds with GL_STATE_CHECK compare the
+// shadow with glGet* before every skip.
+
+#pragma once
+#ifndef STATECACHEGL_H
+#define STATECACHEGL_H 1
+
+#include <unordered_map>
+#include <vector>
+
+#ifdef EGL_EGL_PROTOTYPES
+#include <angle_gl.h>
+#else
+#include "glad/glad.h"
+#endif
+
+#include "../VertexLayout.h"
+
+// Calls skipped since the counters were reset.
+struct StateCacheCounters
+{
+    int program;
+    int vertexArray;
+    int buffer;
+    int texture;
+    int vertexAttribs;
+    int uniform;
+    int blend;
+    int depthCull;
+};
+
+class StateCacheGL
+{
+  public:
+    StateCacheGL();
+
+    // Forget all state, so that the next calls are issued whatever was bound.
+    void invalidate();
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vertexArray);
+    void bindBuffer(GLenum target, GLuint buffer);
+    // The buffer is bound to the generic target as well as to the index.
+    void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    void bindTexture(GLenum target, GLuint texture);
+    void bindTexture(GLuint unit, GLenum target, GLuint texture);
+    // Enable or disable GL_BLEND, GL_DEPTH_TEST or GL_CULL_FACE.
+    void enable(GLenum capability, bool enabled);
+    void depthMask(bool enabled);
+    // Whether the attributes at locations of the bound vertex array already read layout from
+    // buffer at baseVertex. Otherwise they are recorded as reading it, to be set by the caller.
+    bool hasVertexAttribs(GLuint buffer,
+                          const VertexLayout &layout,
+                          const int *locations,
+                          int baseVertex);
+    // Whether the bound program already holds the size bytes of value at location. Uniforms are
+    // state of the program, so they stay set across program switches. Otherwise value is
+    // recorded as held, to be set by the caller.
+    bool hasUniform(GLint location, const void *value, size_t size);
+
+    // Deleted objects are unbound by OpenGL, so they are unbound from the shadow too.
+    void deleteBuffer(GLuint buffer);
+    void deleteTexture(GLuint texture);
+    void deleteVertexArray(GLuint vertexArray);
+    void deleteProgram(GLuint program);
+
+    const StateCacheCounters &getSkipped() const { return mSkipped; }
+    int getTotalSkipped() const;
+    void resetCounters();
+
+  private:
+    enum BUFFERTARGET : short
+    {
+        BUFFERARRAY,
+        BUFFERELEMENTARRAY,
+        BUFFERDRAWINDIRECT,
+        BUFFERSHADERSTORAGE,
+        BUFFERTARGETMAX
+    };
+    enum TEXTURETARGET : short
+    {
+        TEXTURE2D,
+        TEXTURECUBEMAP,
+        TEXTURETARGETMAX
+    };
+    enum CAPABILITY : short
+    {
+        CAPABILITYBLEND,
+        CAPABILITYDEPTHTEST,
+        CAPABILITYCULLFACE,
+        CAPABILITYMAX
+    };
+    static constexpr GLuint kMaxTextureUnits = 8;
+
+    // Index of the shadow of a target or capability, -1 for those not shadowed.
+    static int getBufferTarget(GLenum target);
+    static int getTextureTarget(GLenum target);
+    static int getCapability(GLenum capability);
+
+    void activeTexture(GLuint unit);
+    void check() const;
+
+    // kUnknown for state that is not known, and for enables -1.
+    static constexpr GLuint kUnknown = ~0u;
+    GLuint mProgram;
+    GLuint mVertexArray;
+    GLuint mBuffers[BUFFERTARGETMAX];
+    GLuint mActiveTexture;
+    GLuint mTextures[kMaxTextureUnits][TEXTURETARGETMAX];
+    int mCapabilities[CAPABILITYMAX];
+    int mDepthMask;
+
+    // Attributes every vertex array was last pointed at by hasVertexAttribs.
+    struct VertexAttribs
+    {
+        GLuint buffer;
+        VertexLayout layout;
+        int locations[VERTEXATTRIBUTEMAX];
+        int baseVertex;
+    };
+    std::unordered_map<GLuint, VertexAttribs> mVertexAttribs;
+    // Bytes of the uniforms every program was last set to by hasUniform, by location.
+    std::unordered_map<GLuint, std::unordered_map<GLint, std::vector<unsigned char>>> mUniforms;
+
+    StateCacheCounters mSkipped;
+};
+
+#endif
@@ -0,0 +1,147 @@
+//
+// Copyright (c) 2018 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// UniformRingGL.cpp: Implements the ring buffer of uniform blocks of OpenGL.
+
+#include "UniformRingGL.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "../ASSERT.h"
+
+UniformRingGL::UniformRingGL()
+    : mBuffer(0), mMapped(nullptr), mFrameSize(0), mAlignment(256), mFrame(0), mHead(0)
+{
+    for (int i = 0; i < kFramesInFlight; ++i)
+    {
+        mFences[i] = nullptr;
+    }
+}
+
+UniformRingGL::~UniformRingGL()
+{
+    for (int i = 0; i < kFramesInFlight; ++i)
+    {
+        if (mFences[i] != nullptr)
+        {
+            glDeleteSync(mFences[i]);
+        }
+    }
+    if (!mRetiredBuffers.empty())
+    {
+        glDeleteBuffers(static_cast<GLsizei>(mRetiredBuffers.size()), mRetiredBuffers.data());
+    }
+    if (mBuffer != 0)
+    {
+        glDeleteBuffers(1, &mBuffer);
+    }
+}
+
+void UniformRingGL::init(size_t frameSize)
+{
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment > 0)
+    {
+        mAlignment = static_cast<size_t>(alignment);
+    }
+    createBuffer(frameSize);
+}
+
+void UniformRingGL::createBuffer(size_t frameSize)
+{
+    mFrameSize = (frameSize + mAlignment - 1) / mAlignment * mAlignment;
+    size_t size = mFrameSize * kFramesInFlight;
+
+    glGenBuffers(1, &mBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+#ifndef EGL_EGL_PROTOTYPES
+    if (GLAD_GL_VERSION_4_4)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+        mMapped = static_cast<unsigned char *>(
+            glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags));
+    }
+    else
+#endif
+    {
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        mMapped = nullptr;
+    }
+
+    ASSERT(glGetError() == GL_NO_ERROR);
+}
+
+void UniformRingGL::beginFrame()
+{
+    if (!mRetiredBuffers.empty())
+    {
+        glDeleteBuffers(static_cast<GLsizei>(mRetiredBuffers.size()), mRetiredBuffers.data());
+        mRetiredBuffers.clear();
+    }
+
+    mFrame = (mFrame + 1) % kFramesInFlight;
+    mHead  = mFrame * mFrameSize;
+
+    GLsync &fence = mFences[mFrame];
+    if (fence != nullptr)
+    {
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        while (result == GL_TIMEOUT_EXPIRED)
+        {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+void UniformRingGL::endFrame()
+{
+    mFences[mFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+UniformRangeGL UniformRingGL::allocate(const void *data, size_t size)
+{
+    size_t frameEnd = (mFrame + 1) * mFrameSize;
+    if (mHead + size > frameEnd)
+    {
+        // The new buffer is not used by any frame yet, so the fences of the old one are dropped.
+        mRetiredBuffers.push_back(mBuffer);
+        for (int i = 0; i < kFramesInFlight; ++i)
+        {
+            if (mFences[i] != nullptr)
+            {
+                glDeleteSync(mFences[i]);
+                mFences[i] = nullptr;
+            }
+        }
+        createBuffer(std::max(mFrameSize * 2, size));
+        mHead = mFrame * mFrameSize;
+    }
+
+    UniformRangeGL range = {mBuffer, mHead, size};
+    if (mMapped != nullptr)
+    {
+        memcpy(mMapped + range.offset, data, size);
+    }
+    else
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, range.offset, size, data);
+    }
+    mHead += (size + mAlignment - 1) / mAlignment * mAlignment;
+
+    return range;
+}
+
+void UniformRingGL::bindRange(unsigned int binding, const UniformRangeGL &range) const
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, range.buffer, range.offset, range.size);
+}
@@ -0,0 +1,72 @@
+//
+// Copyright (c) 2018 The WebGLNativePorts Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// UniformRingGL.h: Defines the ring buffer that uniform blocks of every frame are sub-allocated
+// from. The ring is split between the frames in flight, and a fence guards the part of each
+// frame until the GPU is done with it.
+
+#pragma once
+#ifndef UNIFORMRINGGL_H
+#define UNIFORMRINGGL_H 1
+
+#include <cstddef>
+#include <vector>
+
+#ifdef EGL_EGL_PROTOTYPES
+#include <angle_gl.h>
+#include <memory>
+#include "EGL/egl.h"
+#include "EGL/eglext.h"
+#include "EGL/eglext_angle.h"
+#include "EGL/eglplatform.h"
+#include "EGLWindow.h"
+#else
+#include "glad/glad.h"
+#endif
+
+// Block copied into the ring, valid until the frame it was allocated in ends.
+struct UniformRangeGL
+{
+    GLuint buffer;
+    size_t offset;
+    size_t size;
+};
+
+class UniformRingGL
+{
+  public:
+    UniformRingGL();
+    ~UniformRingGL();
+
+    // Create the buffer with frameSize bytes for every frame in flight. Needs a current context.
+    void init(size_t frameSize);
+    // Wait for the GPU to finish the frame that last used the part of the ring of this frame.
+    void beginFrame();
+    // Fence the blocks written in this frame.
+    void endFrame();
+    // Copy a block into the ring. The part of every frame doubles when it is full.
+    UniformRangeGL allocate(const void *data, size_t size);
+    void bindRange(unsigned int binding, const UniformRangeGL &range) const;
+
+  private:
+    static constexpr int kFramesInFlight = 3;
+
+    void createBuffer(size_t frameSize);
+
+    GLuint mBuffer;
+    // Buffers replaced by a larger one in this frame. Blocks bound earlier in the frame still
+    // point into them, so they are deleted when the next frame begins.
+    std::vector<GLuint> mRetiredBuffers;
+    // Persistent and coherent mapping of the whole ring. Null without GL 4.4, where blocks are
+    // written with glBufferSubData instead.
+    unsigned char *mMapped;
+    size_t mFrameSize;
+    size_t mAlignment;
+    int mFrame;
+    size_t mHead;
+    GLsync mFences[kFramesInFlight];
+};
+
+#endif